@@ -29,23 +29,19 @@ private:
 		window->Update();
 	}
 
-	void Loop()
+	// Windows that render do so on their own thread, so this one only
+	// sleeps until the next message
+	int Loop()
 	{
 		MSG msg;
 
 		ZeroMemory(&msg, sizeof(MSG));
-		while (true) {
-			if (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
-				if (msg.message == WM_QUIT) {
-					break;
-				}
-				TranslateMessage(&msg);
-				DispatchMessage(&msg);
-			}
-			else {
-				window->drawFrame();
-			}
+		while (GetMessage(&msg, nullptr, 0, 0) > 0) {
+			TranslateMessage(&msg);
+			DispatchMessage(&msg);
 		}
+		// From PostQuitMessage
+		return (int)msg.wParam;
 	}
 
 	void Teardown()
@@ -63,8 +59,8 @@ public:
 	int Run()
 	{
 		Setup();
-		Loop();
+		int exitCode = Loop();
 		Teardown();
-		return 0;
+		return exitCode;
 	}
 };
@@ -0,0 +1,103 @@
+#include "Benchmark.h"
+
+#include <Windows.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+Benchmark::Benchmark(uint32_t warmupFrames, uint32_t measuredFrames)
+	: current(0)
+	, frame(0)
+	, warmupFrames(warmupFrames)
+	, measuredFrames(measuredFrames)
+{
+}
+
+bool Benchmark::requested()
+{
+	return strstr(GetCommandLineA(), "-benchmark") != nullptr;
+}
+
+void Benchmark::add(const std::string& name, std::function<void()> setup)
+{
+	bool idle = !running();
+	scenarios.push_back({ name, setup, {}, 0, 0.0, 0.0, 0.0 });
+	if (idle) {
+		current = scenarios.size() - 1;
+		frame = 0;
+	}
+}
+
+void Benchmark::counter(const std::string& name, double value)
+{
+	if (running()) {
+		scenarios[current].counters.push_back({ name, value, 0 });
+	}
+}
+
+void Benchmark::sample(const std::string& name, double value)
+{
+	if (!running() || frame <= warmupFrames) {
+		return;
+	}
+	auto& counters = scenarios[current].counters;
+	auto counter = std::find_if(counters.begin(), counters.end(), [&name](const Counter& c) {
+		return c.name == name;
+	});
+	if (counter == counters.end()) {
+		counters.push_back({ name, value, 1 });
+	}
+	else {
+		counter->samples++;
+		counter->value += (value - counter->value) / counter->samples;
+	}
+}
+
+void Benchmark::tick()
+{
+	if (!running()) {
+		return;
+	}
+	Scenario& scenario = scenarios[current];
+	if (frame == 0) {
+		scenario.setup();
+		last = Clock::now();
+		frame++;
+		return;
+	}
+
+	Clock::time_point now = Clock::now();
+	double ms = std::chrono::duration<double, std::milli>(now - last).count();
+	last = now;
+
+	if (frame > warmupFrames) {
+		scenario.minMs = scenario.frames == 0 ? ms : std::min(scenario.minMs, ms);
+		scenario.maxMs = std::max(scenario.maxMs, ms);
+		scenario.totalMs += ms;
+		scenario.frames++;
+	}
+	if (++frame > warmupFrames + measuredFrames) {
+		current++;
+		frame = 0;
+	}
+}
+
+void Benchmark::report(const std::string& path) const
+{
+	std::ostringstream out;
+	out << "scenario,frames,avg_ms,min_ms,max_ms,fps,counters\n";
+	for (const auto& scenario : scenarios) {
+		double average = scenario.frames > 0 ? scenario.totalMs / scenario.frames : 0.0;
+		out << scenario.name << ',' << scenario.frames << ','
+			<< average << ',' << scenario.minMs << ',' << scenario.maxMs << ','
+			<< (average > 0 ? 1000.0 / average : 0.0) << ',';
+		for (const auto& counter : scenario.counters) {
+			out << counter.name << '=' << counter.value << ' ';
+		}
+		out << '\n';
+	}
+
+	OutputDebugStringA(out.str().c_str());
+	std::ofstream file(path);
+	file << out.str();
+}
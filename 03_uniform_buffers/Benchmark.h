@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Runs a list of named scenarios back to back inside the render loop and
+// reports frame timings plus any counters the scenarios record. Enabled by
+// starting the application with -benchmark on the command line.
+class Benchmark
+{
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Counter {
+		std::string name;
+		double value;
+		uint32_t samples;	// 0 for plain counters
+	};
+
+	struct Scenario {
+		std::string name;
+		std::function<void()> setup;
+		std::vector<Counter> counters;
+		uint32_t frames;
+		double totalMs;
+		double minMs;
+		double maxMs;
+	};
+
+	std::vector<Scenario> scenarios;
+	size_t current;
+	uint32_t frame;
+	uint32_t warmupFrames;
+	uint32_t measuredFrames;
+	Clock::time_point last;
+public:
+	Benchmark(uint32_t warmupFrames = 60, uint32_t measuredFrames = 600);
+
+	static bool requested();
+
+	void add(const std::string& name, std::function<void()> setup);
+	// Attaches a counter to the scenario currently being set up or run
+	void counter(const std::string& name, double value);
+	// Adds a per-frame measurement; the report shows the mean over measured frames
+	void sample(const std::string& name, double value);
+
+	inline bool running() const { return current < scenarios.size(); }
+	inline const std::string& scenario() const { return scenarios[current].name; }
+	// Called once per presented frame
+	void tick();
+	void report(const std::string& path) const;
+};
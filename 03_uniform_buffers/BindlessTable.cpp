@@ -0,0 +1,177 @@
+#include "BindlessTable.h"
+
+#include <cstring>
+#include <stdexcept>
+
+const uint32_t BindlessTable::BUFFER_BINDING = 0;
+const uint32_t BindlessTable::IMAGE_BINDING = 1;
+const std::vector<const char*> BindlessTable::EXTENSIONS = {
+	VK_KHR_MAINTENANCE3_EXTENSION_NAME,
+	VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME
+};
+
+uint32_t BindlessTable::Slots::take()
+{
+	if (!free.empty()) {
+		uint32_t index = free.back();
+		free.pop_back();
+		return index;
+	}
+	if (next == capacity) {
+		throw std::runtime_error("bindless table is full!");
+	}
+	return next++;
+}
+
+BindlessTable::BindlessTable()
+	: buffers{ 0, 0 }
+	, images{ 0, 0 }
+{
+}
+
+BindlessTable::~BindlessTable()
+{
+}
+
+bool BindlessTable::supported(vk::PhysicalDevice physicalDevice)
+{
+	if (physicalDevice.getProperties().apiVersion < VK_API_VERSION_1_1) {
+		return false;
+	}
+	uint32_t found = 0;
+	for (const auto& properties : physicalDevice.enumerateDeviceExtensionProperties()) {
+		for (const char* name : EXTENSIONS) {
+			if (strcmp(properties.extensionName, name) == 0) {
+				found++;
+			}
+		}
+	}
+	if (found != EXTENSIONS.size()) {
+		return false;
+	}
+
+	vk::PhysicalDeviceDescriptorIndexingFeaturesEXT indexing;
+	vk::PhysicalDeviceFeatures2 features = vk::PhysicalDeviceFeatures2()
+		.setPNext(&indexing);
+	physicalDevice.getFeatures2(&features);
+	return indexing.runtimeDescriptorArray &&
+		indexing.descriptorBindingPartiallyBound &&
+		indexing.descriptorBindingStorageBufferUpdateAfterBind &&
+		indexing.descriptorBindingSampledImageUpdateAfterBind &&
+		indexing.shaderStorageBufferArrayNonUniformIndexing &&
+		indexing.shaderSampledImageArrayNonUniformIndexing;
+}
+
+vk::PhysicalDeviceDescriptorIndexingFeaturesEXT BindlessTable::requiredFeatures()
+{
+	return vk::PhysicalDeviceDescriptorIndexingFeaturesEXT()
+		.setRuntimeDescriptorArray(VK_TRUE)
+		.setDescriptorBindingPartiallyBound(VK_TRUE)
+		.setDescriptorBindingStorageBufferUpdateAfterBind(VK_TRUE)
+		.setDescriptorBindingSampledImageUpdateAfterBind(VK_TRUE)
+		.setShaderStorageBufferArrayNonUniformIndexing(VK_TRUE)
+		.setShaderSampledImageArrayNonUniformIndexing(VK_TRUE);
+}
+
+void BindlessTable::create(vk::Device device, uint32_t maxBuffers, uint32_t maxImages)
+{
+	this->device = device;
+	buffers = { maxBuffers, 0 };
+	images = { maxImages, 0 };
+
+	vk::DescriptorSetLayoutBinding bindings[] = {
+		vk::DescriptorSetLayoutBinding()
+			.setBinding(BUFFER_BINDING)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+			.setDescriptorCount(maxBuffers)
+			.setStageFlags(vk::ShaderStageFlagBits::eAll),
+		vk::DescriptorSetLayoutBinding()
+			.setBinding(IMAGE_BINDING)
+			.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+			.setDescriptorCount(maxImages)
+			.setStageFlags(vk::ShaderStageFlagBits::eAll)
+	};
+	vk::DescriptorBindingFlagsEXT flags = vk::DescriptorBindingFlagBitsEXT::ePartiallyBound |
+		vk::DescriptorBindingFlagBitsEXT::eUpdateAfterBind;
+	vk::DescriptorBindingFlagsEXT bindingFlags[] = { flags, flags };
+	vk::DescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo = vk::DescriptorSetLayoutBindingFlagsCreateInfoEXT()
+		.setBindingCount(2)
+		.setPBindingFlags(bindingFlags);
+	vk::DescriptorSetLayoutCreateInfo layoutInfo = vk::DescriptorSetLayoutCreateInfo()
+		.setPNext(&bindingFlagsInfo)
+		.setFlags(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPoolEXT)
+		.setBindingCount(2)
+		.setPBindings(bindings);
+	layout = makeHandle(device, device.createDescriptorSetLayout(layoutInfo));
+
+	vk::DescriptorPoolSize poolSizes[] = {
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, maxBuffers),
+		vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, maxImages)
+	};
+	vk::DescriptorPoolCreateInfo poolInfo = vk::DescriptorPoolCreateInfo()
+		.setFlags(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBindEXT)
+		.setPoolSizeCount(2)
+		.setPPoolSizes(poolSizes)
+		.setMaxSets(1);
+	pool = makeHandle(device, device.createDescriptorPool(poolInfo));
+
+	vk::DescriptorSetLayout setLayouts[] = { layout };
+	vk::DescriptorSetAllocateInfo allocInfo = vk::DescriptorSetAllocateInfo()
+		.setDescriptorPool(pool)
+		.setDescriptorSetCount(1)
+		.setPSetLayouts(setLayouts);
+	set = device.allocateDescriptorSets(allocInfo)[0];
+}
+
+void BindlessTable::destroy()
+{
+	if (!device) {
+		return;
+	}
+	pool.reset();
+	layout.reset();
+	set = nullptr;
+	buffers = { 0, 0 };
+	images = { 0, 0 };
+}
+
+uint32_t BindlessTable::addBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range)
+{
+	uint32_t index = buffers.take();
+	vk::DescriptorBufferInfo bufferInfo(buffer, offset, range);
+	vk::WriteDescriptorSet write = vk::WriteDescriptorSet()
+		.setDstSet(set)
+		.setDstBinding(BUFFER_BINDING)
+		.setDstArrayElement(index)
+		.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+		.setDescriptorCount(1)
+		.setPBufferInfo(&bufferInfo);
+	device.updateDescriptorSets({ write }, nullptr);
+	return index;
+}
+
+uint32_t BindlessTable::addImage(vk::Sampler sampler, vk::ImageView imageView, vk::ImageLayout imageLayout)
+{
+	uint32_t index = images.take();
+	vk::DescriptorImageInfo imageInfo(sampler, imageView, imageLayout);
+	vk::WriteDescriptorSet write = vk::WriteDescriptorSet()
+		.setDstSet(set)
+		.setDstBinding(IMAGE_BINDING)
+		.setDstArrayElement(index)
+		.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+		.setDescriptorCount(1)
+		.setPImageInfo(&imageInfo);
+	device.updateDescriptorSets({ write }, nullptr);
+	return index;
+}
+
+void BindlessTable::removeBuffer(uint32_t index)
+{
+	// Partially bound, so the stale descriptor can stay until the slot is reused
+	buffers.free.push_back(index);
+}
+
+void BindlessTable::removeImage(uint32_t index)
+{
+	images.free.push_back(index);
+}
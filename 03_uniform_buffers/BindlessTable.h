@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vulkan\vulkan.hpp>
+#include <vector>
+
+#include "Handle.h"
+
+// One descriptor set holding every buffer and image the application
+// registers, for VK_EXT_descriptor_indexing. Binding 0 is an array of
+// storage buffers and binding 1 an array of combined image samplers;
+// shaders index them with IDs taken from push constants, so the set is
+// bound once per command buffer instead of once per draw. Both arrays are
+// partially bound and update-after-bind: slots can be written while the
+// set is bound, as long as no frame in flight reads the slot being changed.
+class BindlessTable
+{
+private:
+	vk::Device device;
+	DeviceHandle<vk::DescriptorSetLayout> layout;
+	DeviceHandle<vk::DescriptorPool> pool;
+	vk::DescriptorSet set;
+
+	struct Slots {
+		uint32_t capacity;
+		uint32_t next;
+		std::vector<uint32_t> free;
+
+		uint32_t take();
+	};
+	Slots buffers;
+	Slots images;
+public:
+	static const uint32_t BUFFER_BINDING;
+	static const uint32_t IMAGE_BINDING;
+	// Device extensions to enable alongside requiredFeatures()
+	static const std::vector<const char*> EXTENSIONS;
+
+	BindlessTable();
+	~BindlessTable();
+
+	// Whether the device has the extensions and features the table relies
+	// on. Needs a 1.1 instance to query them.
+	static bool supported(vk::PhysicalDevice physicalDevice);
+	static vk::PhysicalDeviceDescriptorIndexingFeaturesEXT requiredFeatures();
+
+	void create(vk::Device device, uint32_t maxBuffers = 1024, uint32_t maxImages = 4096);
+	void destroy();
+
+	// Each returns the index shaders use to reach the resource. Throws when
+	// the array is full.
+	uint32_t addBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = VK_WHOLE_SIZE);
+	uint32_t addImage(vk::Sampler sampler, vk::ImageView imageView,
+		vk::ImageLayout imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal);
+	// Frees an index for reuse; the caller makes sure no frame still reads it
+	void removeBuffer(uint32_t index);
+	void removeImage(uint32_t index);
+
+	inline vk::DescriptorSetLayout setLayout() const { return layout; }
+	inline vk::DescriptorSet descriptorSet() const { return set; }
+	inline uint32_t bufferCount() const { return buffers.next - (uint32_t)buffers.free.size(); }
+	inline uint32_t imageCount() const { return images.next - (uint32_t)images.free.size(); }
+};
@@ -0,0 +1,287 @@
+#include "DebugMessenger.h"
+
+#include <Windows.h>
+#include <cstring>
+#include <sstream>
+
+const DebugFilter DebugFilter::DEFAULT = {
+	VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+	VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
+		VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT,
+	50,
+	std::chrono::milliseconds(1000)
+};
+
+static int64_t ticks()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void copyText(char* to, size_t size, const char* from)
+{
+	if (from == nullptr) {
+		to[0] = '\0';
+		return;
+	}
+	strncpy(to, from, size - 1);
+	to[size - 1] = '\0';
+}
+
+static const char* severityName(VkDebugUtilsMessageSeverityFlagBitsEXT severity)
+{
+	switch (severity) {
+	case VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT:
+		return "error";
+	case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT:
+		return "warning";
+	case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT:
+		return "info";
+	default:
+		return "verbose";
+	}
+}
+
+static const char* typeName(VkDebugUtilsMessageTypeFlagsEXT types)
+{
+	if (types & VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT) {
+		return "validation";
+	}
+	if (types & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT) {
+		return "performance";
+	}
+	return "general";
+}
+
+DebugMessenger::DebugMessenger()
+	: instance(VK_NULL_HANDLE)
+	, messenger(VK_NULL_HANDLE)
+	, destroyMessenger(nullptr)
+	, filter(DebugFilter::DEFAULT)
+	, windowStart(0)
+	, windowCount(0)
+	, logged(0)
+	, repeats(0)
+	, rateLimited(0)
+	, overflowed(0)
+	, reportedDropped(0)
+	, running(false)
+{
+	for (auto& slot : ids) {
+		slot.key.store(0, std::memory_order_relaxed);
+		slot.lastLogged.store(0, std::memory_order_relaxed);
+		slot.suppressed.store(0, std::memory_order_relaxed);
+	}
+}
+
+DebugMessenger::~DebugMessenger()
+{
+}
+
+void DebugMessenger::create(vk::Instance instance, const DebugFilter& filter)
+{
+	this->instance = (VkInstance)instance;
+	this->filter = filter;
+
+	auto createMessenger = (PFN_vkCreateDebugUtilsMessengerEXT)
+		vkGetInstanceProcAddr(this->instance, "vkCreateDebugUtilsMessengerEXT");
+	destroyMessenger = (PFN_vkDestroyDebugUtilsMessengerEXT)
+		vkGetInstanceProcAddr(this->instance, "vkDestroyDebugUtilsMessengerEXT");
+	if (createMessenger == nullptr || destroyMessenger == nullptr) {
+		throw std::runtime_error("failed to set up debug messenger!");
+	}
+
+	running = true;
+	logger = std::thread([this]() {
+		auto lastReport = std::chrono::steady_clock::now();
+		while (running) {
+			drain();
+			auto now = std::chrono::steady_clock::now();
+			if (now - lastReport >= std::chrono::seconds(1)) {
+				reportSuppressed();
+				lastReport = now;
+			}
+			// Nothing on the calling side may block, so there is nothing to
+			// wake the logger; polling this often costs next to nothing
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		}
+	});
+
+	VkDebugUtilsMessengerCreateInfoEXT createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+	createInfo.messageSeverity = filter.severities;
+	createInfo.messageType = filter.types;
+	createInfo.pfnUserCallback = callback;
+	createInfo.pUserData = this;
+
+	if (createMessenger(this->instance, &createInfo, nullptr, &messenger) != VK_SUCCESS) {
+		destroy();
+		throw std::runtime_error("failed to set up debug messenger!");
+	}
+}
+
+void DebugMessenger::destroy()
+{
+	if (messenger != VK_NULL_HANDLE) {
+		destroyMessenger(instance, messenger, nullptr);
+		messenger = VK_NULL_HANDLE;
+	}
+	if (!logger.joinable()) {
+		return;
+	}
+	running = false;
+	logger.join();
+	drain();
+	reportSuppressed();
+
+	std::ostringstream summary;
+	summary << "debug messenger: " << logged << " logged, " << repeats << " repeats, "
+		<< rateLimited << " over the rate limit, " << overflowed << " lost to a full queue\n";
+	OutputDebugStringA(summary.str().c_str());
+}
+
+VkDebugUtilsMessageSeverityFlagsEXT DebugMessenger::parseSeverity(const std::string& name)
+{
+	VkDebugUtilsMessageSeverityFlagsEXT severities = VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+	if (name == "error") {
+		return severities;
+	}
+	severities |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+	if (name == "info") {
+		severities |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT;
+	}
+	else if (name == "verbose") {
+		severities |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT |
+			VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+	}
+	return severities;
+}
+
+VkDebugUtilsMessageTypeFlagsEXT DebugMessenger::parseTypes(const std::string& names)
+{
+	VkDebugUtilsMessageTypeFlagsEXT types = 0;
+	std::istringstream list(names);
+	std::string name;
+	while (std::getline(list, name, ',')) {
+		if (name == "general") {
+			types |= VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT;
+		}
+		else if (name == "validation") {
+			types |= VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT;
+		}
+		else if (name == "performance") {
+			types |= VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+		}
+	}
+	return types != 0 ? types : DebugFilter::DEFAULT.types;
+}
+
+VKAPI_ATTR VkBool32 VKAPI_CALL DebugMessenger::callback(
+	VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+	VkDebugUtilsMessageTypeFlagsEXT types,
+	const VkDebugUtilsMessengerCallbackDataEXT* data,
+	void* userData)
+{
+	((DebugMessenger*)userData)->receive(severity, types, data);
+	return VK_FALSE;
+}
+
+DebugMessenger::IdSlot* DebugMessenger::slot(int32_t id)
+{
+	int64_t key = (int64_t)(uint32_t)id | (1ll << 32);
+	size_t start = ((uint32_t)id * 2654435761u) % ID_SLOTS;
+	for (size_t i = 0; i < ID_SLOTS; i++) {
+		IdSlot& candidate = ids[(start + i) % ID_SLOTS];
+		int64_t current = candidate.key.load(std::memory_order_acquire);
+		if (current == 0 && candidate.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+			return &candidate;
+		}
+		if (current == key) {
+			return &candidate;
+		}
+	}
+	// More distinct ids than slots; the rest are only rate limited
+	return nullptr;
+}
+
+// Runs on whichever thread made the Vulkan call, so it never locks or
+// allocates and does as little as it can
+void DebugMessenger::receive(VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+	VkDebugUtilsMessageTypeFlagsEXT types,
+	const VkDebugUtilsMessengerCallbackDataEXT* data)
+{
+	int64_t now = ticks();
+	int64_t interval = std::chrono::duration_cast<std::chrono::nanoseconds>(filter.repeatInterval).count();
+
+	IdSlot* id = slot(data->messageIdNumber);
+	if (id != nullptr) {
+		int64_t last = id->lastLogged.load(std::memory_order_relaxed);
+		// Losing the exchange means another thread is logging this id right now
+		if ((last != 0 && now - last < interval) ||
+			!id->lastLogged.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+			id->suppressed.fetch_add(1, std::memory_order_relaxed);
+			repeats.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	}
+
+	// A rough limiter: a reset racing an increment may let one extra through
+	const int64_t second = 1000000000;
+	int64_t start = windowStart.load(std::memory_order_relaxed);
+	if (now - start >= second && windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+		windowCount.store(0, std::memory_order_relaxed);
+	}
+	if (windowCount.fetch_add(1, std::memory_order_relaxed) >= filter.maxPerSecond) {
+		rateLimited.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	Message message;
+	message.severity = severity;
+	message.types = types;
+	message.id = data->messageIdNumber;
+	copyText(message.name, sizeof(message.name), data->pMessageIdName);
+	copyText(message.text, sizeof(message.text), data->pMessage);
+	if (!queue.push(message)) {
+		overflowed.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void DebugMessenger::drain()
+{
+	Message message;
+	while (queue.pop(message)) {
+		std::ostringstream line;
+		line << typeName(message.types) << " " << severityName(message.severity);
+		if (message.name[0] != '\0') {
+			line << " [" << message.name << "]";
+		}
+		line << ": " << message.text << "\n";
+		OutputDebugStringA(line.str().c_str());
+		logged++;
+	}
+}
+
+void DebugMessenger::reportSuppressed()
+{
+	for (auto& slot : ids) {
+		int64_t key = slot.key.load(std::memory_order_acquire);
+		if (key == 0) {
+			continue;
+		}
+		uint32_t count = slot.suppressed.exchange(0, std::memory_order_relaxed);
+		if (count > 0) {
+			std::ostringstream line;
+			line << "debug messenger: message id 0x" << std::hex << (uint32_t)key << std::dec
+				<< " repeated " << count << " more times\n";
+			OutputDebugStringA(line.str().c_str());
+		}
+	}
+
+	uint64_t dropped = droppedCount();
+	if (dropped != reportedDropped) {
+		std::ostringstream line;
+		line << "debug messenger: " << dropped - reportedDropped << " messages dropped\n";
+		OutputDebugStringA(line.str().c_str());
+		reportedDropped = dropped;
+	}
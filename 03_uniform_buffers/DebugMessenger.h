@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vulkan\vulkan.hpp>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "MpscQueue.h"
+
+// Which messages the layers hand over, and how many of them get logged
+struct DebugFilter {
+	VkDebugUtilsMessageSeverityFlagsEXT severities;
+	VkDebugUtilsMessageTypeFlagsEXT types;
+	// Across every message id; the rest are counted and dropped
+	uint32_t maxPerSecond;
+	// A message id is logged at most once per interval, repeats are counted
+	std::chrono::milliseconds repeatInterval;
+
+	static const DebugFilter DEFAULT;
+};
+
+// Receives validation messages through VK_EXT_debug_utils without slowing
+// down the thread that made the call. Severity and type filtering happens in
+// the layers, so filtered messages never reach the callback at all. The
+// callback itself only drops repeats of a message id, applies the overall
+// rate limit and copies what is left into a lock-free ring; a logger thread
+// empties the ring and writes it out with OutputDebugStringA, and once a
+// second says how much was suppressed.
+class DebugMessenger
+{
+public:
+	static const size_t QUEUE_SIZE = 256;
+	static const size_t ID_SLOTS = 256;
+private:
+	struct Message {
+		VkDebugUtilsMessageSeverityFlagBitsEXT severity;
+		VkDebugUtilsMessageTypeFlagsEXT types;
+		int32_t id;
+		char name[64];
+		char text[512];
+	};
+
+	// Open-addressed by message id; key is the id with bit 32 set, 0 is free
+	struct IdSlot {
+		std::atomic<int64_t> key;
+		std::atomic<int64_t> lastLogged;	// steady clock ticks, 0 never
+		std::atomic<uint32_t> suppressed;	// since the logger last looked
+	};
+
+	VkInstance instance;
+	VkDebugUtilsMessengerEXT messenger;
+	PFN_vkDestroyDebugUtilsMessengerEXT destroyMessenger;
+	DebugFilter filter;
+
+	MpscQueue<Message, QUEUE_SIZE> queue;
+	IdSlot ids[ID_SLOTS];
+	std::atomic<int64_t> windowStart;
+	std::atomic<uint32_t> windowCount;
+
+	std::atomic<uint64_t> logged;
+	std::atomic<uint64_t> repeats;
+	std::atomic<uint64_t> rateLimited;
+	std::atomic<uint64_t> overflowed;
+	uint64_t reportedDropped;	// logger thread only
+
+	std::thread logger;
+	std::atomic<bool> running;
+
+	static VKAPI_ATTR VkBool32 VKAPI_CALL callback(
+		VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+		VkDebugUtilsMessageTypeFlagsEXT types,
+		const VkDebugUtilsMessengerCallbackDataEXT* data,
+		void* userData);
+
+	void receive(VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+		VkDebugUtilsMessageTypeFlagsEXT types,
+		const VkDebugUtilsMessengerCallbackDataEXT* data);
+	IdSlot* slot(int32_t id);
+	// Logger thread only
+	void drain();
+	void reportSuppressed();
+public:
+	DebugMessenger();
+	~DebugMessenger();
+
+	// The instance must have VK_EXT_debug_utils enabled
+	void create(vk::Instance instance, const DebugFilter& filter = DebugFilter::DEFAULT);
+	// Writes out whatever is still queued
+	void destroy();
+
+	// "verbose", "info", "warning" or "error": that severity and above
+	static VkDebugUtilsMessageSeverityFlagsEXT parseSeverity(const std::string& name);
+	// Comma separated "general", "validation", "performance"; empty is all
+	static VkDebugUtilsMessageTypeFlagsEXT parseTypes(const std::string& names);
+
+	inline uint64_t loggedCount() const { return logged; }
+	// Repeats of an id within repeatInterval
+	inline uint64_t repeatCount() const { return repeats; }
+	// Over maxPerSecond, or the ring was full
+	inline uint64_t droppedCount() const { return rateLimited + overflowed; }
+};
\ No newline at end of file
@@ -0,0 +1,52 @@
+#include "DebugUtils.h"
+
+PFN_vkSetDebugUtilsObjectNameEXT DebugUtils::setObjectName = nullptr;
+PFN_vkCmdBeginDebugUtilsLabelEXT DebugUtils::beginLabel = nullptr;
+PFN_vkCmdEndDebugUtilsLabelEXT DebugUtils::endLabel = nullptr;
+
+void DebugUtils::load(vk::Instance instance)
+{
+	setObjectName = (PFN_vkSetDebugUtilsObjectNameEXT)
+		vkGetInstanceProcAddr((VkInstance)instance, "vkSetDebugUtilsObjectNameEXT");
+	beginLabel = (PFN_vkCmdBeginDebugUtilsLabelEXT)
+		vkGetInstanceProcAddr((VkInstance)instance, "vkCmdBeginDebugUtilsLabelEXT");
+	endLabel = (PFN_vkCmdEndDebugUtilsLabelEXT)
+		vkGetInstanceProcAddr((VkInstance)instance, "vkCmdEndDebugUtilsLabelEXT");
+	// Labels only make sense in pairs
+	if (beginLabel == nullptr || endLabel == nullptr) {
+		beginLabel = nullptr;
+		endLabel = nullptr;
+	}
+}
+
+void DebugUtils::setName(vk::Device device, VkObjectType type, uint64_t object, const char* name)
+{
+	if (setObjectName == nullptr || object == 0) {
+		return;
+	}
+	VkDebugUtilsObjectNameInfoEXT nameInfo = {};
+	nameInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+	nameInfo.objectType = type;
+	nameInfo.objectHandle = object;
+	nameInfo.pObjectName = name;
+	setObjectName((VkDevice)device, &nameInfo);
+}
+
+void DebugUtils::begin(vk::CommandBuffer commandBuffer, const std::string& name)
+{
+	if (beginLabel == nullptr) {
+		return;
+	}
+	VkDebugUtilsLabelEXT label = {};
+	label.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
+	label.pLabelName = name.c_str();
+	beginLabel((VkCommandBuffer)commandBuffer, &label);
+}
+
+void DebugUtils::end(vk::CommandBuffer commandBuffer)
+{
+	if (endLabel == nullptr) {
+		return;
+	}
+	endLabel((VkCommandBuffer)commandBuffer);
+}
\ No newline at end of file
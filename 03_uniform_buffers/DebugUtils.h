@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vulkan\vulkan.hpp>
+#include <string>
+
+#include "Handle.h"
+
+// The C handle type and VkObjectType behind each object that gets a name
+template <typename T>
+struct DebugObjectType;
+
+#define DEBUG_OBJECT_TYPE(TYPE, OBJECT_TYPE)		\
+template <>										\
+struct DebugObjectType<vk::TYPE> {				\
+	typedef Vk##TYPE CType;						\
+	static const VkObjectType value = OBJECT_TYPE;	\
+};
+
+DEBUG_OBJECT_TYPE(Buffer, VK_OBJECT_TYPE_BUFFER)
+DEBUG_OBJECT_TYPE(DeviceMemory, VK_OBJECT_TYPE_DEVICE_MEMORY)
+DEBUG_OBJECT_TYPE(Image, VK_OBJECT_TYPE_IMAGE)
+DEBUG_OBJECT_TYPE(ImageView, VK_OBJECT_TYPE_IMAGE_VIEW)
+DEBUG_OBJECT_TYPE(Pipeline, VK_OBJECT_TYPE_PIPELINE)
+DEBUG_OBJECT_TYPE(CommandBuffer, VK_OBJECT_TYPE_COMMAND_BUFFER)
+
+#undef DEBUG_OBJECT_TYPE
+
+// Object names and command buffer labels through VK_EXT_debug_utils, so
+// RenderDoc and GPU profilers show what each handle and region is. Use the
+// DEBUG_NAME and DEBUG_LABEL macros below rather than calling this directly:
+// with NDEBUG they compile to nothing, name strings included. Until load()
+// has found the extension every call does nothing.
+class DebugUtils
+{
+private:
+	static PFN_vkSetDebugUtilsObjectNameEXT setObjectName;
+	static PFN_vkCmdBeginDebugUtilsLabelEXT beginLabel;
+	static PFN_vkCmdEndDebugUtilsLabelEXT endLabel;
+
+	static void setName(vk::Device device, VkObjectType type, uint64_t object, const char* name);
+public:
+	// The instance must have VK_EXT_debug_utils enabled
+	static void load(vk::Instance instance);
+
+	template <typename T>
+	static inline void name(vk::Device device, T object, const std::string& name)
+	{
+		setName(device, DebugObjectType<T>::value,
+			(uint64_t)(typename DebugObjectType<T>::CType)object, name.c_str());
+	}
+
+	template <typename T>
+	static inline void name(vk::Device device, const DeviceHandle<T>& object, const std::string& name)
+	{
+		DebugUtils::name(device, object.get(), name);
+	}
+
+	static void begin(vk::CommandBuffer commandBuffer, const std::string& name);
+	static void end(vk::CommandBuffer commandBuffer);
+};
+
+// Labels whatever is recorded while it is in scope
+class DebugLabel
+{
+private:
+	vk::CommandBuffer commandBuffer;
+public:
+	DebugLabel(vk::CommandBuffer commandBuffer, const std::string& name)
+		: commandBuffer(commandBuffer)
+	{
+		DebugUtils::begin(commandBuffer, name);
+	}
+
+	~DebugLabel()
+	{
+		DebugUtils::end(commandBuffer);
+	}
+
+	DebugLabel(const DebugLabel&) = delete;
+	DebugLabel& operator=(const DebugLabel&) = delete;
+};
+
+#define DEBUG_LABEL_CONCAT2(a, b) a##b
+#define DEBUG_LABEL_CONCAT(a, b) DEBUG_LABEL_CONCAT2(a, b)
+
+#ifdef NDEBUG
+#define DEBUG_NAME(device, object, objectName)
+#define DEBUG_LABEL(commandBuffer, labelName)
+#define DEBUG_LABEL_BEGIN(commandBuffer, labelName)
+#define DEBUG_LABEL_END(commandBuffer)
+#else
+#define DEBUG_NAME(device, object, objectName) DebugUtils::name(device, object, objectName)
+// Until the end of the enclosing scope
+#define DEBUG_LABEL(commandBuffer, labelName) DebugLabel DEBUG_LABEL_CONCAT(debugLabel, __LINE__)(commandBuffer, labelName)
+// For a region that does not fit one scope
+#define DEBUG_LABEL_BEGIN(commandBuffer, labelName) DebugUtils::begin(commandBuffer, labelName)
+#define DEBUG_LABEL_END(commandBuffer) DebugUtils::end(commandBuffer)
+#endif
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "DescriptorAllocator.h"
+
+#include <stdexcept>
+#include <utility>
+
+// Descriptors of each type reserved per set in a new pool. Generous, since
+// an unused descriptor costs a few bytes while a full pool costs a new one.
+static const std::pair<vk::DescriptorType, float> POOL_RATIOS[] = {
+	{ vk::DescriptorType::eSampler, 0.5f },
+	{ vk::DescriptorType::eCombinedImageSampler, 4.0f },
+	{ vk::DescriptorType::eSampledImage, 4.0f },
+	{ vk::DescriptorType::eStorageImage, 1.0f },
+	{ vk::DescriptorType::eUniformTexelBuffer, 1.0f },
+	{ vk::DescriptorType::eStorageTexelBuffer, 1.0f },
+	{ vk::DescriptorType::eUniformBuffer, 2.0f },
+	{ vk::DescriptorType::eStorageBuffer, 2.0f },
+	{ vk::DescriptorType::eUniformBufferDynamic, 1.0f },
+	{ vk::DescriptorType::eStorageBufferDynamic, 1.0f },
+	{ vk::DescriptorType::eInputAttachment, 0.5f }
+};
+
+DescriptorAllocator::DescriptorAllocator()
+	: setsPerPool(0)
+{
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+}
+
+void DescriptorAllocator::create(vk::Device device, uint32_t setsPerPool)
+{
+	this->device = device;
+	this->setsPerPool = setsPerPool;
+}
+
+void DescriptorAllocator::destroy()
+{
+	usedPools.clear();
+	freePools.clear();
+	current = nullptr;
+}
+
+vk::DescriptorPool DescriptorAllocator::grabPool()
+{
+	DeviceHandle<vk::DescriptorPool> pool;
+	if (!freePools.empty()) {
+		pool = std::move(freePools.back());
+		freePools.pop_back();
+	}
+	else {
+		std::vector<vk::DescriptorPoolSize> poolSizes;
+		for (const auto& ratio : POOL_RATIOS) {
+			poolSizes.push_back(vk::DescriptorPoolSize()
+				.setType(ratio.first)
+				.setDescriptorCount((uint32_t)(ratio.second * setsPerPool)));
+		}
+		vk::DescriptorPoolCreateInfo poolInfo = vk::DescriptorPoolCreateInfo()
+			.setPoolSizeCount((uint32_t)poolSizes.size())
+			.setPPoolSizes(poolSizes.data())
+			.setMaxSets(setsPerPool);
+		pool = makeHandle(device, device.createDescriptorPool(poolInfo));
+	}
+	usedPools.push_back(std::move(pool));
+	return usedPools.back();
+}
+
+vk::DescriptorSet DescriptorAllocator::allocate(vk::DescriptorSetLayout layout)
+{
+	if (!current) {
+		current = grabPool();
+	}
+
+	// The pointer overload reports failure through its result instead of
+	// throwing and does not build a std::vector per call
+	vk::DescriptorSetAllocateInfo allocInfo = vk::DescriptorSetAllocateInfo()
+		.setDescriptorPool(current)
+		.setDescriptorSetCount(1)
+		.setPSetLayouts(&layout);
+	vk::DescriptorSet set;
+	vk::Result result = device.allocateDescriptorSets(&allocInfo, &set);
+	if (result == vk::Result::eErrorOutOfPoolMemory || result == vk::Result::eErrorFragmentedPool) {
+		current = grabPool();
+		allocInfo.setDescriptorPool(current);
+		result = device.allocateDescriptorSets(&allocInfo, &set);
+	}
+	if (result != vk::Result::eSuccess) {
+		throw std::runtime_error("failed to allocate descriptor set!");
+	}
+	return set;
+}
+
+void DescriptorAllocator::reset()
+{
+	for (auto& pool : usedPools) {
+		device.resetDescriptorPool(pool);
+		freePools.push_back(std::move(pool));
+	}
+	usedPools.clear();
+	current = nullptr;
+}
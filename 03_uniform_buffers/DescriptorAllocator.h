@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vulkan\vulkan.hpp>
+#include <vector>
+
+#include "Handle.h"
+
+// Hands out descriptor sets from a growable list of pools. When the current
+// pool runs dry another one is taken (or created) and the allocation is
+// retried, so callers never see eErrorOutOfPoolMemory. reset() recycles
+// every pool at once, which makes one allocator per frame in flight a cheap
+// home for transient sets: allocate freely while recording, reset when the
+// frame's fence has signalled.
+class DescriptorAllocator
+{
+private:
+	vk::Device device;
+	uint32_t setsPerPool;
+	vk::DescriptorPool current;	// one of usedPools
+	std::vector<DeviceHandle<vk::DescriptorPool>> usedPools;
+	std::vector<DeviceHandle<vk::DescriptorPool>> freePools;
+
+	vk::DescriptorPool grabPool();
+public:
+	DescriptorAllocator();
+	~DescriptorAllocator();
+	// Kept by value, one per frame in flight
+	DescriptorAllocator(DescriptorAllocator&&) = default;
+	DescriptorAllocator& operator=(DescriptorAllocator&&) = default;
+
+	void create(vk::Device device, uint32_t setsPerPool = 256);
+	void destroy();
+
+	vk::DescriptorSet allocate(vk::DescriptorSetLayout layout);
+	// Returns every set allocated so far to the pools
+	void reset();
+
+	inline size_t poolCount() const { return usedPools.size() + freePools.size(); }
+};
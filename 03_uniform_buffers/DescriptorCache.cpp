@@ -0,0 +1,96 @@
+#include "DescriptorCache.h"
+
+static uint64_t mix(uint64_t h, uint64_t value)
+{
+	// FNV-1a, one 64-bit value at a time
+	h ^= value;
+	return h * 1099511628211ull;
+}
+
+static bool sameBindings(const std::vector<DescriptorBinding>& a, const std::vector<DescriptorBinding>& b)
+{
+	if (a.size() != b.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < a.size(); i++) {
+		if (a[i].binding != b[i].binding || a[i].type != b[i].type ||
+			a[i].buffer != b[i].buffer || a[i].image != b[i].image) {
+			return false;
+		}
+	}
+	return true;
+}
+
+DescriptorBinding DescriptorBinding::forBuffer(uint32_t binding, vk::DescriptorType type,
+	vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range)
+{
+	return { binding, type, vk::DescriptorBufferInfo(buffer, offset, range), vk::DescriptorImageInfo() };
+}
+
+DescriptorBinding DescriptorBinding::forImage(uint32_t binding, vk::DescriptorType type,
+	vk::Sampler sampler, vk::ImageView imageView, vk::ImageLayout imageLayout)
+{
+	return { binding, type, vk::DescriptorBufferInfo(), vk::DescriptorImageInfo(sampler, imageView, imageLayout) };
+}
+
+DescriptorCache::DescriptorCache()
+{
+}
+
+DescriptorCache::~DescriptorCache()
+{
+}
+
+void DescriptorCache::create(vk::Device device)
+{
+	this->device = device;
+	allocator.create(device);
+}
+
+void DescriptorCache::destroy()
+{
+	allocator.destroy();
+	sets.clear();
+}
+
+vk::DescriptorSet DescriptorCache::get(vk::DescriptorSetLayout layout, const std::vector<DescriptorBinding>& bindings)
+{
+	uint64_t key = mix(14695981039346656037ull, (uint64_t)(VkDescriptorSetLayout)layout);
+	for (const auto& binding : bindings) {
+		key = mix(key, binding.binding);
+		key = mix(key, (uint64_t)binding.type);
+		key = mix(key, (uint64_t)(VkBuffer)binding.buffer.buffer);
+		key = mix(key, binding.buffer.offset);
+		key = mix(key, binding.buffer.range);
+		key = mix(key, (uint64_t)(VkImageView)binding.image.imageView);
+		key = mix(key, (uint64_t)(VkSampler)binding.image.sampler);
+	}
+	auto range = sets.equal_range(key);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second.layout == layout && sameBindings(it->second.bindings, bindings)) {
+			return it->second.set;
+		}
+	}
+
+	vk::DescriptorSet set = allocator.allocate(layout);
+	std::vector<vk::WriteDescriptorSet> writes;
+	for (const auto& binding : bindings) {
+		vk::WriteDescriptorSet write = vk::WriteDescriptorSet()
+			.setDstSet(set)
+			.setDstBinding(binding.binding)
+			.setDstArrayElement(0)
+			.setDescriptorType(binding.type)
+			.setDescriptorCount(1);
+		if (binding.buffer.buffer) {
+			write.setPBufferInfo(&binding.buffer);
+		}
+		else {
+			write.setPImageInfo(&binding.image);
+		}
+		writes.push_back(write);
+	}
+	device.updateDescriptorSets(writes, nullptr);
+
+	sets.insert({ key, { layout, bindings, set } });
+	return set;
+}
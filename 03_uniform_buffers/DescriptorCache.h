@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vulkan\vulkan.hpp>
+#include <unordered_map>
+#include <vector>
+
+#include "DescriptorAllocator.h"
+
+// One resource written into a descriptor set
+struct DescriptorBinding {
+	uint32_t binding;
+	vk::DescriptorType type;
+	vk::DescriptorBufferInfo buffer;
+	vk::DescriptorImageInfo image;
+
+	static DescriptorBinding forBuffer(uint32_t binding, vk::DescriptorType type,
+		vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range);
+	static DescriptorBinding forImage(uint32_t binding, vk::DescriptorType type,
+		vk::Sampler sampler, vk::ImageView imageView, vk::ImageLayout imageLayout);
+};
+
+// Descriptor sets that never change after they are written, looked up by
+// their layout and contents. Asking twice for the same bindings returns the
+// same set, so sets can be requested wherever they are needed without
+// allocating or writing again. The resources must outlive the cache.
+class DescriptorCache
+{
+private:
+	struct Entry {
+		vk::DescriptorSetLayout layout;
+		std::vector<DescriptorBinding> bindings;
+		vk::DescriptorSet set;
+	};
+
+	vk::Device device;
+	DescriptorAllocator allocator;
+	std::unordered_multimap<uint64_t, Entry> sets;
+public:
+	DescriptorCache();
+	~DescriptorCache();
+
+	void create(vk::Device device);
+	void destroy();
+
+	vk::DescriptorSet get(vk::DescriptorSetLayout layout, const std::vector<DescriptorBinding>& bindings);
+
+	inline size_t size() const { return sets.size(); }
+};
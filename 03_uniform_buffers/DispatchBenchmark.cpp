@@ -0,0 +1,84 @@
+#include "DispatchBenchmark.h"
+#include "Observable.h"
+
+#include <Windows.h>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <vector>
+
+namespace {
+	// Observable as it was before the flat table
+	template <typename MSG, typename ... ARGS>
+	class MapObservable {
+	private:
+		std::map<MSG, std::function<void(ARGS...)>> callbacks;
+	public:
+		void observe(MSG msg, std::function<void(ARGS...)> callback) {
+			callbacks[msg] = callback;
+		}
+
+		void invoke(MSG msg, ARGS... args) {
+			if (callbacks.find(msg) != callbacks.end()) {
+				callbacks[msg](std::forward<ARGS>(args)...);
+			}
+		}
+	};
+
+	// What a window sees per second or so of moving the mouse over it
+	const UINT STREAM[] = {
+		WM_MOUSEMOVE, WM_NCHITTEST, WM_SETCURSOR, WM_MOUSEMOVE, WM_NCHITTEST, WM_SETCURSOR,
+		WM_MOUSEMOVE, WM_TIMER, WM_MOUSEMOVE, WM_NCHITTEST, WM_SETCURSOR, WM_PAINT,
+		WM_MOUSEMOVE, WM_KEYDOWN, WM_CHAR, WM_KEYUP, WM_MOUSEMOVE, WM_SIZE,
+	};
+
+	// Observed messages, as many as a window with input handling would have
+	const UINT OBSERVED[] = {
+		WM_CREATE, WM_DESTROY, WM_CLOSE, WM_SIZE, WM_PAINT, WM_MOUSEMOVE,
+		WM_KEYDOWN, WM_KEYUP, WM_CHAR, WM_TIMER, WM_LBUTTONDOWN, WM_LBUTTONUP,
+	};
+
+	template <typename OBSERVABLE>
+	double run(OBSERVABLE& observable, uint32_t messages)
+	{
+		const size_t length = sizeof(STREAM) / sizeof(STREAM[0]);
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < messages; i++) {
+			observable.invoke(STREAM[i % length], (WPARAM)i, (LPARAM)0);
+		}
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / messages;
+	}
+}
+
+DispatchTimings DispatchBenchmark::measure(uint32_t messages)
+{
+	// volatile so the calls cannot be folded away
+	volatile WPARAM sink = 0;
+	auto observer = [&sink](WPARAM wParam, LPARAM lParam) { sink = sink + wParam + lParam; };
+
+	MapObservable<UINT, WPARAM, LPARAM> map;
+	Observable<UINT, WPARAM, LPARAM> flat;
+	for (UINT msg : OBSERVED) {
+		map.observe(msg, observer);
+		flat.observe(msg, observer);
+	}
+
+	DispatchTimings timings;
+	timings.observed = 0;
+	for (uint32_t i = 0; i < messages; i++) {
+		UINT msg = STREAM[i % (sizeof(STREAM) / sizeof(STREAM[0]))];
+		for (UINT observed : OBSERVED) {
+			if (msg == observed) {
+				timings.observed++;
+				break;
+			}
+		}
+	}
+
+	// Warm both up once so neither pays for first touches
+	run(map, messages / 10);
+	run(flat, messages / 10);
+	timings.mapNs = run(map, messages);
+	timings.flatNs = run(flat, messages);
+	return timings;
+}
\ No newline at end of file
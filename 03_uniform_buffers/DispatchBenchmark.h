@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+struct DispatchTimings {
+	double mapNs;	// per message, std::map of std::function, one observer per message
+	double flatNs;	// per message, Observable
+	uint32_t observed;	// messages in the stream that had an observer
+};
+
+// Times window message dispatch through Observable against the std::map
+// table it replaced, on the same recorded-looking stream of messages:
+// mostly mouse moves and timers, some of them with no observer at all.
+// Runs entirely on the CPU.
+class DispatchBenchmark
+{
+public:
+	static DispatchTimings measure(uint32_t messages = 1000000);
+};
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include "FrameCapture.h"
+
+#include <Windows.h>
+#include <algorithm>
+#include <cmath>
+
+static float halfToFloat(uint16_t half)
+{
+	int exponent = (half >> 10) & 0x1f;
+	float mantissa = (float)(half & 0x3ff);
+	float value = exponent == 0 ? std::ldexp(mantissa, -24) :
+		exponent == 31 ? INFINITY : std::ldexp(mantissa + 1024.0f, exponent - 25);
+	return half & 0x8000 ? -value : value;
+}
+
+static uint8_t toByte(float value)
+{
+	return (uint8_t)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+FrameCapture::FrameCapture()
+	: stopping(false)
+{
+}
+
+FrameCapture::~FrameCapture()
+{
+}
+
+void FrameCapture::create(vk::Device device, vk::PhysicalDevice physicalDevice,
+	std::function<void(const std::string&, const RgbImage&)> written)
+{
+	// Two slots: one being copied while the last is read
+	ring.create(device, physicalDevice, 2);
+	this->written = written;
+	stopping = false;
+	worker = std::thread([this]() {
+		run();
+	});
+}
+
+void FrameCapture::destroy()
+{
+	if (!worker.joinable()) {
+		return;
+	}
+	ring.flush([this](const ReadbackFrame& frame) {
+		ready(frame);
+	});
+	ring.destroy();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	worker.join();
+	requests.clear();
+}
+
+void FrameCapture::request(uint64_t frame, const std::string& path)
+{
+	requests.push_back({ frame, path });
+}
+
+bool FrameCapture::due(uint64_t frame) const
+{
+	return std::any_of(requests.begin(), requests.end(), [frame](const Request& r) {
+		return r.frame == frame;
+	});
+}
+
+bool FrameCapture::record(vk::CommandBuffer commandBuffer, vk::Image image, vk::Format format,
+	vk::Extent2D extent, uint64_t frame)
+{
+	auto request = std::find_if(requests.begin(), requests.end(), [frame](const Request& r) {
+		return r.frame == frame;
+	});
+	if (request == requests.end()) {
+		return false;
+	}
+	if (ReadbackRing::pixelSize(format) == 0) {
+		OutputDebugStringA(("cannot capture " + vk::to_string(format) + " images\n").c_str());
+		requests.erase(request);
+		return false;
+	}
+	// Both slots busy; try again next frame
+	bool recorded = ring.record(commandBuffer, image, format, extent, frame);
+	if (!recorded) {
+		request->frame++;
+	}
+	return recorded;
+}
+
+void FrameCapture::submitted(vk::Queue queue)
+{
+	ring.submitted(queue);
+}
+
+void FrameCapture::poll()
+{
+	ring.poll([this](const ReadbackFrame& frame) {
+		ready(frame);
+	});
+}
+
+void FrameCapture::ready(const ReadbackFrame& frame)
+{
+	// The mapped copy is only ours until this returns, so convert it here
+	// and leave the encoding to the worker
+	auto request = std::find_if(requests.begin(), requests.end(), [&frame](const Request& r) {
+		return r.frame == frame.frame;
+	});
+	if (request == requests.end()) {
+		return;
+	}
+	Job job = { request->path, convert(frame) };
+	requests.erase(request);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	wake.notify_one();
+}
+
+void FrameCapture::run()
+{
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (jobs.empty()) {
+				return;
+			}
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		try {
+			ImageFile::write(job.path, job.image);
+			OutputDebugStringA(("captured " + job.path + "\n").c_str());
+			if (written) {
+				written(job.path, job.image);
+			}
+		}
+		catch (const std::exception& e) {
+			OutputDebugStringA(("capture failed: " + std::string(e.what()) + "\n").c_str());
+		}
+	}
+}
+
+RgbImage FrameCapture::convert(const ReadbackFrame& frame)
+{
+	RgbImage image = { frame.extent.width, frame.extent.height };
+	image.pixels.resize((size_t)image.width * image.height * 3);
+	uint8_t* out = image.pixels.data();
+	for (uint32_t y = 0; y < image.height; y++) {
+		const uint8_t* row = frame.data + (size_t)y * frame.rowPitch;
+		for (uint32_t x = 0; x < image.width; x++, out += 3) {
+			switch (frame.format) {
+			case vk::Format::eB8G8R8A8Unorm:
+			case vk::Format::eB8G8R8A8Srgb:
+				out[0] = row[x * 4 + 2];
+				out[1] = row[x * 4 + 1];
+				out[2] = row[x * 4];
+				break;
+			case vk::Format::eA2B10G10R10UnormPack32:
+			case vk::Format::eA2R10G10B10UnormPack32: {
+				// Top 8 of each 10 bits; red is low in A2B10G10R10
+				uint32_t packed = ((const uint32_t*)row)[x];
+				uint8_t low = (uint8_t)(packed >> 2), mid = (uint8_t)(packed >> 12), high = (uint8_t)(packed >> 22);
+				bool rgb = frame.format == vk::Format::eA2B10G10R10UnormPack32;
+				out[0] = rgb ? low : high;
+				out[1] = mid;
+				out[2] = rgb ? high : low;
+				break;
+			}
+			case vk::Format::eR16G16B16A16Sfloat: {
+				// Linear and possibly above 1.0; clipped, not tone mapped
+				const uint16_t* half = (const uint16_t*)row + x * 4;
+				for (int c = 0; c < 3; c++) {
+					out[c] = toByte(halfToFloat(half[c]));
+				}
+				break;
+			}
+			default:
+				out[0] = row[x * 4];
+				out[1] = row[x * 4 + 1];
+				out[2] = row[x * 4 + 2];
+				break;
+			}
+		}
+	}
+	return image;
+}
\ No newline at end of file
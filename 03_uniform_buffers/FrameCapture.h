@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vulkan\vulkan.hpp>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ImageFile.h"
+#include "ReadbackRing.h"
+
+// Saves chosen frames to disk. The copy out of the swap chain image goes
+// through a ReadbackRing, so the frame loop never waits for it, and the
+// encoding and writing happen on a worker thread.
+class FrameCapture
+{
+private:
+	struct Request {
+		uint64_t frame;
+		std::string path;
+	};
+
+	struct Job {
+		std::string path;
+		RgbImage image;
+	};
+
+	ReadbackRing ring;
+	std::vector<Request> requests;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<Job> jobs;
+	bool stopping;
+	std::thread worker;
+	std::function<void(const std::string&, const RgbImage&)> written;
+
+	void run();
+	void ready(const ReadbackFrame& frame);
+public:
+	FrameCapture();
+	~FrameCapture();
+
+	// written runs on the worker thread after each file has been saved
+	void create(vk::Device device, vk::PhysicalDevice physicalDevice,
+		std::function<void(const std::string&, const RgbImage&)> written = nullptr);
+	// Finishes every capture already requested and recorded
+	void destroy();
+
+	// path ends in .png or .ppm
+	void request(uint64_t frame, const std::string& path);
+	inline bool pending() const { return !requests.empty(); }
+	// Whether record() has a copy to make for frame
+	bool due(uint64_t frame) const;
+
+	// Records the copy of frame's image, in eTransferSrcOptimal, into
+	// commandBuffer; returns false when frame was not requested
+	bool record(vk::CommandBuffer commandBuffer, vk::Image image, vk::Format format, vk::Extent2D extent,
+		uint64_t frame);
+	void submitted(vk::Queue queue);
+	// Picks up finished copies; call once a frame
+	void poll();
+	// Frees the readback buffers while no copy is in flight
+	inline vk::DeviceSize trim() { return ring.trim(); }
+
+	// To 8-bit RGB from any format ReadbackRing can copy
+	static RgbImage convert(const ReadbackFrame& frame);
+};
\ No newline at end of file
@@ -0,0 +1,183 @@
+#include "FramePacer.h"
+
+#include <Windows.h>
+#include <algorithm>
+#include <thread>
+
+// timeBeginPeriod, so a power-saving sleep ends within a millisecond
+#pragma comment(lib, "winmm.lib")
+
+const double FramePacer::DEFAULT_TARGET_FPS = 30.0;
+
+FramePacer::FramePacer()
+	: pacing(PacingMode::LowLatency)
+	, target(DEFAULT_TARGET_FPS)
+	, lastCpu(0)
+	, latency(0.0)
+	, cpu(0.0)
+	, logLatency(0.0)
+	, logLatencies(0)
+	, logCpu(0.0)
+	, logFrames(0)
+{
+}
+
+FramePacer::~FramePacer()
+{
+	if (pacing == PacingMode::PowerSaving) {
+		timeEndPeriod(1);
+	}
+}
+
+PacingMode FramePacer::parse(const std::string& name)
+{
+	if (name == "power-saving") {
+		return PacingMode::PowerSaving;
+	}
+	if (name == "uncapped") {
+		return PacingMode::Uncapped;
+	}
+	return PacingMode::LowLatency;
+}
+
+void FramePacer::setMode(PacingMode mode, double targetFps)
+{
+	// The finer timer resolution costs power itself, so only hold it while
+	// something sleeps on it
+	if (mode == PacingMode::PowerSaving && pacing != PacingMode::PowerSaving) {
+		timeBeginPeriod(1);
+	}
+	else if (mode != PacingMode::PowerSaving && pacing == PacingMode::PowerSaving) {
+		timeEndPeriod(1);
+	}
+	pacing = mode;
+	target = targetFps > 0.0 ? targetFps : DEFAULT_TARGET_FPS;
+	deadline = Clock::now();
+}
+
+std::string FramePacer::name(PacingMode mode)
+{
+	switch (mode) {
+	case PacingMode::LowLatency:
+		return "low-latency";
+	case PacingMode::PowerSaving:
+		return "power-saving";
+	default:
+		return "uncapped";
+	}
+}
+
+vk::PresentModeKHR FramePacer::presentMode(const std::vector<vk::PresentModeKHR>& available) const
+{
+	// FIFO is the only mode every device has to support
+	std::vector<vk::PresentModeKHR> preferred;
+	switch (pacing) {
+	case PacingMode::LowLatency:
+		// Newest frame wins without tearing
+		preferred = { vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eImmediate };
+		break;
+	case PacingMode::PowerSaving:
+		break;
+	case PacingMode::Uncapped:
+		preferred = { vk::PresentModeKHR::eImmediate, vk::PresentModeKHR::eMailbox };
+		break;
+	}
+	for (vk::PresentModeKHR mode : preferred) {
+		if (std::find(available.begin(), available.end(), mode) != available.end()) {
+			return mode;
+		}
+	}
+	return vk::PresentModeKHR::eFifo;
+}
+
+void FramePacer::wait(const std::function<void(std::chrono::nanoseconds)>& waitForGpu)
+{
+	if (pacing != PacingMode::PowerSaving) {
+		return;
+	}
+	Clock::time_point now = Clock::now();
+	Clock::duration interval = std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<double>(1.0 / target));
+	deadline += interval;
+	if (deadline < now) {
+		// Fell behind; start counting again from here rather than rushing
+		// frames out to catch up
+		deadline = now;
+		return;
+	}
+	// Sleep most of the way, then yield out the last millisecond, which a
+	// sleep could overshoot. Waiting on the GPU first sees frames complete
+	// as they do, rather than after the sleep.
+	Clock::time_point wake = deadline - std::chrono::milliseconds(1);
+	if (wake > now && waitForGpu) {
+		waitForGpu(std::chrono::duration_cast<std::chrono::nanoseconds>(wake - now));
+	}
+	if (wake > Clock::now()) {
+		std::this_thread::sleep_until(wake);
+	}
+	while (Clock::now() < deadline) {
+		std::this_thread::yield();
+	}
+}
+
+void FramePacer::sample()
+{
+	sampled = Clock::now();
+}
+
+void FramePacer::submitted(size_t frame)
+{
+	if (frame >= pending.size()) {
+		submittedSamples.resize(frame + 1);
+		pending.resize(frame + 1, false);
+	}
+	submittedSamples[frame] = sampled;
+	pending[frame] = true;
+}
+
+void FramePacer::completed(size_t frame)
+{
+	if (frame >= pending.size() || !pending[frame]) {
+		return;
+	}
+	pending[frame] = false;
+	latency = std::chrono::duration<double, std::milli>(Clock::now() - submittedSamples[frame]).count();
+	logLatency += latency;
+	logLatencies++;
+}
+
+void FramePacer::presented()
+{
+	Clock::time_point now = Clock::now();
+	uint64_t cpuTime = processCpuTime();
+	if (lastCpu != 0) {
+		double wall = std::chrono::duration<double>(now - lastFrame).count();
+		// 100% is one core busy
+		cpu = wall > 0.0 ? (cpuTime - lastCpu) / 1.0e7 / wall * 100.0 : 0.0;
+	}
+	lastFrame = now;
+	lastCpu = cpuTime;
+
+	logCpu += cpu;
+	logFrames++;
+	if (now - lastLog >= std::chrono::seconds(1)) {
+		OutputDebugStringA(("pacing " + name(pacing) + ": " + std::to_string(logFrames) + " fps, " +
+			std::to_string(logLatencies ? logLatency / logLatencies : 0.0) + " ms latency, " +
+			std::to_string(logCpu / logFrames) + "% cpu\n").c_str());
+		lastLog = now;
+		logLatency = 0.0;
+		logLatencies = 0;
+		logCpu = 0.0;
+		logFrames = 0;
+	}
+}
+
+uint64_t FramePacer::processCpuTime()
+{
+	FILETIME creation, exit, kernel, user;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+		return 0;
+	}
+	return ((uint64_t)kernel.dwHighDateTime << 32 | kernel.dwLowDateTime) +
+		((uint64_t)user.dwHighDateTime << 32 | user.dwLowDateTime);
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vulkan\vulkan.hpp>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+enum class PacingMode {
+	LowLatency,	// mailbox where available, input sampled right before recording
+	PowerSaving,	// FIFO, and the render thread sleeps down to targetFps
+	Uncapped	// immediate where available, as many frames as the GPU can take
+};
+
+// Decides how frames are paced: which present mode the swap chain asks for
+// and how long the render thread sleeps between frames. It also measures
+// what each mode costs: latency from sampling input to the frame's fence
+// signalling, and CPU time used by the whole process per second of wall
+// time. Only LowLatency waits for each present; the other modes keep
+// several frames in flight, so latency is taken per frame in flight when
+// its fence is first seen signalled, not when presentKHR returns.
+class FramePacer
+{
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	PacingMode pacing;
+	double target;
+	Clock::time_point deadline;
+	Clock::time_point sampled;
+	std::vector<Clock::time_point> submittedSamples;	// per frame in flight
+	std::vector<bool> pending;
+	Clock::time_point lastFrame;
+	uint64_t lastCpu;	// 100ns units, kernel plus user
+	double latency;
+	double cpu;
+
+	Clock::time_point lastLog;
+	double logLatency;
+	uint32_t logLatencies;
+	double logCpu;
+	uint32_t logFrames;
+
+	static uint64_t processCpuTime();
+public:
+	static const double DEFAULT_TARGET_FPS;
+
+	FramePacer();
+	~FramePacer();
+
+	// A changed present mode only takes effect when the swap chain is recreated
+	void setMode(PacingMode mode, double targetFps = DEFAULT_TARGET_FPS);
+	inline PacingMode mode() const { return pacing; }
+	inline double targetFps() const { return target; }
+	// "low-latency", "power-saving" or "uncapped"; anything else is LowLatency
+	static PacingMode parse(const std::string& name);
+	static std::string name(PacingMode mode);
+
+	vk::PresentModeKHR presentMode(const std::vector<vk::PresentModeKHR>& available) const;
+
+	// Before acquiring an image; in PowerSaving spends whatever is left of
+	// the frame budget first in waitForGpu, given how long it may take, and
+	// then asleep. Returns at once otherwise.
+	void wait(const std::function<void(std::chrono::nanoseconds)>& waitForGpu = nullptr);
+	// When the frame's input and animation state are read
+	void sample();
+	// The frame sampled last went to the queue with the fence of frame
+	void submitted(size_t frame);
+	// frame's fence has been seen signalled; only the first call after
+	// submitted() counts, so the fences can be polled freely
+	void completed(size_t frame);
+	// After presentKHR returns; CPU time and the once a second log
+	void presented();
+
+	// Of the last frame to complete
+	inline double latencyMs() const { return latency; }
+	inline double cpuPercent() const { return cpu; }
+};
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "FrameStream.h"
+
+#include <algorithm>
+
+FrameStream::FrameStream()
+	: depth(0)
+	, stopping(false)
+	, streamed(0)
+	, dropped(0)
+	, skipped(0)
+{
+}
+
+FrameStream::~FrameStream()
+{
+}
+
+void FrameStream::create(vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t slots, size_t queueDepth,
+	Consumer consumer)
+{
+	depth = std::max<size_t>(queueDepth, 1);
+	ring.create(device, physicalDevice, slots + (uint32_t)depth + 1);
+	this->consumer = consumer;
+	stopping = false;
+	streamed = 0;
+	dropped = 0;
+	skipped = 0;
+	worker = std::thread([this]() {
+		run();
+	});
+}
+
+void FrameStream::destroy()
+{
+	if (!worker.joinable()) {
+		return;
+	}
+	ring.wait();
+	ring.lend([this](uint32_t slot, const ReadbackFrame& frame) {
+		push(slot, frame);
+	});
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_one();
+	worker.join();
+	reclaimConsumed();
+	ring.destroy();
+}
+
+bool FrameStream::record(vk::CommandBuffer commandBuffer, vk::Image image, vk::Format format,
+	vk::Extent2D extent, uint64_t frame)
+{
+	bool recorded = ring.record(commandBuffer, image, format, extent, frame);
+	if (!recorded) {
+		skipped++;
+	}
+	return recorded;
+}
+
+void FrameStream::submitted(vk::Queue queue)
+{
+	ring.submitted(queue);
+}
+
+void FrameStream::poll()
+{
+	reclaimConsumed();
+	ring.lend([this](uint32_t slot, const ReadbackFrame& frame) {
+		push(slot, frame);
+	});
+}
+
+void FrameStream::reclaimConsumed()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (uint32_t slot : consumed) {
+		ring.reclaim(slot);
+	}
+	consumed.clear();
+}
+
+void FrameStream::push(uint32_t slot, const ReadbackFrame& frame)
+{
+	// The consumer reads the slot in place; a dropped frame's slot can go
+	// straight back since only this thread reclaims
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (queue.size() == depth) {
+			ring.reclaim(queue.front().slot);
+			queue.pop_front();
+			dropped++;
+		}
+		queue.push_back({ slot, frame });
+	}
+	wake.notify_one();
+}
+
+void FrameStream::run()
+{
+	while (true) {
+		Queued queued;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+			if (queue.empty()) {
+				return;
+			}
+			queued = std::move(queue.front());
+			queue.pop_front();
+		}
+		consumer(queued.frame);
+		streamed++;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			consumed.push_back(queued.slot);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vulkan\vulkan.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ReadbackRing.h"
+
+// Reads back every frame for something other than the display, e.g. an
+// encoder. Copies go through a ReadbackRing; each finished copy stays in
+// its ring slot, which is lent to a bounded queue that a consumer thread
+// drains, and goes back to the ring once the consumer is done with it.
+// When the consumer falls behind the oldest queued frame is dropped, so
+// what it sees is always recent and the frame loop never waits for it.
+// When every ring slot is still being copied into or read, the frame is
+// skipped instead.
+class FrameStream
+{
+public:
+	typedef std::function<void(const ReadbackFrame&)> Consumer;
+private:
+	struct Queued {
+		uint32_t slot;
+		ReadbackFrame frame;
+	};
+
+	ReadbackRing ring;
+	Consumer consumer;
+	size_t depth;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<Queued> queue;
+	std::vector<uint32_t> consumed;	// slots the consumer is done with, reclaimed on the render thread
+	bool stopping;
+	std::thread worker;
+
+	std::atomic<uint64_t> streamed;
+	std::atomic<uint64_t> dropped;
+	std::atomic<uint64_t> skipped;
+
+	void run();
+	void push(uint32_t slot, const ReadbackFrame& frame);
+	void reclaimConsumed();
+public:
+	FrameStream();
+	~FrameStream();
+
+	// consumer runs on the stream's own thread; the frame's data is only
+	// valid until it returns. slots is how many copies may be in flight;
+	// the ring also has a slot for each queued frame and the consumer's.
+	void create(vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t slots, size_t queueDepth,
+		Consumer consumer);
+	// Hands over frames already copied, then stops the consumer
+	void destroy();
+	inline bool active() const { return worker.joinable(); }
+
+	// As ReadbackRing::record(); a frame that finds every slot busy is skipped
+	bool record(vk::CommandBuffer commandBuffer, vk::Image image, vk::Format format, vk::Extent2D extent,
+		uint64_t frame);
+	void submitted(vk::Queue queue);
+	void poll();
+
+	// Frames the consumer has been given, dropped from the queue, and never
+	// read back because the ring was full
+	inline uint64_t streamedFrames() const { return streamed; }
+	inline uint64_t droppedFrames() const { return dropped; }
+	inline uint64_t skippedFrames() const { return skipped; }
+};
\ No newline at end of file
@@ -0,0 +1,653 @@
+#include "GeometryPool.h"
+#include "MeshFile.h"
+#include "StagingRing.h"
+#include "DebugUtils.h"
+
+#include <algorithm>
+#include <cstring>
+
+GeometryPool::GeometryPool()
+	: vertexStride(0)
+	, vertexCapacity(0)
+	, indexCapacity(0)
+	, deviceVertexCapacity(0)
+	, deviceIndexCapacity(0)
+{
+}
+
+GeometryPool::~GeometryPool()
+{
+}
+
+void GeometryPool::create(vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t vertexStride,
+	uint32_t vertexCapacity, uint32_t indexCapacity)
+{
+	this->device = device;
+	this->physicalDevice = physicalDevice;
+	this->vertexStride = vertexStride;
+	this->vertexCapacity = std::max(vertexCapacity, 1u);
+	this->indexCapacity = std::max(indexCapacity, 1u);
+
+	vertexData.resize((size_t)this->vertexStride * this->vertexCapacity);
+	indexData.resize(this->indexCapacity);
+	freeVertices = { { 0, this->vertexCapacity } };
+	freeIndices = { { 0, this->indexCapacity } };
+	meshes.clear();
+	freeMeshIds.clear();
+}
+
+void GeometryPool::destroy()
+{
+	destroyBuffers();
+	vertexData.clear();
+	indexData.clear();
+	meshes.clear();
+	freeMeshIds.clear();
+	freeVertices.clear();
+	freeIndices.clear();
+	dirtyVertices.clear();
+	dirtyIndices.clear();
+	vertexCapacity = indexCapacity = 0;
+}
+
+void GeometryPool::destroyBuffers()
+{
+	vertexBuffer.reset();
+	vertexBufferMemory.reset();
+	indexBuffer.reset();
+	indexBufferMemory.reset();
+	deviceVertexCapacity = deviceIndexCapacity = 0;
+}
+
+const uint32_t GeometryPool::MESHLET_DRAW_COST = 4096;
+
+bool GeometryPool::allocate(std::vector<Range>& freeList, uint32_t count, uint32_t alignment, uint32_t& offset)
+{
+	for (size_t i = 0; i < freeList.size(); i++) {
+		Range range = freeList[i];
+		uint32_t aligned = (range.offset + alignment - 1) / alignment * alignment;
+		uint32_t padding = aligned - range.offset;
+		if (range.count < count + padding) {
+			continue;
+		}
+		offset = aligned;
+		Range tail = { aligned + count, range.count - count - padding };
+		freeList.erase(freeList.begin() + i);
+		if (tail.count > 0) {
+			freeList.insert(freeList.begin() + i, tail);
+		}
+		if (padding > 0) {
+			freeList.insert(freeList.begin() + i, { range.offset, padding });
+		}
+		return true;
+	}
+	return false;
+}
+
+void GeometryPool::release(std::vector<Range>& freeList, uint32_t offset, uint32_t count)
+{
+	if (count == 0) {
+		return;
+	}
+	auto it = std::lower_bound(freeList.begin(), freeList.end(), offset,
+		[](const Range& range, uint32_t value) { return range.offset < value; });
+	it = freeList.insert(it, { offset, count });
+
+	auto next = it + 1;
+	if (next != freeList.end() && it->offset + it->count == next->offset) {
+		it->count += next->count;
+		freeList.erase(next);
+	}
+	if (it != freeList.begin()) {
+		auto prev = it - 1;
+		if (prev->offset + prev->count == it->offset) {
+			prev->count += it->count;
+			freeList.erase(it);
+		}
+	}
+}
+
+void GeometryPool::reserve(uint32_t vertexCount, uint32_t& firstVertex, uint32_t indexUnitCount, uint32_t alignment, uint32_t& firstUnit)
+{
+	bool vertexFit = vertexCount == 0 || allocate(freeVertices, vertexCount, 1, firstVertex);
+	bool indexFit = allocate(freeIndices, indexUnitCount, alignment, firstUnit);
+	if (vertexFit && indexFit) {
+		return;
+	}
+
+	// Give back whichever half succeeded, squeeze out the holes and
+	// grow only if the pool is genuinely full.
+	if (vertexFit) release(freeVertices, firstVertex, vertexCount);
+	if (indexFit) release(freeIndices, firstUnit, indexUnitCount);
+	compact();
+	if (vertexCount > 0 && !allocate(freeVertices, vertexCount, 1, firstVertex)) {
+		grow(vertexCount, 0);
+		allocate(freeVertices, vertexCount, 1, firstVertex);
+	}
+	if (!allocate(freeIndices, indexUnitCount, alignment, firstUnit)) {
+		grow(0, indexUnitCount + alignment);
+		allocate(freeIndices, indexUnitCount, alignment, firstUnit);
+	}
+}
+
+void GeometryPool::grow(uint32_t vertexCount, uint32_t indexCount)
+{
+	if (vertexCount > 0) {
+		uint32_t capacity = std::max(vertexCapacity * 2, vertexCapacity + vertexCount);
+		release(freeVertices, vertexCapacity, capacity - vertexCapacity);
+		vertexCapacity = capacity;
+		vertexData.resize((size_t)vertexStride * vertexCapacity);
+	}
+	if (indexCount > 0) {
+		uint32_t capacity = std::max(indexCapacity * 2, indexCapacity + indexCount);
+		release(freeIndices, indexCapacity, capacity - indexCapacity);
+		indexCapacity = capacity;
+		indexData.resize(indexCapacity);
+	}
+}
+
+uint32_t GeometryPool::newMeshId(const MeshRange& range)
+{
+	uint32_t id;
+	if (!freeMeshIds.empty()) {
+		id = freeMeshIds.back();
+		freeMeshIds.pop_back();
+		meshes[id] = range;
+	}
+	else {
+		id = (uint32_t)meshes.size();
+		meshes.push_back(range);
+	}
+	return id;
+}
+
+void GeometryPool::markDirty(const MeshRange& mesh)
+{
+	if (mesh.pinned) {
+		return;
+	}
+	if (mesh.vertexCount > 0) {
+		dirtyVertices.push_back({ mesh.firstVertex, mesh.vertexCount });
+	}
+	uint32_t units = indexUnits(mesh.indexType);
+	dirtyIndices.push_back({ mesh.firstIndex * units, mesh.indexCount * units });
+}
+
+void GeometryPool::markAllDirty()
+{
+	dirtyVertices.clear();
+	dirtyIndices.clear();
+	for (const auto& mesh : meshes) {
+		if (mesh.live) {
+			markDirty(mesh);
+		}
+	}
+}
+
+void GeometryPool::coalesce(std::vector<Range>& ranges)
+{
+	std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.offset < b.offset; });
+	std::vector<Range> merged;
+	for (const auto& range : ranges) {
+		if (range.count == 0) {
+			continue;
+		}
+		if (!merged.empty() && merged.back().offset + merged.back().count >= range.offset) {
+			uint32_t end = std::max(merged.back().offset + merged.back().count, range.offset + range.count);
+			merged.back().count = end - merged.back().offset;
+		}
+		else {
+			merged.push_back(range);
+		}
+	}
+	ranges.swap(merged);
+}
+
+uint32_t GeometryPool::add(const void* vertices, uint32_t vertexCount, const std::vector<uint32_t>& indices, IndexCompression compression)
+{
+	struct Meshlet {
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		uint32_t minVertex;
+	};
+	std::vector<Meshlet> meshlets;
+	vk::IndexType indexType = vk::IndexType::eUint32;
+
+	if (compression == IndexCompression::Auto) {
+		if (vertexCount <= 0x10000) {
+			indexType = vk::IndexType::eUint16;
+			meshlets.push_back({ 0, (uint32_t)indices.size(), 0 });
+		}
+		else {
+			// Cut the triangle list wherever the referenced vertex span would
+			// stop being addressable by uint16 relative to a base vertex.
+			bool splittable = true;
+			Meshlet current = { 0, 0, 0 };
+			uint32_t lo = ~0u, hi = 0;
+			for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+				uint32_t triLo = std::min(indices[i], std::min(indices[i + 1], indices[i + 2]));
+				uint32_t triHi = std::max(indices[i], std::max(indices[i + 1], indices[i + 2]));
+				if (triHi - triLo > 0xFFFF) {
+					splittable = false;
+					break;
+				}
+				if (current.indexCount > 0 && std::max(hi, triHi) - std::min(lo, triLo) > 0xFFFF) {
+					current.minVertex = lo;
+					meshlets.push_back(current);
+					current = { (uint32_t)i, 0, 0 };
+					lo = ~0u;
+					hi = 0;
+				}
+				lo = std::min(lo, triLo);
+				hi = std::max(hi, triHi);
+				current.indexCount += 3;
+			}
+			if (current.indexCount > 0) {
+				current.minVertex = lo;
+				meshlets.push_back(current);
+			}
+
+			// Each extra meshlet costs a draw; only split when the halved
+			// index traffic pays for it.
+			uint64_t saved = sizeof(uint16_t) * (uint64_t)indices.size();
+			uint64_t cost = (uint64_t)MESHLET_DRAW_COST * (meshlets.size() - 1);
+			if (splittable && !meshlets.empty() && saved > cost) {
+				indexType = vk::IndexType::eUint16;
+			}
+			else {
+				meshlets.clear();
+			}
+		}
+	}
+	if (meshlets.empty()) {
+		meshlets.push_back({ 0, (uint32_t)indices.size(), 0 });
+	}
+
+	uint32_t units = indexUnits(indexType);
+	uint32_t head = NO_MESH;
+	uint32_t previous = NO_MESH;
+	for (size_t m = 0; m < meshlets.size(); m++) {
+		const Meshlet& meshlet = meshlets[m];
+		uint32_t ownedVertices = (m == 0) ? vertexCount : 0;
+		uint32_t firstVertex = 0;
+		uint32_t firstUnit = 0;
+		reserve(ownedVertices, firstVertex, meshlet.indexCount * units, units, firstUnit);
+
+		if (ownedVertices > 0) {
+			memcpy(vertexData.data() + (size_t)vertexStride * firstVertex, vertices, (size_t)vertexStride * ownedVertices);
+		}
+		if (indexType == vk::IndexType::eUint16) {
+			for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+				indexData[firstUnit + i] = (uint16_t)(indices[meshlet.firstIndex + i] - meshlet.minVertex);
+			}
+		}
+		else {
+			memcpy(indexData.data() + firstUnit, indices.data() + meshlet.firstIndex, sizeof(uint32_t) * meshlet.indexCount);
+		}
+
+		MeshRange range = { firstVertex, ownedVertices, firstUnit / units, meshlet.indexCount,
+			indexType, head, meshlet.minVertex, NO_MESH, true, false };
+		uint32_t id = newMeshId(range);
+		if (head == NO_MESH) {
+			head = id;
+			meshes[id].owner = id;
+		}
+		else {
+			meshes[previous].next = id;
+		}
+		previous = id;
+		markDirty(meshes[id]);
+	}
+	return head;
+}
+
+void GeometryPool::remove(uint32_t mesh)
+{
+	if (!meshes[mesh].live) {
+		return;
+	}
+	for (uint32_t id = mesh; id != NO_MESH; id = meshes[id].next) {
+		MeshRange& range = meshes[id];
+		uint32_t units = indexUnits(range.indexType);
+		release(freeVertices, range.firstVertex, range.vertexCount);
+		release(freeIndices, range.firstIndex * units, range.indexCount * units);
+		range.live = false;
+		freeMeshIds.push_back(id);
+	}
+}
+
+void GeometryPool::compact()
+{
+	std::vector<uint32_t> order;
+	for (uint32_t i = 0; i < meshes.size(); i++) {
+		if (meshes[i].live) {
+			order.push_back(i);
+		}
+	}
+
+	// Indices are relative to the owner's firstVertex, so vertex and index
+	// streams can slide independently without rewriting any index data.
+	// Pinned meshes have no CPU copy and stay put; the others pack around
+	// them, which never overlaps since they only ever move downwards.
+	std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+		return meshes[a].firstVertex < meshes[b].firstVertex;
+	});
+	freeVertices.clear();
+	uint32_t cursor = 0;
+	for (uint32_t id : order) {
+		MeshRange& range = meshes[id];
+		if (range.vertexCount == 0) {
+			continue;
+		}
+		if (range.pinned) {
+			release(freeVertices, cursor, range.firstVertex - cursor);
+			cursor = range.firstVertex + range.vertexCount;
+			continue;
+		}
+		if (range.firstVertex != cursor) {
+			memmove(vertexData.data() + (size_t)vertexStride * cursor,
+				vertexData.data() + (size_t)vertexStride * range.firstVertex,
+				(size_t)vertexStride * range.vertexCount);
+			range.firstVertex = cursor;
+		}
+		cursor += range.vertexCount;
+	}
+	release(freeVertices, cursor, vertexCapacity - cursor);
+
+	std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+		return meshes[a].firstIndex * indexUnits(meshes[a].indexType) <
+			meshes[b].firstIndex * indexUnits(meshes[b].indexType);
+	});
+	freeIndices.clear();
+	cursor = 0;
+	for (uint32_t id : order) {
+		MeshRange& range = meshes[id];
+		uint32_t units = indexUnits(range.indexType);
+		uint32_t firstUnit = range.firstIndex * units;
+		if (range.pinned) {
+			release(freeIndices, cursor, firstUnit - cursor);
+			cursor = firstUnit + range.indexCount * units;
+			continue;
+		}
+		uint32_t aligned = (cursor + units - 1) / units * units;
+		release(freeIndices, cursor, aligned - cursor);
+		cursor = aligned;
+
+		if (firstUnit != cursor) {
+			std::copy(indexData.begin() + firstUnit,
+				indexData.begin() + firstUnit + range.indexCount * units,
+				indexData.begin() + cursor);
+			range.firstIndex = cursor / units;
+		}
+		cursor += range.indexCount * units;
+	}
+	release(freeIndices, cursor, indexCapacity - cursor);
+
+	markAllDirty();
+}
+
+vk::DeviceSize GeometryPool::indexBytes(uint32_t mesh) const
+{
+	vk::DeviceSize bytes = 0;
+	for (uint32_t id = mesh; id != NO_MESH; id = meshes[id].next) {
+		bytes += (vk::DeviceSize)sizeof(uint16_t) * indexUnits(meshes[id].indexType) * meshes[id].indexCount;
+	}
+	return bytes;
+}
+
+uint32_t GeometryPool::drawCount(uint32_t mesh) const
+{
+	uint32_t count = 0;
+	for (uint32_t id = mesh; id != NO_MESH; id = meshes[id].next) {
+		count++;
+	}
+	return count;
+}
+
+uint32_t GeometryPool::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const
+{
+	auto memProperties = physicalDevice.getMemoryProperties();
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+		if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			return i;
+		}
+	}
+	throw std::runtime_error("failed to find suitable memory type");
+}
+
+void GeometryPool::createBuffer(
+	vk::DeviceSize size,
+	vk::BufferUsageFlags usage,
+	vk::MemoryPropertyFlags properties,
+	DeviceHandle<vk::Buffer>& buffer,
+	DeviceHandle<vk::DeviceMemory>& bufferMemory,
+	MemoryCategory category,
+	const char* name) const
+{
+	vk::BufferCreateInfo bufferInfo = vk::BufferCreateInfo()
+		.setSize(size)
+		.setUsage(usage)
+		.setSharingMode(vk::SharingMode::eExclusive);
+
+	buffer = makeHandle(device, device.createBuffer(bufferInfo));
+
+	vk::MemoryRequirements memRequirements = device.getBufferMemoryRequirements(buffer);
+
+	vk::MemoryAllocateInfo allocInfo = vk::MemoryAllocateInfo()
+		.setAllocationSize(memRequirements.size)
+		.setMemoryTypeIndex(findMemoryType(memRequirements.memoryTypeBits, properties));
+
+	bufferMemory = makeHandle(device, MemoryTracker::allocate(device, allocInfo, category, size));
+	device.bindBufferMemory(buffer, bufferMemory, 0);
+
+	DEBUG_NAME(device, buffer, name);
+	DEBUG_NAME(device, bufferMemory, name);
+}
+
+void GeometryPool::resize(vk::CommandPool commandPool, vk::Queue queue)
+{
+	if (deviceVertexCapacity == vertexCapacity && deviceIndexCapacity == indexCapacity) {
+		return;
+	}
+
+	DeviceHandle<vk::Buffer> newVertexBuffer, newIndexBuffer;
+	DeviceHandle<vk::DeviceMemory> newVertexBufferMemory, newIndexBufferMemory;
+	createBuffer((vk::DeviceSize)vertexStride * vertexCapacity,
+		vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
+		vk::MemoryPropertyFlagBits::eDeviceLocal,
+		newVertexBuffer, newVertexBufferMemory, MemoryCategory::Vertex, "geometry vertices");
+	createBuffer(sizeof(uint16_t) * indexCapacity,
+		vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer,
+		vk::MemoryPropertyFlagBits::eDeviceLocal,
+		newIndexBuffer, newIndexBufferMemory, MemoryCategory::Index, "geometry indices");
+
+	// Carry the old contents over on the device; pinned meshes have no CPU
+	// copy to re-upload from.
+	if (vertexBuffer) {
+		vk::CommandBufferAllocateInfo allocInfo = vk::CommandBufferAllocateInfo()
+			.setLevel(vk::CommandBufferLevel::ePrimary)
+			.setCommandPool(commandPool)
+			.setCommandBufferCount(1);
+		auto commandBuffer = device.allocateCommandBuffers(allocInfo);
+		commandBuffer[0].begin(vk::CommandBufferBeginInfo().setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+		DEBUG_LABEL_BEGIN(commandBuffer[0], "geometry resize");
+		commandBuffer[0].copyBuffer(vertexBuffer, newVertexBuffer,
+			{ vk::BufferCopy(0, 0, (vk::DeviceSize)vertexStride * std::min(deviceVertexCapacity, vertexCapacity)) });
+		commandBuffer[0].copyBuffer(indexBuffer, newIndexBuffer,
+			{ vk::BufferCopy(0, 0, sizeof(uint16_t) * std::min(deviceIndexCapacity, indexCapacity)) });
+		DEBUG_LABEL_END(commandBuffer[0]);
+		commandBuffer[0].end();
+		queue.submit({ vk::SubmitInfo().setCommandBufferCount(1).setPCommandBuffers(&commandBuffer[0]) }, VK_NULL_HANDLE);
+		queue.waitIdle();
+		device.freeCommandBuffers(commandPool, commandBuffer);
+	}
+	else {
+		queue.waitIdle();
+	}
+
+	destroyBuffers();
+	vertexBuffer = std::move(newVertexBuffer);
+	vertexBufferMemory = std::move(newVertexBufferMemory);
+	indexBuffer = std::move(newIndexBuffer);
+	indexBufferMemory = std::move(newIndexBufferMemory);
+	deviceVertexCapacity = vertexCapacity;
+	deviceIndexCapacity = indexCapacity;
+}
+
+void GeometryPool::upload(vk::CommandPool commandPool, vk::Queue queue)
+{
+	resize(commandPool, queue);
+
+	coalesce(dirtyVertices);
+	coalesce(dirtyIndices);
+	vk::DeviceSize stagingSize = 0;
+	for (const auto& range : dirtyVertices) {
+		stagingSize += (vk::DeviceSize)vertexStride * range.count;
+	}
+	for (const auto& range : dirtyIndices) {
+		stagingSize += sizeof(uint16_t) * range.count;
+	}
+	if (stagingSize == 0) {
+		return;
+	}
+
+	DeviceHandle<vk::Buffer> stagingBuffer;
+	DeviceHandle<vk::DeviceMemory> stagingBufferMemory;
+	createBuffer(stagingSize,
+		vk::BufferUsageFlagBits::eTransferSrc,
+		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+		stagingBuffer, stagingBufferMemory, MemoryCategory::Staging, "geometry staging");
+
+	std::vector<vk::BufferCopy> vertexCopies;
+	std::vector<vk::BufferCopy> indexCopies;
+	char* data = (char*)device.mapMemory(stagingBufferMemory, 0, stagingSize);
+	vk::DeviceSize offset = 0;
+	for (const auto& range : dirtyVertices) {
+		vk::DeviceSize size = (vk::DeviceSize)vertexStride * range.count;
+		vk::DeviceSize source = (vk::DeviceSize)vertexStride * range.offset;
+		memcpy(data + offset, vertexData.data() + source, (size_t)size);
+		vertexCopies.push_back(vk::BufferCopy(offset, source, size));
+		offset += size;
+	}
+	for (const auto& range : dirtyIndices) {
+		vk::DeviceSize size = sizeof(uint16_t) * range.count;
+		memcpy(data + offset, indexData.data() + range.offset, (size_t)size);
+		indexCopies.push_back(vk::BufferCopy(offset, sizeof(uint16_t) * range.offset, size));
+		offset += size;
+	}
+	device.unmapMemory(stagingBufferMemory);
+
+	vk::CommandBufferAllocateInfo allocInfo = vk::CommandBufferAllocateInfo()
+		.setLevel(vk::CommandBufferLevel::ePrimary)
+		.setCommandPool(commandPool)
+		.setCommandBufferCount(1);
+	auto commandBuffer = device.allocateCommandBuffers(allocInfo);
+
+	vk::CommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo()
+		.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+	commandBuffer[0].begin(beginInfo);
+	DEBUG_LABEL_BEGIN(commandBuffer[0], "geometry upload");
+	if (!vertexCopies.empty()) {
+		commandBuffer[0].copyBuffer(stagingBuffer, vertexBuffer, vertexCopies);
+	}
+	if (!indexCopies.empty()) {
+		commandBuffer[0].copyBuffer(stagingBuffer, indexBuffer, indexCopies);
+	}
+	DEBUG_LABEL_END(commandBuffer[0]);
+	commandBuffer[0].end();
+
+	vk::SubmitInfo submitInfo = vk::SubmitInfo()
+		.setCommandBufferCount(1)
+		.setPCommandBuffers(&commandBuffer[0]);
+	queue.submit({ submitInfo }, VK_NULL_HANDLE);
+	queue.waitIdle();
+	device.freeCommandBuffers(commandPool, commandBuffer);
+
+	stagingBuffer.reset();
+	stagingBufferMemory.reset();
+
+	dirtyVertices.clear();
+	dirtyIndices.clear();
+}
+
+uint32_t GeometryPool::stream(const MeshFile& file, StagingRing& ring)
+{
+	const MeshFileHeader& header = file.header();
+	if (header.vertexStride != vertexStride) {
+		throw std::runtime_error("mesh file vertex format does not match the geometry pool");
+	}
+
+	vk::IndexType indexType = header.indexSize == 4 ? vk::IndexType::eUint32 : vk::IndexType::eUint16;
+	uint32_t units = indexUnits(indexType);
+	uint32_t firstVertex = 0;
+	uint32_t firstUnit = 0;
+	reserve(header.vertexCount, firstVertex, header.indexCount * units, units, firstUnit);
+	// reserve() may have compacted, moving other meshes in the CPU copy;
+	// they go to their new offsets along with any growth
+	upload(ring.pool(), ring.queue());
+
+	MeshRange range = { firstVertex, header.vertexCount, firstUnit / units, header.indexCount,
+		indexType, NO_MESH, 0, NO_MESH, true, true };
+	uint32_t id = newMeshId(range);
+	meshes[id].owner = id;
+
+	// The file is mapped, so each chunk is read (faulted in) straight into
+	// staging memory and its copy is queued before the next one is touched.
+	auto streamInto = [&ring](vk::Buffer buffer, vk::DeviceSize dstOffset, const char* source, vk::DeviceSize size) {
+		vk::DeviceSize done = 0;
+		while (done < size) {
+			vk::DeviceSize chunk = std::min(size - done, ring.chunkSize());
+			vk::DeviceSize stagingOffset;
+			void* staging = ring.allocate(chunk, 16, stagingOffset);
+			memcpy(staging, source + done, (size_t)chunk);
+			ring.copy(buffer, stagingOffset, dstOffset + done, chunk);
+			done += chunk;
+		}
+	};
+	streamInto(vertexBuffer, (vk::DeviceSize)vertexStride * firstVertex,
+		(const char*)file.vertices(), (vk::DeviceSize)vertexStride * header.vertexCount);
+	streamInto(indexBuffer, sizeof(uint16_t) * firstUnit,
+		(const char*)file.indices(), (vk::DeviceSize)header.indexSize * header.indexCount);
+	ring.submit();
+	return id;
+}
+
+void GeometryPool::bind(vk::CommandBuffer commandBuffer, vk::IndexType indexType) const
+{
+	commandBuffer.bindVertexBuffers(0, { vertexBuffer.get() }, { 0 });
+	commandBuffer.bindIndexBuffer(indexBuffer, 0, indexType);
+}
+
+void GeometryPool::draw(vk::CommandBuffer commandBuffer, uint32_t mesh, uint32_t instanceCount) const
+{
+	for (uint32_t id = mesh; id != NO_MESH; id = meshes[id].next) {
+		const MeshRange& range = meshes[id];
+		int32_t vertexOffset = (int32_t)(meshes[range.owner].firstVertex + range.vertexBias);
+		commandBuffer.drawIndexed(range.indexCount, instanceCount, range.firstIndex, vertexOffset, 0);
+	}
+}
+
+void GeometryPool::drawAll(vk::CommandBuffer commandBuffer, const std::function<void(uint32_t)>& beforeMesh) const
+{
+	// uint16 parts are drawn with the buffer as bound by bind(); uint32
+	// parts follow after a single rebind of the same buffer.
+	bool rebound = false;
+	uint32_t lastMesh = NO_MESH;
+	for (vk::IndexType indexType : { vk::IndexType::eUint16, vk::IndexType::eUint32 }) {
+		for (const MeshRange& range : meshes) {
+			if (!range.live || range.indexType != indexType) {
+				continue;
+			}
+			if (indexType == vk::IndexType::eUint32 && !rebound) {
+				commandBuffer.bindIndexBuffer(indexBuffer, 0, indexType);
+				rebound = true;
+			}
+			if (beforeMesh && range.owner != lastMesh) {
+				beforeMesh(range.owner);
+				lastMesh = range.owner;
+			}
+			int32_t vertexOffset = (int32_t)(meshes[range.owner].firstVertex + range.vertexBias);
+			commandBuffer.drawIndexed(range.indexCount, 1, range.firstIndex, vertexOffset, 0);
+		}
+	}
+}
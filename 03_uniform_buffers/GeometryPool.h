@@ -0,0 +1,146 @@
+#pragma once
+
+#include <vulkan\vulkan.hpp>
+#include <functional>
+#include <vector>
+
+#include "Handle.h"
+#include "MemoryTracker.h"
+
+class MeshFile;
+class StagingRing;
+
+// A single vertex buffer and a single index buffer shared by many meshes.
+// Meshes are sub-allocated by element range and drawn with firstIndex /
+// vertexOffset, so a scene binds the buffers once and never rebinds per mesh.
+
+enum class IndexCompression {
+	Auto,	// uint16 when it fits, uint16 meshlets when they pay off, otherwise uint32
+	None	// always uint32
+};
+
+// One drawable part of a mesh. Large meshes may be split into several
+// uint16 meshlets that share the vertex storage owned by the first part.
+struct MeshRange {
+	uint32_t firstVertex;
+	uint32_t vertexCount;
+	uint32_t firstIndex;	// in units of indexType
+	uint32_t indexCount;
+	vk::IndexType indexType;
+	uint32_t owner;
+	uint32_t vertexBias;
+	uint32_t next;
+	bool live;
+	bool pinned;	// streamed straight to the device, no CPU shadow; never moved
+};
+
+class GeometryPool
+{
+private:
+	struct Range {
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	vk::Device device;
+	vk::PhysicalDevice physicalDevice;
+
+	DeviceHandle<vk::Buffer> vertexBuffer;
+	DeviceHandle<vk::DeviceMemory> vertexBufferMemory;
+	DeviceHandle<vk::Buffer> indexBuffer;
+	DeviceHandle<vk::DeviceMemory> indexBufferMemory;
+
+	// CPU shadow of both streams; uploads copy only the dirty span. The
+	// index stream is kept in 16-bit units, uint32 parts take two each.
+	uint32_t vertexStride;
+	std::vector<char> vertexData;
+	std::vector<uint16_t> indexData;
+	uint32_t vertexCapacity;
+	uint32_t indexCapacity;
+	uint32_t deviceVertexCapacity;
+	uint32_t deviceIndexCapacity;
+
+	std::vector<Range> freeVertices;
+	std::vector<Range> freeIndices;
+
+	std::vector<MeshRange> meshes;
+	std::vector<uint32_t> freeMeshIds;
+
+	std::vector<Range> dirtyVertices;
+	std::vector<Range> dirtyIndices;
+
+	static const uint32_t MESHLET_DRAW_COST;
+
+	static inline uint32_t indexUnits(vk::IndexType type) { return type == vk::IndexType::eUint32 ? 2 : 1; }
+	static bool allocate(std::vector<Range>& freeList, uint32_t count, uint32_t alignment, uint32_t& offset);
+	static void release(std::vector<Range>& freeList, uint32_t offset, uint32_t count);
+	void reserve(uint32_t vertexCount, uint32_t& firstVertex, uint32_t indexUnitCount, uint32_t alignment, uint32_t& firstUnit);
+	void grow(uint32_t vertexCount, uint32_t indexCount);
+	uint32_t newMeshId(const MeshRange& range);
+	void markDirty(const MeshRange& mesh);
+	void markAllDirty();
+	static void coalesce(std::vector<Range>& ranges);
+	void resize(vk::CommandPool commandPool, vk::Queue queue);
+
+	uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const;
+	void createBuffer(
+		vk::DeviceSize size,
+		vk::BufferUsageFlags usage,
+		vk::MemoryPropertyFlags properties,
+		DeviceHandle<vk::Buffer>& buffer,
+		DeviceHandle<vk::DeviceMemory>& bufferMemory,
+		MemoryCategory category,
+		const char* name) const;
+	void destroyBuffers();
+public:
+	static const uint32_t NO_MESH = ~0u;
+
+	GeometryPool();
+	~GeometryPool();
+
+	// All meshes in a pool share one vertex layout of vertexStride bytes
+	void create(vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t vertexStride,
+		uint32_t vertexCapacity, uint32_t indexCapacity);
+	void destroy();
+
+	uint32_t add(const void* vertices, uint32_t vertexCount, const std::vector<uint32_t>& indices,
+		IndexCompression compression = IndexCompression::Auto);
+
+	template <typename VERTEX>
+	uint32_t add(const std::vector<VERTEX>& vertices, const std::vector<uint32_t>& indices,
+		IndexCompression compression = IndexCompression::Auto) {
+		return add(vertices.data(), (uint32_t)vertices.size(), indices, compression);
+	}
+
+	template <typename VERTEX>
+	uint32_t add(const std::vector<VERTEX>& vertices, const std::vector<uint16_t>& indices) {
+		std::vector<uint32_t> wide(indices.begin(), indices.end());
+		return add(vertices.data(), (uint32_t)vertices.size(), wide);
+	}
+
+	void remove(uint32_t mesh);
+	void compact();
+
+	// Flushes pending changes to the device buffers, recreating them if the
+	// pool has grown. Waits for the queue to go idle before returning.
+	void upload(vk::CommandPool commandPool, vk::Queue queue);
+
+	// Adds a mesh from a mapped mesh file, copying both streams through the
+	// staging ring chunk by chunk. The copies are submitted as the ring fills
+	// and are complete once the ring is flushed.
+	uint32_t stream(const MeshFile& file, StagingRing& ring);
+
+	// draw() expects the index buffer to be bound with the mesh's index type;
+	// drawAll() groups parts by index type and binds as it goes, calling
+	// beforeMesh with the mesh id whenever the next part belongs to another mesh.
+	void bind(vk::CommandBuffer commandBuffer, vk::IndexType indexType = vk::IndexType::eUint16) const;
+	void draw(vk::CommandBuffer commandBuffer, uint32_t mesh, uint32_t instanceCount = 1) const;
+	void drawAll(vk::CommandBuffer commandBuffer, const std::function<void(uint32_t)>& beforeMesh = nullptr) const;
+
+	inline const MeshRange& mesh(uint32_t id) const { return meshes[id]; }
+	inline uint32_t stride() const { return vertexStride; }
+	inline uint32_t vertexCount() const { return vertexCapacity; }
+	inline uint32_t indexCount() const { return indexCapacity; }
+	vk::DeviceSize indexBytes(uint32_t mesh) const;
+	uint32_t drawCount(uint32_t mesh) const;
+};
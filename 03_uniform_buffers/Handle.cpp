@@ -0,0 +1,31 @@
+#include "Handle.h"
+
+std::atomic<int> LiveHandles::counts[LiveHandles::TYPES];
+
+const char* const LiveHandles::names[LiveHandles::TYPES] = {
+	"Buffer", "DeviceMemory", "Image", "ImageView", "Framebuffer", "RenderPass", "Pipeline",
+	"PipelineCache", "CommandPool", "Semaphore", "Fence", "QueryPool", "SwapchainKHR",
+	"ShaderModule", "DescriptorPool", "DescriptorSetLayout", "PipelineLayout", "Sampler",
+	"Instance", "Device", "SurfaceKHR"
+};
+
+int LiveHandles::total()
+{
+	int live = 0;
+	for (size_t i = 0; i < TYPES; i++) {
+		live += counts[i];
+	}
+	return live;
+}
+
+std::string LiveHandles::describe()
+{
+	std::string out;
+	for (size_t i = 0; i < TYPES; i++) {
+		int live = counts[i];
+		if (live != 0) {
+			out += (out.empty() ? "" : ", ") + std::string(names[i]) + " " + std::to_string(live);
+		}
+	}
+	return out.empty() ? "none" : out;
+}
\ No newline at end of file
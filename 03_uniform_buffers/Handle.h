@@ -0,0 +1,190 @@
+#pragma once
+
+#include <vulkan\vulkan.hpp>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MemoryTracker.h"
+
+// How each kind of handle is destroyed, and where it is counted
+template <typename T>
+struct HandleTraits;
+
+#define HANDLE_TRAITS(TYPE, DESTROY, INDEX)	\
+template <>									\
+struct HandleTraits<vk::TYPE> {				\
+	static const size_t index = INDEX;		\
+	static void destroy(vk::Device device, vk::TYPE handle) { device.DESTROY(handle); }	\
+};
+
+HANDLE_TRAITS(Buffer, destroyBuffer, 0)
+// Freed through the tracker so it stops counting the allocation
+template <>
+struct HandleTraits<vk::DeviceMemory> {
+	static const size_t index = 1;
+	static void destroy(vk::Device device, vk::DeviceMemory memory) { MemoryTracker::free(device, memory); }
+};
+HANDLE_TRAITS(Image, destroyImage, 2)
+HANDLE_TRAITS(ImageView, destroyImageView, 3)
+HANDLE_TRAITS(Framebuffer, destroyFramebuffer, 4)
+HANDLE_TRAITS(RenderPass, destroyRenderPass, 5)
+HANDLE_TRAITS(Pipeline, destroyPipeline, 6)
+HANDLE_TRAITS(PipelineCache, destroyPipelineCache, 7)
+HANDLE_TRAITS(CommandPool, destroyCommandPool, 8)
+HANDLE_TRAITS(Semaphore, destroySemaphore, 9)
+HANDLE_TRAITS(Fence, destroyFence, 10)
+HANDLE_TRAITS(QueryPool, destroyQueryPool, 11)
+HANDLE_TRAITS(SwapchainKHR, destroySwapchainKHR, 12)
+HANDLE_TRAITS(ShaderModule, destroyShaderModule, 13)
+HANDLE_TRAITS(DescriptorPool, destroyDescriptorPool, 14)
+HANDLE_TRAITS(DescriptorSetLayout, destroyDescriptorSetLayout, 15)
+HANDLE_TRAITS(PipelineLayout, destroyPipelineLayout, 16)
+HANDLE_TRAITS(Sampler, destroySampler, 17)
+
+#undef HANDLE_TRAITS
+
+// How many handles of each kind are alive right now. The instance, the
+// device and the surface are not made from a device, so they are counted
+// by whoever creates and destroys them.
+class LiveHandles
+{
+public:
+	static const size_t INSTANCE = 18;
+	static const size_t DEVICE = 19;
+	static const size_t SURFACE = 20;
+	static const size_t TYPES = 21;
+private:
+	static std::atomic<int> counts[TYPES];
+	static const char* const names[TYPES];
+public:
+	static inline void created(size_t type) { counts[type]++; }
+	static inline void destroyed(size_t type) { counts[type]--; }
+	static int total();
+	// e.g. "Pipeline 2, ImageView 3", or "none"
+	static std::string describe();
+};
+
+// Sole owner of one Vulkan object, destroyed when the DeviceHandle is reset,
+// assigned over or goes out of scope. Moving hands ownership on, so a
+// replacement is simply assigned and the old object goes with it. The
+// device has to outlive every DeviceHandle made from it.
+template <typename T>
+class DeviceHandle
+{
+private:
+	vk::Device device;
+	T handle;
+public:
+	DeviceHandle()
+	{
+	}
+
+	DeviceHandle(vk::Device device, T handle)
+		: device(device), handle(handle)
+	{
+		if (handle) {
+			LiveHandles::created(HandleTraits<T>::index);
+		}
+	}
+
+	DeviceHandle(DeviceHandle&& other)
+		: device(other.device), handle(other.release())
+	{
+	}
+
+	DeviceHandle& operator=(DeviceHandle&& other)
+	{
+		if (this != &other) {
+			reset();
+			device = other.device;
+			handle = other.release();
+		}
+		return *this;
+	}
+
+	DeviceHandle(const DeviceHandle&) = delete;
+	DeviceHandle& operator=(const DeviceHandle&) = delete;
+
+	~DeviceHandle()
+	{
+		reset();
+	}
+
+	void reset()
+	{
+		if (handle) {
+			HandleTraits<T>::destroy(device, handle);
+			LiveHandles::destroyed(HandleTraits<T>::index);
+			handle = nullptr;
+		}
+	}
+
+	// Gives up ownership without destroying
+	T release()
+	{
+		T released = handle;
+		handle = nullptr;
+		return released;
+	}
+
+	inline T get() const { return handle; }
+	inline operator T() const { return handle; }
+	inline explicit operator bool() const { return (bool)handle; }
+};
+
+template <typename T>
+inline DeviceHandle<T> makeHandle(vk::Device device, T handle)
+{
+	return DeviceHandle<T>(device, handle);
+}
+
+// Handles replaced while frames in flight may still use them. retire()
+// holds one in the list of the last frame that uses it, and release()
+// destroys that list once the frame's fence has signalled. Frames complete
+// in submission order, so this also covers every frame before it.
+class DeferredRelease
+{
+private:
+	struct Held {
+		virtual ~Held() {}
+	};
+
+	template <typename T>
+	struct HeldHandle : Held {
+		DeviceHandle<T> handle;
+		HeldHandle(DeviceHandle<T>&& handle) : handle(std::move(handle)) {}
+	};
+
+	std::vector<std::vector<std::unique_ptr<Held>>> frames;
+public:
+	void create(size_t frameCount)
+	{
+		releaseAll();
+		frames.resize(frameCount);
+	}
+
+	template <typename T>
+	void retire(size_t frame, DeviceHandle<T>&& handle)
+	{
+		if (handle) {
+			frames[frame].emplace_back(new HeldHandle<T>(std::move(handle)));
+		}
+	}
+
+	// After waiting on frame's fence
+	void release(size_t frame)
+	{
+		frames[frame].clear();
+	}
+
+	// After the device has gone idle
+	void releaseAll()
+	{
+		for (auto& frame : frames) {
+			frame.clear();
+		}
+	}
+};
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "ImageCompare.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+const CompareTolerance ImageCompare::DEFAULT_TOLERANCE = { 2, 0.001 };
+
+static uint32_t pixelDifference(const uint8_t* a, const uint8_t* b)
+{
+	uint32_t difference = 0;
+	for (int c = 0; c < 3; c++) {
+		difference = std::max(difference, (uint32_t)abs((int)a[c] - (int)b[c]));
+	}
+	return difference;
+}
+
+CompareResult ImageCompare::compare(const RgbImage& image, const RgbImage& golden, const CompareTolerance& tolerance)
+{
+	CompareResult result = { false, false, 0, 0, 0.0 };
+	if (image.width != golden.width || image.height != golden.height) {
+		result.sizeMismatch = true;
+		return result;
+	}
+
+	uint64_t total = 0;
+	size_t pixelCount = (size_t)image.width * image.height;
+	for (size_t i = 0; i < pixelCount; i++) {
+		const uint8_t* a = &image.pixels[i * 3];
+		const uint8_t* b = &golden.pixels[i * 3];
+		for (int c = 0; c < 3; c++) {
+			total += abs((int)a[c] - (int)b[c]);
+		}
+		uint32_t difference = pixelDifference(a, b);
+		result.maxDifference = std::max(result.maxDifference, difference);
+		if (difference > tolerance.channel) {
+			result.differentPixels++;
+		}
+	}
+	result.meanDifference = pixelCount > 0 ? (double)total / (pixelCount * 3) : 0.0;
+	result.passed = result.differentPixels <= tolerance.pixels * pixelCount;
+	return result;
+}
+
+RgbImage ImageCompare::difference(const RgbImage& image, const RgbImage& golden, const CompareTolerance& tolerance)
+{
+	RgbImage out = image;
+	if (image.width != golden.width || image.height != golden.height) {
+		return out;
+	}
+	size_t pixelCount = (size_t)image.width * image.height;
+	for (size_t i = 0; i < pixelCount; i++) {
+		uint8_t* pixel = &out.pixels[i * 3];
+		if (pixelDifference(&image.pixels[i * 3], &golden.pixels[i * 3]) > tolerance.channel) {
+			pixel[0] = 255;
+			pixel[1] = 0;
+			pixel[2] = 0;
+		}
+		else {
+			for (int c = 0; c < 3; c++) {
+				pixel[c] /= 4;
+			}
+		}
+	}
+	return out;
+}
+
+std::string ImageCompare::describe(const CompareResult& result)
+{
+	std::ostringstream out;
+	out << (result.passed ? "PASS" : "FAIL");
+	if (result.sizeMismatch) {
+		out << ": sizes differ";
+	}
+	else {
+		out << ": " << result.differentPixels << " pixels differ, max " << result.maxDifference
+			<< ", mean " << result.meanDifference;
+	}
+	return out.str();
+}
\ No newline at end of file
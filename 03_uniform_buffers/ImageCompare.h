@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+
+#include "ImageFile.h"
+
+struct CompareTolerance {
+	uint32_t channel;	// a pixel differs when any channel is off by more than this
+	double pixels;	// fraction of pixels allowed to differ
+};
+
+struct CompareResult {
+	bool passed;
+	bool sizeMismatch;
+	uint32_t differentPixels;
+	uint32_t maxDifference;	// largest difference in any channel
+	double meanDifference;	// over every channel of every pixel
+};
+
+// Checks a rendered frame against a golden image. Rasterization rules let
+// implementations differ slightly at edges and in rounding, so a small
+// per-channel difference and a small share of differing pixels still pass.
+class ImageCompare
+{
+public:
+	static const CompareTolerance DEFAULT_TOLERANCE;
+
+	static CompareResult compare(const RgbImage& image, const RgbImage& golden,
+		const CompareTolerance& tolerance = DEFAULT_TOLERANCE);
+	// Writes the differing pixels in red over a dimmed copy of image
+	static RgbImage difference(const RgbImage& image, const RgbImage& golden,
+		const CompareTolerance& tolerance = DEFAULT_TOLERANCE);
+	static std::string describe(const CompareResult& result);
+};
\ No newline at end of file
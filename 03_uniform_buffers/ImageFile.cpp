@@ -0,0 +1,233 @@
+#include "ImageFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+static const uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+// Largest payload of one stored deflate block
+static const uint32_t STORED_BLOCK = 65535;
+
+static bool hasExtension(const std::string& path, const char* extension)
+{
+	size_t length = strlen(extension);
+	if (path.size() < length) {
+		return false;
+	}
+	for (size_t i = 0; i < length; i++) {
+		if (tolower(path[path.size() - length + i]) != extension[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+{
+	static uint32_t table[256];
+	static bool initialized = false;
+	if (!initialized) {
+		for (uint32_t n = 0; n < 256; n++) {
+			uint32_t c = n;
+			for (int k = 0; k < 8; k++) {
+				c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			}
+			table[n] = c;
+		}
+		initialized = true;
+	}
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++) {
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+static void putBigEndian(std::vector<uint8_t>& out, uint32_t value)
+{
+	out.push_back((uint8_t)(value >> 24));
+	out.push_back((uint8_t)(value >> 16));
+	out.push_back((uint8_t)(value >> 8));
+	out.push_back((uint8_t)value);
+}
+
+static uint32_t getBigEndian(const uint8_t* p)
+{
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static void writeChunk(std::ofstream& file, const char type[4], const std::vector<uint8_t>& data)
+{
+	std::vector<uint8_t> chunk;
+	putBigEndian(chunk, (uint32_t)data.size());
+	chunk.insert(chunk.end(), type, type + 4);
+	chunk.insert(chunk.end(), data.begin(), data.end());
+	putBigEndian(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+	file.write((const char*)chunk.data(), chunk.size());
+}
+
+static void writePng(std::ofstream& file, const RgbImage& image)
+{
+	file.write((const char*)PNG_SIGNATURE, sizeof(PNG_SIGNATURE));
+
+	std::vector<uint8_t> header;
+	putBigEndian(header, image.width);
+	putBigEndian(header, image.height);
+	header.insert(header.end(), { 8, 2, 0, 0, 0 });	// 8-bit RGB, no interlace
+	writeChunk(file, "IHDR", header);
+
+	// Every row starts with filter type 0 (none)
+	size_t rowBytes = (size_t)image.width * 3;
+	std::vector<uint8_t> raw;
+	raw.reserve((rowBytes + 1) * image.height);
+	for (uint32_t y = 0; y < image.height; y++) {
+		raw.push_back(0);
+		raw.insert(raw.end(), image.pixels.begin() + y * rowBytes, image.pixels.begin() + (y + 1) * rowBytes);
+	}
+
+	// zlib stream of stored deflate blocks, then the Adler-32 of raw
+	std::vector<uint8_t> data = { 0x78, 0x01 };
+	size_t offset = 0;
+	do {
+		uint32_t length = (uint32_t)std::min<size_t>(STORED_BLOCK, raw.size() - offset);
+		bool last = offset + length == raw.size();
+		data.push_back(last ? 1 : 0);
+		data.insert(data.end(), { (uint8_t)length, (uint8_t)(length >> 8),
+			(uint8_t)~length, (uint8_t)(~length >> 8) });
+		data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + length);
+		offset += length;
+	} while (offset < raw.size());
+	uint32_t a = 1, b = 0;
+	for (uint8_t byte : raw) {
+		a = (a + byte) % 65521;
+		b = (b + a) % 65521;
+	}
+	putBigEndian(data, b << 16 | a);
+	writeChunk(file, "IDAT", data);
+
+	writeChunk(file, "IEND", {});
+}
+
+static RgbImage readPng(const std::vector<uint8_t>& bytes)
+{
+	RgbImage image = { 0, 0 };
+	std::vector<uint8_t> data;
+	size_t offset = sizeof(PNG_SIGNATURE);
+	while (offset + 12 <= bytes.size()) {
+		uint32_t length = getBigEndian(&bytes[offset]);
+		std::string type((const char*)&bytes[offset + 4], 4);
+		const uint8_t* body = &bytes[offset + 8];
+		if (offset + 12 + length > bytes.size()) {
+			break;
+		}
+		if (type == "IHDR") {
+			if (length < 13 || body[8] != 8 || body[9] != 2 || body[12] != 0) {
+				throw std::runtime_error("only 8-bit RGB PNGs are supported!");
+			}
+			image.width = getBigEndian(body);
+			image.height = getBigEndian(body + 4);
+		}
+		else if (type == "IDAT") {
+			data.insert(data.end(), body, body + length);
+		}
+		offset += 12 + length;
+	}
+
+	// Stored blocks only, as written by writePng
+	size_t rowBytes = (size_t)image.width * 3;
+	std::vector<uint8_t> raw;
+	size_t position = 2;
+	bool last = data.size() < 2;
+	while (!last) {
+		if (position + 5 > data.size() || (data[position] & 6) != 0) {
+			throw std::runtime_error("compressed PNGs are not supported, use an uncompressed PNG or PPM!");
+		}
+		last = (data[position] & 1) != 0;
+		uint32_t length = data[position + 1] | data[position + 2] << 8;
+		position += 5;
+		if (position + length > data.size()) {
+			throw std::runtime_error("PNG is truncated!");
+		}
+		raw.insert(raw.end(), data.begin() + position, data.begin() + position + length);
+		position += length;
+	}
+	if (image.width == 0 || raw.size() < (rowBytes + 1) * image.height) {
+		throw std::runtime_error("PNG is malformed!");
+	}
+
+	image.pixels.resize(rowBytes * image.height);
+	for (uint32_t y = 0; y < image.height; y++) {
+		const uint8_t* row = &raw[y * (rowBytes + 1)];
+		if (row[0] != 0) {
+			throw std::runtime_error("filtered PNGs are not supported!");
+		}
+		std::copy(row + 1, row + 1 + rowBytes, image.pixels.begin() + y * rowBytes);
+	}
+	return image;
+}
+
+static RgbImage readPpm(const std::vector<uint8_t>& bytes)
+{
+	// P6, then width, height and maxval separated by whitespace and comments
+	std::string header((const char*)bytes.data(), std::min<size_t>(bytes.size(), 256));
+	std::istringstream in(header);
+	std::string magic;
+	in >> magic;
+	uint32_t values[3];
+	for (uint32_t& value : values) {
+		in >> std::ws;
+		while (in.peek() == '#') {
+			std::string comment;
+			std::getline(in, comment);
+			in >> std::ws;
+		}
+		in >> value;
+	}
+	if (magic != "P6" || !in || values[2] != 255) {
+		throw std::runtime_error("only 8-bit binary PPMs are supported!");
+	}
+	size_t offset = (size_t)in.tellg() + 1;
+
+	RgbImage image = { values[0], values[1] };
+	size_t size = (size_t)image.width * image.height * 3;
+	if (offset + size > bytes.size()) {
+		throw std::runtime_error("PPM is truncated!");
+	}
+	image.pixels.assign(bytes.begin() + offset, bytes.begin() + offset + size);
+	return image;
+}
+
+void ImageFile::write(const std::string& path, const RgbImage& image)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("failed to create image file!");
+	}
+	if (hasExtension(path, ".png")) {
+		writePng(file, image);
+	}
+	else {
+		file << "P6\n" << image.width << ' ' << image.height << "\n255\n";
+		file.write((const char*)image.pixels.data(), image.pixels.size());
+	}
+	if (!file) {
+		throw std::runtime_error("failed to write image file!");
+	}
+}
+
+RgbImage ImageFile::read(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("failed to open image file!");
+	}
+	std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (bytes.size() >= sizeof(PNG_SIGNATURE) && std::equal(PNG_SIGNATURE, PNG_SIGNATURE + sizeof(PNG_SIGNATURE), bytes.begin())) {
+		return readPng(bytes);
+	}
+	return readPpm(bytes);
+}
\ No newline at end of file
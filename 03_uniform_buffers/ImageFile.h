@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Tightly packed 8-bit RGB, top row first
+struct RgbImage {
+	uint32_t width;
+	uint32_t height;
+	std::vector<uint8_t> pixels;
+};
+
+// Binary PPM (P6) and PNG. PNGs are written uncompressed, so writing costs
+// no more than a PPM plus checksums; read() handles those and PPMs, which
+// covers anything write() produced. Both throw on failure.
+class ImageFile
+{
+public:
+	// The format follows the extension; anything but .png is written as PPM
+	static void write(const std::string& path, const RgbImage& image);
+	static RgbImage read(const std::string& path);
+};
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include "LayoutCache.h"
+
+static uint64_t mix(uint64_t h, uint64_t value)
+{
+	// FNV-1a, one 64-bit value at a time
+	h ^= value;
+	return h * 1099511628211ull;
+}
+
+static const uint64_t SEED = 14695981039346656037ull;
+
+static bool sameBindings(const std::vector<ShaderBinding>& a, const std::vector<ShaderBinding>& b)
+{
+	if (a.size() != b.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < a.size(); i++) {
+		if (a[i].binding != b[i].binding || a[i].type != b[i].type ||
+			a[i].count != b[i].count || a[i].stages != b[i].stages) {
+			return false;
+		}
+	}
+	return true;
+}
+
+LayoutCache::LayoutCache()
+{
+}
+
+LayoutCache::~LayoutCache()
+{
+}
+
+void LayoutCache::create(vk::Device device)
+{
+	this->device = device;
+}
+
+void LayoutCache::destroy()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	// Pipeline layouts first, they were made from the set layouts
+	pipelineLayouts.clear();
+	setLayouts.clear();
+}
+
+vk::DescriptorSetLayout LayoutCache::setLayout(const std::vector<ShaderBinding>& bindings)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return findSetLayout(bindings);
+}
+
+vk::DescriptorSetLayout LayoutCache::findSetLayout(const std::vector<ShaderBinding>& bindings)
+{
+	uint64_t key = SEED;
+	for (const auto& binding : bindings) {
+		key = mix(key, binding.binding);
+		key = mix(key, (uint64_t)binding.type);
+		key = mix(key, binding.count);
+		key = mix(key, (VkShaderStageFlags)binding.stages);
+	}
+	auto range = setLayouts.equal_range(key);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (sameBindings(it->second.bindings, bindings)) {
+			return it->second.layout;
+		}
+	}
+
+	std::vector<vk::DescriptorSetLayoutBinding> layoutBindings;
+	for (const auto& binding : bindings) {
+		layoutBindings.push_back(vk::DescriptorSetLayoutBinding()
+			.setBinding(binding.binding)
+			.setDescriptorType(binding.type)
+			.setDescriptorCount(binding.count)
+			.setStageFlags(binding.stages)
+			.setPImmutableSamplers(nullptr));
+	}
+	vk::DescriptorSetLayoutCreateInfo layoutInfo = vk::DescriptorSetLayoutCreateInfo()
+		.setBindingCount((uint32_t)layoutBindings.size())
+		.setPBindings(layoutBindings.data());
+
+	auto entry = setLayouts.emplace(key, SetLayoutEntry{ bindings,
+		makeHandle(device, device.createDescriptorSetLayout(layoutInfo)) });
+	return entry->second.layout;
+}
+
+vk::PipelineLayout LayoutCache::pipelineLayout(const ShaderLayout& layout,
+	std::vector<vk::DescriptorSetLayout>* setLayoutsOut)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// layout.bindings is sorted by set, so each set is one contiguous run
+	std::vector<vk::DescriptorSetLayout> sets;
+	size_t first = 0;
+	while (first < layout.bindings.size()) {
+		uint32_t set = layout.bindings[first].set;
+		size_t last = first;
+		while (last < layout.bindings.size() && layout.bindings[last].set == set) {
+			last++;
+		}
+		while (sets.size() < set) {
+			sets.push_back(findSetLayout({}));
+		}
+		sets.push_back(findSetLayout(std::vector<ShaderBinding>(
+			layout.bindings.begin() + first, layout.bindings.begin() + last)));
+		first = last;
+	}
+	if (setLayoutsOut) {
+		*setLayoutsOut = sets;
+	}
+
+	vk::PushConstantRange pushConstants = vk::PushConstantRange()
+		.setStageFlags(layout.pushConstantStages)
+		.setOffset(0)
+		.setSize(layout.pushConstantSize);
+	return findPipelineLayout(sets, pushConstants);
+}
+
+vk::PipelineLayout LayoutCache::pipelineLayout(const std::vector<vk::DescriptorSetLayout>& sets,
+	const vk::PushConstantRange& pushConstants)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return findPipelineLayout(sets, pushConstants);
+}
+
+vk::PipelineLayout LayoutCache::findPipelineLayout(const std::vector<vk::DescriptorSetLayout>& sets,
+	const vk::PushConstantRange& pushConstants)
+{
+	uint64_t key = SEED;
+	for (const auto& set : sets) {
+		key = mix(key, (uint64_t)(VkDescriptorSetLayout)set);
+	}
+	key = mix(key, pushConstants.size);
+	key = mix(key, (VkShaderStageFlags)pushConstants.stageFlags);
+
+	auto range = pipelineLayouts.equal_range(key);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second.setLayouts == sets && it->second.pushConstants == pushConstants) {
+			return it->second.layout;
+		}
+	}
+
+	vk::PipelineLayoutCreateInfo pipelineLayoutInfo = vk::PipelineLayoutCreateInfo()
+		.setSetLayoutCount((uint32_t)sets.size())
+		.setPSetLayouts(sets.data())
+		.setPushConstantRangeCount(pushConstants.size > 0 ? 1 : 0)
+		.setPPushConstantRanges(&pushConstants);
+
+	auto entry = pipelineLayouts.emplace(key, PipelineLayoutEntry{ sets, pushConstants,
+		makeHandle(device, device.createPipelineLayout(pipelineLayoutInfo)) });
+	return entry->second.layout;
+}
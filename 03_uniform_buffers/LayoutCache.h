@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vulkan\vulkan.hpp>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Handle.h"
+#include "ShaderReflection.h"
+
+// Deduplicates descriptor set layouts and pipeline layouts by content.
+// Pipelines built from reflected shaders ask for their layouts here, so
+// pipelines with the same interface share one vk::PipelineLayout and
+// descriptor sets stay compatible between them. Layouts live until destroy().
+class LayoutCache
+{
+private:
+	struct SetLayoutEntry {
+		std::vector<ShaderBinding> bindings;
+		DeviceHandle<vk::DescriptorSetLayout> layout;
+	};
+	struct PipelineLayoutEntry {
+		std::vector<vk::DescriptorSetLayout> setLayouts;
+		vk::PushConstantRange pushConstants;
+		DeviceHandle<vk::PipelineLayout> layout;
+	};
+
+	vk::Device device;
+	std::mutex mutex;
+	std::unordered_multimap<uint64_t, SetLayoutEntry> setLayouts;
+	std::unordered_multimap<uint64_t, PipelineLayoutEntry> pipelineLayouts;
+
+	vk::DescriptorSetLayout findSetLayout(const std::vector<ShaderBinding>& bindings);
+	vk::PipelineLayout findPipelineLayout(const std::vector<vk::DescriptorSetLayout>& sets,
+		const vk::PushConstantRange& pushConstants);
+public:
+	LayoutCache();
+	~LayoutCache();
+
+	void create(vk::Device device);
+	void destroy();
+
+	// bindings must all belong to the same set
+	vk::DescriptorSetLayout setLayout(const std::vector<ShaderBinding>& bindings);
+	// One set layout per set index up to the highest set used; gaps get an
+	// empty layout. setLayoutsOut, when not null, receives them in set order.
+	vk::PipelineLayout pipelineLayout(const ShaderLayout& layout,
+		std::vector<vk::DescriptorSetLayout>* setLayoutsOut = nullptr);
+	// For set layouts made outside the cache, e.g. a bindless table. An
+	// empty push-constant range means none.
+	vk::PipelineLayout pipelineLayout(const std::vector<vk::DescriptorSetLayout>& sets,
+		const vk::PushConstantRange& pushConstants);
+};
@@ -0,0 +1,296 @@
+#include "MemoryTracker.h"
+
+#include <Windows.h>
+#include <algorithm>
+#include <cstdio>
+
+// VK_EXT_memory_budget is newer than the SDK headers this builds against,
+// so its one structure is declared here
+static const VkStructureType STRUCTURE_TYPE_MEMORY_BUDGET_PROPERTIES = (VkStructureType)1000237000;
+
+struct MemoryBudgetProperties {
+	VkStructureType sType;
+	void* pNext;
+	VkDeviceSize heapBudget[VK_MAX_MEMORY_HEAPS];
+	VkDeviceSize heapUsage[VK_MAX_MEMORY_HEAPS];
+};
+
+const char* const MemoryTracker::EXTENSION_NAME = "VK_EXT_memory_budget";
+
+std::mutex MemoryTracker::mutex;
+std::unordered_map<uint64_t, MemoryTracker::Allocation> MemoryTracker::allocations;
+MemoryUsage MemoryTracker::categories[MemoryTracker::CATEGORIES];
+MemoryUsage MemoryTracker::all;
+vk::DeviceSize MemoryTracker::heapUsage[VK_MAX_MEMORY_HEAPS];
+
+vk::PhysicalDevice MemoryTracker::physicalDevice;
+vk::PhysicalDeviceMemoryProperties MemoryTracker::properties;
+PFN_vkGetPhysicalDeviceMemoryProperties2 MemoryTracker::getProperties2 = nullptr;
+
+vk::DeviceSize MemoryTracker::softBudget = 0;
+std::vector<std::pair<std::string, MemoryTracker::Evictor>> MemoryTracker::evictors;
+std::chrono::seconds MemoryTracker::logInterval(0);
+std::chrono::steady_clock::time_point MemoryTracker::lastLog;
+std::chrono::steady_clock::time_point MemoryTracker::lastBudgetCheck;
+vk::DeviceSize MemoryTracker::lastHeapExcess = 0;
+bool MemoryTracker::overBudget = false;
+
+static std::string megabytes(vk::DeviceSize bytes)
+{
+	char text[32];
+	snprintf(text, sizeof(text), "%.1f MB", bytes / (1024.0 * 1024.0));
+	return text;
+}
+
+void MemoryTracker::create(vk::Instance instance, uint32_t apiVersion, vk::PhysicalDevice physicalDevice,
+	bool budgetExtension)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	MemoryTracker::physicalDevice = physicalDevice;
+	properties = physicalDevice.getMemoryProperties();
+	getProperties2 = nullptr;
+	if (budgetExtension) {
+		// A 1.0 instance may still hand out the core name, but only the KHR
+		// one may be called on it
+		bool core = VK_VERSION_MAJOR(apiVersion) > 1 || VK_VERSION_MINOR(apiVersion) >= 1;
+		if (core) {
+			getProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2)
+				vkGetInstanceProcAddr((VkInstance)instance, "vkGetPhysicalDeviceMemoryProperties2");
+		}
+		if (getProperties2 == nullptr) {
+			getProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2)
+				vkGetInstanceProcAddr((VkInstance)instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+		}
+	}
+	lastLog = lastBudgetCheck = std::chrono::steady_clock::now();
+	lastHeapExcess = 0;
+	overBudget = false;
+}
+
+void MemoryTracker::destroy()
+{
+	OutputDebugStringA(("memory: peak " + megabytes(total().peak) + "\n").c_str());
+	MemoryUsage left = total();
+	if (left.allocations > 0) {
+		OutputDebugStringA(("memory: still allocated at shutdown: " + describe() + "\n").c_str());
+	}
+	evictors.clear();
+}
+
+void MemoryTracker::add(MemoryUsage& usage, vk::DeviceSize size, vk::DeviceSize used)
+{
+	usage.live += size;
+	usage.used += used;
+	usage.allocations++;
+	usage.peak = std::max(usage.peak, usage.live);
+}
+
+void MemoryTracker::remove(MemoryUsage& usage, vk::DeviceSize size, vk::DeviceSize used)
+{
+	usage.live -= size;
+	usage.used -= used;
+	usage.allocations--;
+}
+
+vk::DeviceMemory MemoryTracker::allocate(vk::Device device, const vk::MemoryAllocateInfo& info,
+	MemoryCategory category, vk::DeviceSize used)
+{
+	vk::DeviceMemory memory = device.allocateMemory(info);
+
+	Allocation allocation;
+	allocation.size = info.allocationSize;
+	allocation.used = used > 0 ? std::min(used, info.allocationSize) : info.allocationSize;
+	allocation.category = category;
+	allocation.heap = info.memoryTypeIndex < properties.memoryTypeCount ?
+		properties.memoryTypes[info.memoryTypeIndex].heapIndex : 0;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	allocations[(uint64_t)(VkDeviceMemory)memory] = allocation;
+	add(categories[(size_t)category], allocation.size, allocation.used);
+	add(all, allocation.size, allocation.used);
+	heapUsage[allocation.heap] += allocation.size;
+	return memory;
+}
+
+void MemoryTracker::free(vk::Device device, vk::DeviceMemory memory)
+{
+	if (!memory) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = allocations.find((uint64_t)(VkDeviceMemory)memory);
+		if (it != allocations.end()) {
+			const Allocation& allocation = it->second;
+			remove(categories[(size_t)allocation.category], allocation.size, allocation.used);
+			remove(all, allocation.size, allocation.used);
+			heapUsage[allocation.heap] -= allocation.size;
+			allocations.erase(it);
+		}
+	}
+	device.freeMemory(memory);
+}
+
+MemoryUsage MemoryTracker::usage(MemoryCategory category)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return categories[(size_t)category];
+}
+
+MemoryUsage MemoryTracker::total()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return all;
+}
+
+std::vector<HeapBudget> MemoryTracker::budgets()
+{
+	std::vector<HeapBudget> heaps(properties.memoryHeapCount);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (uint32_t i = 0; i < properties.memoryHeapCount; i++) {
+			heaps[i].size = properties.memoryHeaps[i].size;
+			heaps[i].budget = properties.memoryHeaps[i].size;
+			heaps[i].usage = heapUsage[i];
+			heaps[i].deviceLocal = (bool)(properties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal);
+		}
+	}
+	if (getProperties2 != nullptr) {
+		MemoryBudgetProperties budget = {};
+		budget.sType = STRUCTURE_TYPE_MEMORY_BUDGET_PROPERTIES;
+		VkPhysicalDeviceMemoryProperties2 properties2 = {};
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+		properties2.pNext = &budget;
+		getProperties2((VkPhysicalDevice)physicalDevice, &properties2);
+		for (size_t i = 0; i < heaps.size(); i++) {
+			heaps[i].budget = budget.heapBudget[i];
+			heaps[i].usage = budget.heapUsage[i];
+		}
+	}
+	return heaps;
+}
+
+void MemoryTracker::setSoftBudget(vk::DeviceSize bytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	softBudget = bytes;
+}
+
+void MemoryTracker::addEvictor(const std::string& name, Evictor evictor)
+{
+	evictors.push_back({ name, evictor });
+}
+
+void MemoryTracker::setLogInterval(std::chrono::seconds interval)
+{
+	logInterval = interval;
+}
+
+vk::DeviceSize MemoryTracker::heapExcess()
+{
+	vk::DeviceSize excess = 0;
+	for (const auto& heap : budgets()) {
+		if (heap.usage > heap.budget) {
+			excess += heap.usage - heap.budget;
+		}
+	}
+	return excess;
+}
+
+vk::DeviceSize MemoryTracker::evict(vk::DeviceSize excess)
+{
+	vk::DeviceSize total = 0;
+	for (auto& evictor : evictors) {
+		if (excess == 0) {
+			break;
+		}
+		vk::DeviceSize freed = evictor.second(excess);
+		if (freed > 0) {
+			OutputDebugStringA(("memory: " + evictor.first + " freed " + megabytes(freed) + "\n").c_str());
+			excess -= std::min(freed, excess);
+			total += freed;
+		}
+	}
+	return total;
+}
+
+void MemoryTracker::poll()
+{
+	auto now = std::chrono::steady_clock::now();
+	vk::DeviceSize excess = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (softBudget > 0 && all.live > softBudget) {
+			excess = all.live - softBudget;
+		}
+	}
+	// The driver's numbers cost a call into it, so they are only read once
+	// a second; in between, the last reading stands
+	if (getProperties2 != nullptr && now - lastBudgetCheck >= std::chrono::seconds(1)) {
+		lastBudgetCheck = now;
+		lastHeapExcess = heapExcess();
+	}
+	excess = std::max(excess, lastHeapExcess);
+
+	if (excess > 0) {
+		if (!overBudget) {
+			OutputDebugStringA(("memory: over budget by " + megabytes(excess) + ": " + describe() + "\n").c_str());
+			overBudget = true;
+		}
+		// What was freed no longer counts against the heaps either, so the
+		// same excess is not evicted again every frame until the next reading
+		vk::DeviceSize freed = evict(excess);
+		lastHeapExcess -= std::min(freed, lastHeapExcess);
+	}
+	else if (overBudget) {
+		OutputDebugStringA(("memory: back within budget: " + describe() + "\n").c_str());
+		overBudget = false;
+	}
+
+	if (logInterval.count() > 0 && now - lastLog >= logInterval) {
+		lastLog = now;
+		std::string heaps;
+		for (const auto& heap : budgets()) {
+			heaps += (heaps.empty() ? "" : ", ") + megabytes(heap.usage) + " of " + megabytes(heap.budget) +
+				(heap.deviceLocal ? " device" : " host");
+		}
+		OutputDebugStringA(("memory: " + describe() + "; heaps " + heaps + "\n").c_str());
+	}
+}
+
+std::string MemoryTracker::name(MemoryCategory category)
+{
+	switch (category) {
+	case MemoryCategory::Vertex:
+		return "vertex";
+	case MemoryCategory::Index:
+		return "index";
+	case MemoryCategory::Uniform:
+		return "uniform";
+	case MemoryCategory::Staging:
+		return "staging";
+	case MemoryCategory::Image:
+		return "image";
+	default:
+		return "readback";
+	}
+}
+
+std::string MemoryTracker::describe()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::string out;
+	char text[160];
+	for (size_t i = 0; i < CATEGORIES; i++) {
+		const MemoryUsage& usage = categories[i];
+		if (usage.peak == 0) {
+			continue;
+		}
+		snprintf(text, sizeof(text), "%s %s (peak %s, %u allocations, %.1f%% unused)",
+			name((MemoryCategory)i).c_str(), megabytes(usage.live).c_str(), megabytes(usage.peak).c_str(),
+			usage.allocations, usage.fragmentation() * 100.0);
+		out += (out.empty() ? "" : ", ") + std::string(text);
+	}
+	snprintf(text, sizeof(text), "total %s (peak %s)", megabytes(all.live).c_str(), megabytes(all.peak).c_str());
+	return out + (out.empty() ? "" : ", ") + text;
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vulkan\vulkan.hpp>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// What an allocation holds
+enum class MemoryCategory {
+	Vertex,
+	Index,
+	Uniform,	// uniform and per-object constant buffers
+	Staging,	// host-visible upload memory
+	Image,	// attachments and render graph transients
+	Readback	// host-visible download memory
+};
+
+struct MemoryUsage {
+	vk::DeviceSize live;	// allocated and not yet freed
+	vk::DeviceSize peak;	// highest live seen
+	vk::DeviceSize used;	// what the resources in live actually asked for
+	uint32_t allocations;
+
+	// Share of live no resource uses: alignment and size rounding
+	inline double fragmentation() const { return live > 0 ? 1.0 - (double)used / (double)live : 0.0; }
+};
+
+struct HeapBudget {
+	vk::DeviceSize size;
+	vk::DeviceSize budget;	// what the process may use; the heap size without VK_EXT_memory_budget
+	vk::DeviceSize usage;	// process-wide per the driver; only what is tracked here without it
+	bool deviceLocal;
+};
+
+// Counts every vk::DeviceMemory the renderer allocates, by category and by
+// heap. Allocate through allocate() and free through free() (a
+// DeviceHandle<vk::DeviceMemory> already does). poll() runs once a frame: above
+// the soft budget, or above what VK_EXT_memory_budget says a heap may
+// hold, it calls the evictors in the order they were added until usage is
+// back under, and with a log interval set it writes a summary that often.
+class MemoryTracker
+{
+public:
+	static const size_t CATEGORIES = 6;
+	static const char* const EXTENSION_NAME;
+
+	// Frees what it can towards excess bytes and returns how much it freed.
+	// Called on the thread that calls poll(), never while allocating.
+	typedef std::function<vk::DeviceSize(vk::DeviceSize excess)> Evictor;
+private:
+	struct Allocation {
+		vk::DeviceSize size;
+		vk::DeviceSize used;
+		MemoryCategory category;
+		uint32_t heap;
+	};
+
+	static std::mutex mutex;
+	static std::unordered_map<uint64_t, Allocation> allocations;
+	static MemoryUsage categories[CATEGORIES];
+	static MemoryUsage all;
+	static vk::DeviceSize heapUsage[VK_MAX_MEMORY_HEAPS];
+
+	static vk::PhysicalDevice physicalDevice;
+	static vk::PhysicalDeviceMemoryProperties properties;
+	static PFN_vkGetPhysicalDeviceMemoryProperties2 getProperties2;
+
+	static vk::DeviceSize softBudget;
+	static std::vector<std::pair<std::string, Evictor>> evictors;
+	static std::chrono::seconds logInterval;
+	static std::chrono::steady_clock::time_point lastLog;
+	static std::chrono::steady_clock::time_point lastBudgetCheck;
+	static vk::DeviceSize lastHeapExcess;	// as of lastBudgetCheck, less what was evicted since
+	static bool overBudget;
+
+	static void add(MemoryUsage& usage, vk::DeviceSize size, vk::DeviceSize used);
+	static void remove(MemoryUsage& usage, vk::DeviceSize size, vk::DeviceSize used);
+	static vk::DeviceSize heapExcess();
+	// Returns how much was freed
+	static vk::DeviceSize evict(vk::DeviceSize excess);
+public:
+	// budgetExtension: VK_EXT_memory_budget is enabled on the device, and
+	// vkGetPhysicalDeviceMemoryProperties2 is available on the instance: in
+	// core when apiVersion is 1.1 or later, from the KHR extension on 1.0
+	static void create(vk::Instance instance, uint32_t apiVersion, vk::PhysicalDevice physicalDevice,
+		bool budgetExtension);
+	// Logs a final summary and anything still allocated, drops the evictors
+	static void destroy();
+
+	// used is what the resource asked for, if less than allocationSize
+	static vk::DeviceMemory allocate(vk::Device device, const vk::MemoryAllocateInfo& info,
+		MemoryCategory category, vk::DeviceSize used = 0);
+	static void free(vk::Device device, vk::DeviceMemory memory);
+
+	static MemoryUsage usage(MemoryCategory category);
+	static MemoryUsage total();
+	// One per memory heap; asks the driver each call
+	static std::vector<HeapBudget> budgets();
+
+	// Tracked bytes across all categories; 0 is no soft budget
+	static void setSoftBudget(vk::DeviceSize bytes);
+	static inline vk::DeviceSize budget() { return softBudget; }
+	static void addEvictor(const std::string& name, Evictor evictor);
+	// 0 logs only when the budget is crossed
+	static void setLogInterval(std::chrono::seconds interval);
+
+	// Once a frame, on the thread that owns the device
+	static void poll();
+
+	static std::string name(MemoryCategory category);
+	// e.g. "vertex 1.0 MB (peak 1.0 MB, 2 allocations, 0.1% unused), ..."
+	static std::string describe();
+};
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "MeshFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+const char MeshFile::MAGIC[4] = { 'V', 'K', 'M', 'F' };
+
+MeshFile::MeshFile()
+	: file(INVALID_HANDLE_VALUE)
+	, mapping(nullptr)
+	, view(nullptr)
+	, size(0)
+{
+}
+
+MeshFile::~MeshFile()
+{
+	close();
+}
+
+void MeshFile::open(const std::string& path)
+{
+	close();
+
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("failed to open mesh file!");
+	}
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	size = (uint64_t)fileSize.QuadPart;
+	if (size < sizeof(MeshFileHeader)) {
+		close();
+		throw std::runtime_error("mesh file is truncated!");
+	}
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping) {
+		view = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	}
+	if (!view) {
+		close();
+		throw std::runtime_error("failed to map mesh file!");
+	}
+
+	const MeshFileHeader& h = header();
+	uint64_t vertexBytes = (uint64_t)h.vertexStride * h.vertexCount;
+	uint64_t indexBytes = (uint64_t)h.indexSize * h.indexCount;
+	if (memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != VERSION ||
+		(h.indexSize != 2 && h.indexSize != 4) ||
+		h.vertexOffset % ALIGNMENT != 0 || h.indexOffset % ALIGNMENT != 0 ||
+		h.vertexOffset + vertexBytes > size || h.indexOffset + indexBytes > size) {
+		close();
+		throw std::runtime_error("mesh file is malformed!");
+	}
+}
+
+void MeshFile::close()
+{
+	if (view) {
+		UnmapViewOfFile(view);
+		view = nullptr;
+	}
+	if (mapping) {
+		CloseHandle(mapping);
+		mapping = nullptr;
+	}
+	if (file != INVALID_HANDLE_VALUE) {
+		CloseHandle(file);
+		file = INVALID_HANDLE_VALUE;
+	}
+	size = 0;
+}
+
+void MeshFile::write(const std::string& path, MeshFileHeader header, const void* vertices, const void* indices)
+{
+	uint64_t vertexBytes = (uint64_t)header.vertexStride * header.vertexCount;
+	uint64_t indexBytes = (uint64_t)header.indexSize * header.indexCount;
+
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.reserved = 0;
+	header.vertexOffset = (sizeof(MeshFileHeader) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	header.indexOffset = (header.vertexOffset + vertexBytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out.is_open()) {
+		throw std::runtime_error("failed to create mesh file!");
+	}
+
+	std::vector<char> padding(ALIGNMENT, 0);
+	out.write((const char*)&header, sizeof(header));
+	out.write(padding.data(), header.vertexOffset - sizeof(header));
+	out.write((const char*)vertices, vertexBytes);
+	out.write(padding.data(), header.indexOffset - header.vertexOffset - vertexBytes);
+	out.write((const char*)indices, indexBytes);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Windows.h>
+#include <cstdint>
+#include <string>
+
+// On-disk mesh container. Both streams start on MESH_FILE_ALIGNMENT
+// boundaries and are stored exactly as the GPU consumes them, so a mapped
+// file can be copied into staging memory without any conversion.
+struct MeshFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t vertexFormat;	// VertexFormat
+	uint32_t vertexStride;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t indexSize;	// 2 or 4
+	uint32_t reserved;
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	float boundsCenter[2];	// dequantization for packed positions
+	float boundsExtent[2];
+};
+
+class MeshFile
+{
+private:
+	HANDLE file;
+	HANDLE mapping;
+	const char* view;
+	uint64_t size;
+public:
+	static const char MAGIC[4];
+	static const uint32_t VERSION = 1;
+	static const uint64_t ALIGNMENT = 256;
+
+	MeshFile();
+	~MeshFile();
+
+	// Maps the whole file read-only; throws if it is missing or malformed
+	void open(const std::string& path);
+	void close();
+
+	inline const MeshFileHeader& header() const { return *(const MeshFileHeader*)view; }
+	inline const void* vertices() const { return view + header().vertexOffset; }
+	inline const void* indices() const { return view + header().indexOffset; }
+
+	// Fills in magic, version and offsets in header and writes the file
+	static void write(const std::string& path, MeshFileHeader header, const void* vertices, const void* indices);
+};
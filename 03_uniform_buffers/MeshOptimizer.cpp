@@ -0,0 +1,242 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <numeric>
+
+MeshStats MeshOptimizer::analyze(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+	MeshStats stats = { 0.0f, 0.0f };
+	if (indices.size() < 3 || vertexCount == 0) {
+		return stats;
+	}
+
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	uint32_t time = cacheSize + 1;
+	uint32_t misses = 0;
+	for (uint32_t index : indices) {
+		if (time - cacheTime[index] > cacheSize) {
+			cacheTime[index] = time++;
+			misses++;
+		}
+	}
+
+	stats.acmr = (float)misses / (indices.size() / 3);
+	stats.atvr = (float)misses / vertexCount;
+	return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount,
+	uint32_t cacheSize, std::vector<uint32_t>* clusters)
+{
+	uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+	if (triangleCount == 0) {
+		return;
+	}
+
+	// Vertex -> triangle adjacency, packed as offsets into one array
+	std::vector<uint32_t> live(vertexCount, 0);
+	for (uint32_t index : indices) {
+		live[index]++;
+	}
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		offsets[v + 1] = offsets[v] + live[v];
+	}
+	std::vector<uint32_t> adjacency(offsets[vertexCount]);
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		for (uint32_t c = 0; c < 3; c++) {
+			adjacency[fill[indices[t * 3 + c]]++] = t;
+		}
+	}
+
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> deadEnd;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	uint32_t time = cacheSize + 1;
+	uint32_t cursor = 0;
+	int64_t fan = 0;
+	if (clusters) {
+		clusters->assign(1, 0);
+	}
+
+	while (fan >= 0) {
+		candidates.clear();
+		for (uint32_t a = offsets[(size_t)fan]; a < offsets[(size_t)fan + 1]; a++) {
+			uint32_t t = adjacency[a];
+			if (emitted[t]) {
+				continue;
+			}
+			for (uint32_t c = 0; c < 3; c++) {
+				uint32_t v = indices[t * 3 + c];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (time - cacheTime[v] > cacheSize) {
+					cacheTime[v] = time++;
+				}
+			}
+			emitted[t] = true;
+		}
+
+		// Prefer a candidate that will still be in the cache once all of its
+		// remaining triangles are emitted, oldest first.
+		int64_t next = -1;
+		int64_t best = -1;
+		for (uint32_t v : candidates) {
+			if (live[v] == 0) {
+				continue;
+			}
+			int64_t priority = 0;
+			if (time - cacheTime[v] + 2 * live[v] <= cacheSize) {
+				priority = time - cacheTime[v];
+			}
+			if (priority > best) {
+				best = priority;
+				next = v;
+			}
+		}
+
+		if (next < 0) {
+			while (!deadEnd.empty()) {
+				uint32_t v = deadEnd.back();
+				deadEnd.pop_back();
+				if (live[v] > 0) {
+					next = v;
+					break;
+				}
+			}
+		}
+		if (next < 0) {
+			while (cursor < vertexCount && live[cursor] == 0) {
+				cursor++;
+			}
+			if (cursor < vertexCount) {
+				next = cursor;
+				// Nothing cached is reusable any more: a hard cluster boundary
+				if (clusters && output.size() / 3 < triangleCount) {
+					clusters->push_back((uint32_t)(output.size() / 3));
+				}
+			}
+		}
+		fan = next;
+	}
+
+	indices.swap(output);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+	float threshold, uint32_t cacheSize)
+{
+	std::vector<glm::vec3> positions;
+	positions.reserve(vertices.size());
+	for (const auto& vertex : vertices) {
+		positions.push_back(glm::vec3(vertex.pos, 0.0f));
+	}
+	optimizeOverdraw(indices, positions, threshold, cacheSize);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions,
+	float threshold, uint32_t cacheSize)
+{
+	uint32_t vertexCount = (uint32_t)positions.size();
+	uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+	if (triangleCount == 0) {
+		return;
+	}
+
+	std::vector<uint32_t> hard;
+	optimizeVertexCache(indices, vertexCount, cacheSize, &hard);
+	hard.push_back(triangleCount);
+
+	// Soft boundaries: within each hard cluster start a new one whenever the
+	// running ACMR has settled under the limit, so splitting costs little.
+	float limit = analyze(indices, vertexCount, cacheSize).acmr * threshold;
+	std::vector<uint32_t> boundaries;
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	uint32_t time = cacheSize + 1;
+	for (size_t h = 0; h + 1 < hard.size(); h++) {
+		uint32_t start = hard[h];
+		uint32_t misses = 0;
+		boundaries.push_back(start);
+		for (uint32_t t = hard[h]; t < hard[h + 1]; t++) {
+			for (uint32_t c = 0; c < 3; c++) {
+				uint32_t v = indices[t * 3 + c];
+				if (time - cacheTime[v] > cacheSize) {
+					cacheTime[v] = time++;
+					misses++;
+				}
+			}
+			uint32_t length = t + 1 - start;
+			if (length >= cacheSize && t + 1 < hard[h + 1] && (float)misses / length <= limit) {
+				start = t + 1;
+				misses = 0;
+				boundaries.push_back(start);
+			}
+		}
+	}
+	boundaries.push_back(triangleCount);
+
+	glm::vec3 meshCentroid(0.0f);
+	for (const auto& position : positions) {
+		meshCentroid += position;
+	}
+	meshCentroid /= (float)std::max(vertexCount, 1u);
+
+	struct Cluster {
+		uint32_t first;
+		uint32_t last;
+		float sortKey;
+	};
+	std::vector<Cluster> clusters;
+	for (size_t b = 0; b + 1 < boundaries.size(); b++) {
+		glm::vec3 centroid(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+		for (uint32_t t = boundaries[b]; t < boundaries[b + 1]; t++) {
+			const glm::vec3& p0 = positions[indices[t * 3 + 0]];
+			const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+			const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+			glm::vec3 triangleNormal = glm::cross(p1 - p0, p2 - p0);
+			float triangleArea = glm::length(triangleNormal);
+			centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+			normal += triangleNormal;
+			area += triangleArea;
+		}
+		float key = 0.0f;
+		if (area > 0.0f && glm::length(normal) > 0.0f) {
+			centroid /= area;
+			key = glm::dot(centroid - meshCentroid, glm::normalize(normal));
+		}
+		clusters.push_back({ boundaries[b], boundaries[b + 1], key });
+	}
+
+	// Clusters facing away from the mesh centre are the likeliest occluders
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+		return a.sortKey > b.sortKey;
+	});
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+	for (const auto& cluster : clusters) {
+		output.insert(output.end(), indices.begin() + cluster.first * 3, indices.begin() + cluster.last * 3);
+	}
+	indices.swap(output);
+}
+
+uint32_t MeshOptimizer::buildFetchRemap(const std::vector<uint32_t>& indices, uint32_t vertexCount, std::vector<uint32_t>& remap)
+{
+	remap.assign(vertexCount, ~0u);
+	uint32_t next = 0;
+	for (uint32_t index : indices) {
+		if (remap[index] == ~0u) {
+			remap[index] = next++;
+		}
+	}
+	return next;
+}
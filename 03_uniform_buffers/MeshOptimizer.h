@@ -0,0 +1,61 @@
+#pragma once
+
+#include <glm\glm.hpp>
+#include <vector>
+
+#include "Vertex.h"
+
+struct MeshStats {
+	float acmr;	// post-transform cache misses per triangle
+	float atvr;	// post-transform cache misses per vertex
+};
+
+// CPU-side preprocessing for meshes before they reach the GeometryPool.
+// Nothing here touches the device; every pass works on plain index and
+// vertex arrays and can be run at load time or offline.
+class MeshOptimizer
+{
+public:
+	static const uint32_t DEFAULT_CACHE_SIZE = 16;
+
+	// Simulates a FIFO post-transform cache of cacheSize entries
+	static MeshStats analyze(const std::vector<uint32_t>& indices, uint32_t vertexCount,
+		uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+	// Tipsify (Sander, Nehab, Barczak 2007). Reorders triangles for
+	// post-transform cache locality. When clusters is not null it receives
+	// the first triangle of every cluster found along the way.
+	static void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount,
+		uint32_t cacheSize = DEFAULT_CACHE_SIZE, std::vector<uint32_t>* clusters = nullptr);
+
+	// Runs optimizeVertexCache, splits its order into clusters no worse than
+	// threshold times the whole-mesh ACMR and sorts them outside-in, so
+	// front-most surfaces tend to be drawn first.
+	static void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions,
+		float threshold = 1.05f, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+	static void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+		float threshold = 1.05f, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+	// Reorders vertices into first-use order and drops unreferenced ones,
+	// so vertex fetch walks memory linearly. Returns the new vertex count.
+	template <typename VERTEX>
+	static uint32_t optimizeVertexFetch(std::vector<VERTEX>& vertices, std::vector<uint32_t>& indices) {
+		std::vector<uint32_t> remap;
+		uint32_t count = buildFetchRemap(indices, (uint32_t)vertices.size(), remap);
+
+		std::vector<VERTEX> reordered(count);
+		for (size_t v = 0; v < vertices.size(); v++) {
+			if (remap[v] != ~0u) {
+				reordered[remap[v]] = vertices[v];
+			}
+		}
+		for (auto& index : indices) {
+			index = remap[index];
+		}
+		vertices.swap(reordered);
+		return count;
+	}
+
+private:
+	static uint32_t buildFetchRemap(const std::vector<uint32_t>& indices, uint32_t vertexCount, std::vector<uint32_t>& remap);
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// A fixed-size ring any number of producer threads push into and exactly one
+// consumer thread pops from. Nobody locks, blocks or allocates: push() fails
+// when the ring is full and pop() fails when it is empty. Each cell carries
+// a sequence number saying whose turn it is, so a producer that has claimed
+// a cell but not finished writing it just looks empty to the consumer.
+// CAPACITY must be a power of two.
+template <typename T, size_t CAPACITY>
+class MpscQueue
+{
+private:
+	static_assert((CAPACITY & (CAPACITY - 1)) == 0, "MpscQueue capacity must be a power of two");
+
+	struct Cell {
+		std::atomic<size_t> sequence;
+		T item;
+	};
+
+	// tail is shared by every producer and head only used by the consumer;
+	// the padding keeps them on separate cache lines
+	std::atomic<size_t> tail;
+	char tailPadding[64 - sizeof(std::atomic<size_t>)];
+	size_t head;
+	char headPadding[64 - sizeof(size_t)];
+	Cell cells[CAPACITY];
+public:
+	MpscQueue()
+		: tail(0)
+		, head(0)
+	{
+		for (size_t i = 0; i < CAPACITY; i++) {
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	// Any thread
+	bool push(const T& item)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		Cell* cell;
+		for (;;) {
+			cell = &cells[t & (CAPACITY - 1)];
+			intptr_t turn = (intptr_t)cell->sequence.load(std::memory_order_acquire) - (intptr_t)t;
+			if (turn == 0) {
+				if (tail.compare_exchange_weak(t, t + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+			else if (turn < 0) {
+				// The consumer has not got round to this cell yet
+				return false;
+			}
+			else {
+				t = tail.load(std::memory_order_relaxed);
+			}
+		}
+		cell->item = item;
+		cell->sequence.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer thread only
+	bool pop(T& item)
+	{
+		Cell& cell = cells[head & (CAPACITY - 1)];
+		if (cell.sequence.load(std::memory_order_acquire) != head + 1) {
+			return false;
+		}
+		item = cell.item;
+		cell.sequence.store(head + CAPACITY, std::memory_order_release);
+		head++;
+		return true;
+	}
+};
\ No newline at end of file
@@ -1,20 +1,92 @@
 #pragma once
 
-#include <map>
-#include <functional>
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
+// A callable stored inside the object itself rather than on the heap, for
+// the small lambdas observers are made of (typically capturing this)
+template <typename ... ARGS>
+class InlineCallback {
+public:
+	static const size_t CAPACITY = 4 * sizeof(void*);
+private:
+	typename std::aligned_storage<CAPACITY, alignof(void*)>::type storage;
+	void(*call)(void*, ARGS...);
+	void(*copy)(void*, const void*);
+	void(*destroy)(void*);
+public:
+	template <typename F>
+	InlineCallback(F f)
+	{
+		static_assert(sizeof(F) <= CAPACITY, "observer captures too much to store inline");
+		static_assert(alignof(F) <= alignof(void*), "observer is over-aligned");
+		new (&storage) F(std::move(f));
+		call = [](void* p, ARGS... args) { (*(F*)p)(std::forward<ARGS>(args)...); };
+		copy = [](void* to, const void* from) { new (to) F(*(const F*)from); };
+		destroy = [](void* p) { ((F*)p)->~F(); };
+	}
+
+	InlineCallback(const InlineCallback& other)
+		: call(other.call), copy(other.copy), destroy(other.destroy)
+	{
+		copy(&storage, &other.storage);
+	}
+
+	InlineCallback& operator=(const InlineCallback& other)
+	{
+		if (this != &other) {
+			destroy(&storage);
+			call = other.call;
+			copy = other.copy;
+			destroy = other.destroy;
+			copy(&storage, &other.storage);
+		}
+		return *this;
+	}
+
+	~InlineCallback()
+	{
+		destroy(&storage);
+	}
+
+	inline void operator()(ARGS... args)
+	{
+		call(&storage, std::forward<ARGS>(args)...);
+	}
+};
+
+// Observers are kept in one vector sorted by message, so invoke() is a
+// binary search over contiguous memory followed by a direct call per
+// observer, with no allocation. Any number of observers can watch the
+// same message; they run in the order they were added. Observing from
+// inside a callback of the same Observable is not supported.
 template <typename MSG, typename ... ARGS>
 class Observable {
 private:
-	std::map<MSG, std::function<void(ARGS...)>> callbacks;
+	struct Observer {
+		MSG msg;
+		InlineCallback<ARGS...> callback;
+	};
+	std::vector<Observer> observers;
+
+	static bool before(const Observer& observer, const MSG& msg) { return observer.msg < msg; }
 public:
-	void observe(MSG msg, std::function<void(ARGS...)> callback) {
-		callbacks[msg] = callback;
+	template <typename F>
+	void observe(MSG msg, F callback) {
+		// After any existing observers of msg, keeping them in order
+		auto position = std::upper_bound(observers.begin(), observers.end(), msg,
+			[](const MSG& msg, const Observer& observer) { return msg < observer.msg; });
+		observers.insert(position, Observer{ msg, InlineCallback<ARGS...>(std::move(callback)) });
 	}
 
 	void invoke(MSG msg, ARGS... args) {
-		if (callbacks.find(msg) != callbacks.end()) {
-			callbacks[msg](std::forward<ARGS>(args)...);
+		auto it = std::lower_bound(observers.begin(), observers.end(), msg, before);
+		for (; it != observers.end() && !(msg < it->msg); ++it) {
+			it->callback(args...);
 		}
 	}
 };
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include "ReadbackRing.h"
+#include "DebugUtils.h"
+#include "MemoryTracker.h"
+
+#include <limits>
+
+ReadbackRing::ReadbackRing()
+	: next(0)
+	, inFlight(0)
+	, lent(0)
+	, recorded(~0u)
+	, coherent(true)
+{
+}
+
+ReadbackRing::~ReadbackRing()
+{
+}
+
+void ReadbackRing::create(vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t slotCount)
+{
+	this->device = device;
+	this->physicalDevice = physicalDevice;
+	next = 0;
+	inFlight = 0;
+	lent = 0;
+	recorded = ~0u;
+
+	slots.resize(slotCount);
+	for (uint32_t i = 0; i < slotCount; i++) {
+		slots[i] = Slot();
+		slots[i].size = 0;
+		slots[i].mapped = nullptr;
+		slots[i].lent = false;
+		slots[i].fence = makeHandle(device, device.createFence(vk::FenceCreateInfo()));
+	}
+}
+
+void ReadbackRing::destroy()
+{
+	if (slots.empty()) {
+		return;
+	}
+	flush([](const ReadbackFrame&) {});
+	for (auto& slot : slots) {
+		release(slot);
+		slot.fence.reset();
+	}
+	slots.clear();
+	lent = 0;
+}
+
+void ReadbackRing::allocate(Slot& slot, vk::DeviceSize size)
+{
+	release(slot);
+
+	vk::BufferCreateInfo bufferInfo = vk::BufferCreateInfo()
+		.setSize(size)
+		.setUsage(vk::BufferUsageFlagBits::eTransferDst)
+		.setSharingMode(vk::SharingMode::eExclusive);
+	slot.buffer = makeHandle(device, device.createBuffer(bufferInfo));
+
+	// The CPU reads every byte, so cached memory is worth an invalidate
+	vk::MemoryRequirements memRequirements = device.getBufferMemoryRequirements(slot.buffer);
+	auto memProperties = physicalDevice.getMemoryProperties();
+	const vk::MemoryPropertyFlags preferred[] = {
+		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached,
+		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+	};
+	uint32_t memoryType = ~0u;
+	for (vk::MemoryPropertyFlags properties : preferred) {
+		for (uint32_t i = 0; i < memProperties.memoryTypeCount && memoryType == ~0u; i++) {
+			if ((memRequirements.memoryTypeBits & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+				memoryType = i;
+			}
+		}
+	}
+	if (memoryType == ~0u) {
+		throw std::runtime_error("failed to find suitable memory type");
+	}
+	coherent = (bool)(memProperties.memoryTypes[memoryType].propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent);
+
+	vk::MemoryAllocateInfo memoryInfo = vk::MemoryAllocateInfo()
+		.setAllocationSize(memRequirements.size)
+		.setMemoryTypeIndex(memoryType);
+	slot.memory = makeHandle(device, MemoryTracker::allocate(device, memoryInfo, MemoryCategory::Readback, size));
+	device.bindBufferMemory(slot.buffer, slot.memory, 0);
+	slot.mapped = (uint8_t*)device.mapMemory(slot.memory, 0, VK_WHOLE_SIZE);
+	slot.size = size;
+	DEBUG_NAME(device, slot.buffer, "readback");
+	DEBUG_NAME(device, slot.memory, "readback");
+}
+
+void ReadbackRing::release(Slot& slot)
+{
+	if (!slot.buffer) {
+		return;
+	}
+	device.unmapMemory(slot.memory);
+	slot.buffer.reset();
+	slot.memory.reset();
+	slot.mapped = nullptr;
+	slot.size = 0;
+}
+
+vk::DeviceSize ReadbackRing::trim()
+{
+	if (inFlight > 0 || lent > 0 || recorded != ~0u) {
+		return 0;
+	}
+	vk::DeviceSize freed = 0;
+	for (auto& slot : slots) {
+		freed += slot.size;
+		release(slot);
+	}
+	return freed;
+}
+
+uint32_t ReadbackRing::pixelSize(vk::Format format)
+{
+	switch (format) {
+	case vk::Format::eB8G8R8A8Unorm:
+	case vk::Format::eB8G8R8A8Srgb:
+	case vk::Format::eR8G8B8A8Unorm:
+	case vk::Format::eR8G8B8A8Srgb:
+	case vk::Format::eA2B10G10R10UnormPack32:
+	case vk::Format::eA2R10G10B10UnormPack32:
+		return 4;
+	case vk::Format::eR16G16B16A16Sfloat:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+bool ReadbackRing::record(vk::CommandBuffer commandBuffer, vk::Image image, vk::Format format,
+	vk::Extent2D extent, uint64_t frame)
+{
+	uint32_t pixel = pixelSize(format);
+	if (inFlight == slots.size() || pixel == 0) {
+		return false;
+	}
+	uint32_t index = (next + inFlight) % slots.size();
+	Slot& slot = slots[index];
+	if (slot.lent) {
+		return false;
+	}
+
+	vk::DeviceSize size = (vk::DeviceSize)extent.width * extent.height * pixel;
+	if (slot.size < size) {
+		allocate(slot, size);
+	}
+	slot.frame = { frame, format, extent, extent.width * pixel, slot.mapped };
+
+	DEBUG_LABEL_BEGIN(commandBuffer, "readback");
+	vk::BufferImageCopy region = vk::BufferImageCopy()
+		.setBufferOffset(0)
+		.setBufferRowLength(0)
+		.setBufferImageHeight(0)
+		.setImageSubresource(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1))
+		.setImageOffset({ 0, 0, 0 })
+		.setImageExtent({ extent.width, extent.height, 1 });
+	commandBuffer.copyImageToBuffer(image, vk::ImageLayout::eTransferSrcOptimal, slot.buffer, { region });
+
+	// The copy made visible to the host once the slot's fence has signalled
+	vk::BufferMemoryBarrier toHost = vk::BufferMemoryBarrier()
+		.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+		.setDstAccessMask(vk::AccessFlagBits::eHostRead)
+		.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+		.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+		.setBuffer(slot.buffer)
+		.setOffset(0)
+		.setSize(size);
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+		vk::DependencyFlags(), nullptr, { toHost }, nullptr);
+	DEBUG_LABEL_END(commandBuffer);
+	recorded = index;
+	return true;
+}
+
+void ReadbackRing::submitted(vk::Queue queue)
+{
+	if (recorded == ~0u) {
+		return;
+	}
+	// An empty batch signals its fence once everything submitted before it
+	// has completed, copy included
+	Slot& slot = slots[recorded];
+	queue.submit(nullptr, slot.fence);
+	inFlight++;
+	recorded = ~0u;
+}
+
+template <typename F>
+void ReadbackRing::complete(F ready)
+{
+	while (inFlight > 0) {
+		uint32_t index = next;
+		Slot& slot = slots[index];
+		if (device.getFenceStatus(slot.fence) != vk::Result::eSuccess) {
+			return;
+		}
+		if (!coherent) {
+			device.invalidateMappedMemoryRanges({ vk::MappedMemoryRange(slot.memory, 0, VK_WHOLE_SIZE) });
+		}
+		device.resetFences({ slot.fence.get() });
+		next = (next + 1) % slots.size();
+		inFlight--;
+		ready(index, slot);
+	}
+}
+
+void ReadbackRing::poll(const std::function<void(const ReadbackFrame&)>& ready)
+{
+	complete([&](uint32_t index, Slot& slot) {
+		ready(slot.frame);
+	});
+}
+
+void ReadbackRing::lend(const std::function<void(uint32_t slot, const ReadbackFrame&)>& borrow)
+{
+	complete([&](uint32_t index, Slot& slot) {
+		slot.lent = true;
+		lent++;
+		borrow(index, slot.frame);
+	});
+}
+
+void ReadbackRing::reclaim(uint32_t slot)
+{
+	if (slots[slot].lent) {
+		slots[slot].lent = false;
+		lent--;
+	}
+}
+
+void ReadbackRing::wait()
+{
+	if (inFlight > 0) {
+		std::vector<vk::Fence> fences;
+		for (uint32_t i = 0; i < inFlight; i++) {
+			fences.push_back(slots[(next + i) % slots.size()].fence);
+		}
+		device.waitForFences(fences, VK_TRUE, std::numeric_limits<uint64_t>::max());
+	}
+}
+
+void ReadbackRing::flush(const std::function<void(const ReadbackFrame&)>& ready)
+{
+	wait();
+	poll(ready);
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vulkan\vulkan.hpp>
+#include <functional>
+#include <vector>
+
+#include "Handle.h"
+
+// A copy of an image sitting in host memory, valid only while the
+// callback it was handed to runs, or until a lent slot is reclaimed
+struct ReadbackFrame {
+	uint64_t frame;	// whatever record() was given
+	vk::Format format;
+	vk::Extent2D extent;
+	uint32_t rowPitch;	// bytes
+	const uint8_t* data;
+};
+
+// Host-visible buffers that images are copied into without the frame loop
+// waiting on the copy. record() picks a free slot and records the copy
+// into the frame's command buffer, after whatever put the image in
+// eTransferSrcOptimal, e.g. a RenderGraph pass reading it with
+// RenderAccess::TransferSrc. Each slot has its own fence; poll() hands every
+// slot whose fence has signalled to a callback and frees it again. lend()
+// instead leaves the slot with the caller until reclaim(), so the copy can
+// be read elsewhere without being copied again.
+class ReadbackRing
+{
+private:
+	struct Slot {
+		DeviceHandle<vk::Buffer> buffer;
+		DeviceHandle<vk::DeviceMemory> memory;
+		vk::DeviceSize size;
+		uint8_t* mapped;
+		DeviceHandle<vk::Fence> fence;
+		ReadbackFrame frame;
+		bool lent;
+	};
+
+	vk::Device device;
+	vk::PhysicalDevice physicalDevice;
+	std::vector<Slot> slots;
+	uint32_t next;	// the oldest slot in flight, or the next to use
+	uint32_t inFlight;
+	uint32_t lent;
+	uint32_t recorded;	// waiting for submitted(); ~0u when none
+	bool coherent;
+
+	void allocate(Slot& slot, vk::DeviceSize size);
+	void release(Slot& slot);
+	template <typename F>
+	void complete(F ready);
+public:
+	ReadbackRing();
+	~ReadbackRing();
+
+	void create(vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t slotCount);
+	// Waits for every copy still in flight. Every lent slot must have been
+	// reclaimed, or at least no longer be read.
+	void destroy();
+
+	// Records a copy of image, in eTransferSrcOptimal and with the transfer
+	// stage already waiting on its writers, into commandBuffer. Returns false
+	// when every slot is still busy.
+	bool record(vk::CommandBuffer commandBuffer, vk::Image image, vk::Format format, vk::Extent2D extent,
+		uint64_t frame);
+	// Call once the command buffer given to record() has been submitted to queue
+	void submitted(vk::Queue queue);
+	// Hands completed copies to ready, oldest first, without waiting on any
+	void poll(const std::function<void(const ReadbackFrame&)>& ready);
+	// Like poll(), but each slot stays with the caller, its data valid,
+	// until it is reclaimed; record() skips lent slots meanwhile
+	void lend(const std::function<void(uint32_t slot, const ReadbackFrame&)>& borrow);
+	void reclaim(uint32_t slot);
+	// Waits for every copy in flight, to be handed out by poll() or lend()
+	void wait();
+	// Waits for every copy in flight and hands it to ready
+	void flush(const std::function<void(const ReadbackFrame&)>& ready);
+	// Frees the buffers of every slot when none is in use; record()
+	// allocates them again as needed. Returns the bytes freed.
+	vk::DeviceSize trim();
+
+	inline uint32_t slotCount() const { return (uint32_t)slots.size(); }
+	inline uint32_t busyCount() const { return inFlight + lent; }
+	// Bytes per pixel of the formats copies can be made of; 0 for the rest
+	static uint32_t pixelSize(vk::Format format);
+};
\ No newline at end of file
@@ -0,0 +1,450 @@
+#include "RenderGraph.h"
+#include "DebugUtils.h"
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+const uint32_t RenderGraph::NONE = UINT32_MAX;
+
+struct AccessInfo {
+	vk::ImageLayout layout;
+	vk::PipelineStageFlags stage;
+	vk::AccessFlags access;
+	vk::ImageUsageFlags usage;
+};
+
+static AccessInfo accessInfo(RenderAccess access)
+{
+	switch (access) {
+	case RenderAccess::ColorAttachment:
+		return { vk::ImageLayout::eColorAttachmentOptimal, vk::PipelineStageFlagBits::eColorAttachmentOutput,
+			vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite,
+			vk::ImageUsageFlagBits::eColorAttachment };
+	case RenderAccess::DepthAttachment:
+		return { vk::ImageLayout::eDepthStencilAttachmentOptimal,
+			vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+			vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+			vk::ImageUsageFlagBits::eDepthStencilAttachment };
+	case RenderAccess::DepthRead:
+		return { vk::ImageLayout::eDepthStencilReadOnlyOptimal,
+			vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+			vk::AccessFlagBits::eDepthStencilAttachmentRead,
+			vk::ImageUsageFlagBits::eDepthStencilAttachment };
+	case RenderAccess::Sampled:
+		return { vk::ImageLayout::eShaderReadOnlyOptimal, vk::PipelineStageFlagBits::eFragmentShader,
+			vk::AccessFlagBits::eShaderRead, vk::ImageUsageFlagBits::eSampled };
+	case RenderAccess::TransferSrc:
+		return { vk::ImageLayout::eTransferSrcOptimal, vk::PipelineStageFlagBits::eTransfer,
+			vk::AccessFlagBits::eTransferRead, vk::ImageUsageFlagBits::eTransferSrc };
+	case RenderAccess::TransferDst:
+		return { vk::ImageLayout::eTransferDstOptimal, vk::PipelineStageFlagBits::eTransfer,
+			vk::AccessFlagBits::eTransferWrite, vk::ImageUsageFlagBits::eTransferDst };
+	}
+	throw std::runtime_error("unknown render access!");
+}
+
+static bool isDepthFormat(vk::Format format)
+{
+	return format == vk::Format::eD16Unorm || format == vk::Format::eX8D24UnormPack32 ||
+		format == vk::Format::eD32Sfloat || format == vk::Format::eD16UnormS8Uint ||
+		format == vk::Format::eD24UnormS8Uint || format == vk::Format::eD32SfloatS8Uint;
+}
+
+static bool hasStencil(vk::Format format)
+{
+	return format == vk::Format::eD16UnormS8Uint || format == vk::Format::eD24UnormS8Uint ||
+		format == vk::Format::eD32SfloatS8Uint;
+}
+
+RenderGraph::RenderGraph()
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+}
+
+RenderGraph::Resource RenderGraph::importImage(const std::string& name, const RenderImageInfo& info,
+	vk::ImageLayout initialLayout, vk::ImageLayout finalLayout)
+{
+	Resource resource = createImage(name, info);
+	images[resource].imported = true;
+	images[resource].initialLayout = initialLayout;
+	images[resource].finalLayout = finalLayout;
+	return resource;
+}
+
+RenderGraph::Resource RenderGraph::createImage(const std::string& name, const RenderImageInfo& info)
+{
+	Image image;
+	image.name = name;
+	image.info = info;
+	image.imported = false;
+	image.initialLayout = vk::ImageLayout::eUndefined;
+	image.finalLayout = vk::ImageLayout::eUndefined;
+	image.aspect = vk::ImageAspectFlagBits::eColor;
+	if (isDepthFormat(info.format)) {
+		image.aspect = vk::ImageAspectFlagBits::eDepth;
+		if (hasStencil(info.format)) {
+			image.aspect |= vk::ImageAspectFlagBits::eStencil;
+		}
+	}
+	image.first = NONE;
+	image.last = NONE;
+	image.block = NONE;
+	images.push_back(std::move(image));
+	return (Resource)(images.size() - 1);
+}
+
+uint32_t RenderGraph::addPass(const std::string& name, Record record)
+{
+	passes.push_back({ name, record, {}, false });
+	return (uint32_t)(passes.size() - 1);
+}
+
+void RenderGraph::read(uint32_t pass, Resource resource, RenderAccess access)
+{
+	use(pass, resource, access, false);
+}
+
+void RenderGraph::write(uint32_t pass, Resource resource, RenderAccess access)
+{
+	use(pass, resource, access, true);
+}
+
+void RenderGraph::keep(uint32_t pass)
+{
+	passes[pass].kept = true;
+}
+
+void RenderGraph::use(uint32_t pass, Resource resource, RenderAccess access, bool write)
+{
+	for (const auto& existing : passes[pass].uses) {
+		if (existing.resource == resource) {
+			throw std::runtime_error("pass uses an image twice: " + passes[pass].name);
+		}
+	}
+	passes[pass].uses.push_back({ resource, access, write });
+	images[resource].usage |= accessInfo(access).usage;
+}
+
+void RenderGraph::cull(std::vector<bool>& live) const
+{
+	// Walk backwards from the passes with visible results: a pass is kept
+	// when it was marked with keep(), or writes an imported image or
+	// anything a kept pass uses. Kept passes may load or blend what they
+	// write, so earlier writers of the same image stay too.
+	live.assign(passes.size(), false);
+	std::vector<bool> needed(images.size(), false);
+	for (size_t i = 0; i < images.size(); i++) {
+		needed[i] = images[i].imported;
+	}
+	for (size_t p = passes.size(); p-- > 0;) {
+		live[p] = passes[p].kept;
+		for (const auto& use : passes[p].uses) {
+			if (use.write && needed[use.resource]) {
+				live[p] = true;
+			}
+		}
+		if (live[p]) {
+			for (const auto& use : passes[p].uses) {
+				needed[use.resource] = true;
+			}
+		}
+	}
+}
+
+void RenderGraph::compile(const std::function<vk::MemoryRequirements(Resource)>& requirements)
+{
+	std::vector<bool> live;
+	cull(live);
+
+	steps.clear();
+	for (auto& image : images) {
+		image.first = NONE;
+		image.last = NONE;
+	}
+	for (uint32_t p = 0; p < passes.size(); p++) {
+		if (!live[p]) {
+			continue;
+		}
+		uint32_t step = (uint32_t)steps.size();
+		steps.push_back({ p, {} });
+		for (const auto& use : passes[p].uses) {
+			Image& image = images[use.resource];
+			if (image.first == NONE) {
+				if (!use.write && !image.imported) {
+					throw std::runtime_error("transient image read before it is written: " + image.name);
+				}
+				image.first = step;
+			}
+			image.last = step;
+		}
+	}
+
+	alias(requirements);
+	deriveBarriers();
+}
+
+void RenderGraph::alias(const std::function<vk::MemoryRequirements(Resource)>& requirements)
+{
+	// Greedy interval packing: transients in order of first use, each into
+	// the first block whose previous occupant is finished with it
+	std::vector<Resource> order;
+	for (Resource r = 0; r < images.size(); r++) {
+		images[r].block = NONE;
+		if (!images[r].imported && images[r].first != NONE) {
+			order.push_back(r);
+		}
+	}
+	std::stable_sort(order.begin(), order.end(), [this](Resource a, Resource b) {
+		return images[a].first < images[b].first;
+	});
+
+	blocks.clear();
+	std::vector<uint32_t> blockEnd;
+	for (Resource r : order) {
+		vk::MemoryRequirements memory = requirements ? requirements(r) : vk::MemoryRequirements();
+		uint32_t found = NONE;
+		if (requirements) {
+			for (uint32_t b = 0; b < blocks.size(); b++) {
+				if (blockEnd[b] < images[r].first && (blocks[b].memoryTypeBits & memory.memoryTypeBits)) {
+					found = b;
+					break;
+				}
+			}
+		}
+		if (found == NONE) {
+			found = (uint32_t)blocks.size();
+			blocks.push_back({ 0, memory.memoryTypeBits ? memory.memoryTypeBits : ~0u, {} });
+			blockEnd.push_back(0);
+		}
+		// Every image sits at offset 0, so only the size has to grow
+		Block& block = blocks[found];
+		block.size = std::max(block.size, memory.size);
+		if (memory.memoryTypeBits) {
+			block.memoryTypeBits &= memory.memoryTypeBits;
+		}
+		blockEnd[found] = images[r].last;
+		images[r].block = found;
+	}
+}
+
+void RenderGraph::deriveBarriers()
+{
+	struct State {
+		vk::ImageLayout layout;
+		vk::PipelineStageFlags stage;
+		vk::AccessFlags access;
+		bool written;
+		bool touched;
+	};
+	std::vector<State> states(images.size());
+	for (size_t i = 0; i < images.size(); i++) {
+		states[i] = { images[i].initialLayout, vk::PipelineStageFlags(), vk::AccessFlags(), false, false };
+	}
+	// The last state of whichever image used each block before
+	std::vector<State> blockStates(blocks.size(), { vk::ImageLayout::eUndefined,
+		vk::PipelineStageFlags(), vk::AccessFlags(), false, false });
+	// Barriers for the first use of each block in the frame; they wait on
+	// the block's last use, which the previous frame may still be running
+	struct Wrap {
+		size_t step;
+		size_t barrier;
+		uint32_t block;
+	};
+	std::vector<Wrap> wraps;
+
+	finalBarriers.clear();
+	for (size_t s = 0; s < steps.size(); s++) {
+		Step& step = steps[s];
+		for (const auto& use : passes[step.pass].uses) {
+			AccessInfo info = accessInfo(use.access);
+			State& state = states[use.resource];
+			const Image& image = images[use.resource];
+			Barrier barrier = { use.resource, state.layout, info.layout,
+				state.stage, info.stage, state.access, info.access };
+
+			bool needed = true;
+			bool wrap = false;
+			if (!state.touched) {
+				if (image.block != NONE && blockStates[image.block].touched) {
+					// Aliased: wait for the previous occupant, discard its contents
+					barrier.srcStage = blockStates[image.block].stage;
+					barrier.srcAccess = blockStates[image.block].access;
+					barrier.oldLayout = vk::ImageLayout::eUndefined;
+				}
+				else {
+					// Nothing earlier in the frame; waiting on the same stage
+					// chains with a semaphore wait there, e.g. on image acquire
+					barrier.srcStage = info.stage;
+					barrier.srcAccess = vk::AccessFlags();
+					needed = barrier.oldLayout != barrier.newLayout;
+					wrap = image.block != NONE;
+				}
+			}
+			else if (state.layout == info.layout && !state.written && !use.write) {
+				// Read after read in the same layout; later writers wait on both
+				needed = false;
+				state.stage |= info.stage;
+				state.access |= info.access;
+			}
+
+			if (needed) {
+				step.barriers.push_back(barrier);
+				if (wrap) {
+					wraps.push_back({ s, step.barriers.size() - 1, image.block });
+				}
+			}
+			if (needed || !state.touched) {
+				state = { info.layout, info.stage, info.access, use.write, true };
+			}
+			if (image.block != NONE) {
+				blockStates[image.block] = state;
+			}
+		}
+	}
+
+	for (const auto& wrap : wraps) {
+		Barrier& barrier = steps[wrap.step].barriers[wrap.barrier];
+		barrier.srcStage = blockStates[wrap.block].stage;
+		barrier.srcAccess = blockStates[wrap.block].access;
+	}
+
+	for (Resource r = 0; r < images.size(); r++) {
+		const Image& image = images[r];
+		const State& state = states[r];
+		if (image.imported && image.finalLayout != vk::ImageLayout::eUndefined &&
+			(state.layout != image.finalLayout || state.written)) {
+			finalBarriers.push_back({ r, state.layout, image.finalLayout,
+				state.touched ? state.stage : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eTopOfPipe),
+				vk::PipelineStageFlagBits::eBottomOfPipe, state.access, vk::AccessFlags() });
+		}
+	}
+}
+
+void RenderGraph::realize(vk::Device device, const std::function<uint32_t(uint32_t memoryTypeBits)>& memoryType)
+{
+	this->device = device;
+	for (auto& image : images) {
+		if (image.imported || image.usage == vk::ImageUsageFlags()) {
+			continue;
+		}
+		// Only ever an attachment: on tilers it can live in tile memory alone
+		vk::ImageUsageFlags usage = image.usage;
+		vk::ImageUsageFlags attachment = vk::ImageUsageFlagBits::eColorAttachment |
+			vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eInputAttachment;
+		if ((usage & attachment) == usage) {
+			usage |= vk::ImageUsageFlagBits::eTransientAttachment;
+		}
+		vk::ImageCreateInfo imageInfo = vk::ImageCreateInfo()
+			.setImageType(vk::ImageType::e2D)
+			.setFormat(image.info.format)
+			.setExtent(vk::Extent3D(image.info.extent.width, image.info.extent.height, 1))
+			.setMipLevels(1)
+			.setArrayLayers(1)
+			.setSamples(image.info.samples)
+			.setTiling(vk::ImageTiling::eOptimal)
+			.setUsage(usage)
+			.setSharingMode(vk::SharingMode::eExclusive)
+			.setInitialLayout(vk::ImageLayout::eUndefined);
+		image.owned = makeHandle(device, device.createImage(imageInfo));
+		image.image = image.owned;
+		DEBUG_NAME(device, image.owned, image.name);
+	}
+
+	compile([this, device](Resource resource) {
+		return device.getImageMemoryRequirements(images[resource].image);
+	});
+
+	for (auto& block : blocks) {
+		vk::MemoryAllocateInfo allocInfo = vk::MemoryAllocateInfo()
+			.setAllocationSize(block.size)
+			.setMemoryTypeIndex(memoryType(block.memoryTypeBits));
+		block.memory = makeHandle(device, MemoryTracker::allocate(device, allocInfo, MemoryCategory::Image));
+	}
+	for (auto& image : images) {
+		if (!image.image || image.imported) {
+			continue;
+		}
+		if (image.block == NONE) {
+			// Culled: never used, so never backed
+			image.owned.reset();
+			image.image = nullptr;
+			continue;
+		}
+		device.bindImageMemory(image.image, blocks[image.block].memory, 0);
+		vk::ImageViewCreateInfo viewInfo = vk::ImageViewCreateInfo()
+			.setImage(image.image)
+			.setViewType(vk::ImageViewType::e2D)
+			.setFormat(image.info.format)
+			.setSubresourceRange(vk::ImageSubresourceRange(image.aspect, 0, 1, 0, 1));
+		image.view = makeHandle(device, device.createImageView(viewInfo));
+		DEBUG_NAME(device, image.view, image.name);
+	}
+}
+
+void RenderGraph::destroy()
+{
+	// Views and images go before the memory they are bound to
+	passes.clear();
+	images.clear();
+	steps.clear();
+	finalBarriers.clear();
+	blocks.clear();
+}
+
+void RenderGraph::bind(Resource resource, vk::Image image)
+{
+	images[resource].image = image;
+}
+
+static void recordBarriers(vk::CommandBuffer commandBuffer, const std::vector<RenderGraph::Barrier>& barriers,
+	const std::function<vk::Image(RenderGraph::Resource)>& image,
+	const std::function<vk::ImageAspectFlags(RenderGraph::Resource)>& aspect)
+{
+	if (barriers.empty()) {
+		return;
+	}
+	// One call per step, waiting on the union of the stages involved
+	std::vector<vk::ImageMemoryBarrier> imageBarriers;
+	vk::PipelineStageFlags srcStage;
+	vk::PipelineStageFlags dstStage;
+	for (const auto& barrier : barriers) {
+		imageBarriers.push_back(vk::ImageMemoryBarrier()
+			.setSrcAccessMask(barrier.srcAccess)
+			.setDstAccessMask(barrier.dstAccess)
+			.setOldLayout(barrier.oldLayout)
+			.setNewLayout(barrier.newLayout)
+			.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+			.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+			.setImage(image(barrier.resource))
+			.setSubresourceRange(vk::ImageSubresourceRange(aspect(barrier.resource), 0, 1, 0, 1)));
+		srcStage |= barrier.srcStage;
+		dstStage |= barrier.dstStage;
+	}
+	commandBuffer.pipelineBarrier(srcStage, dstStage, vk::DependencyFlags(), nullptr, nullptr, imageBarriers);
+}
+
+void RenderGraph::execute(vk::CommandBuffer commandBuffer, uint32_t index) const
+{
+	auto image = [this](Resource resource) { return images[resource].image; };
+	auto aspect = [this](Resource resource) { return images[resource].aspect; };
+	for (const auto& step : steps) {
+		DEBUG_LABEL(commandBuffer, passes[step.pass].name);
+		recordBarriers(commandBuffer, step.barriers, image, aspect);
+		passes[step.pass].record(commandBuffer, index);
+	}
+	recordBarriers(commandBuffer, finalBarriers, image, aspect);
+}
+
+vk::ImageLayout RenderGraph::layout(uint32_t pass, Resource resource) const
+{
+	for (const auto& use : passes[pass].uses) {
+		if (use.resource == resource) {
+			return accessInfo(use.access).layout;
+		}
+	}
+	throw std::runtime_error("pass does not use image: " + images[resource].name);
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <vulkan\vulkan.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Handle.h"
+
+// How a pass touches an image
+enum class RenderAccess {
+	ColorAttachment,	// rendered to
+	DepthAttachment,	// depth tested and written
+	DepthRead,	// depth tested only
+	Sampled,	// read in a fragment shader
+	TransferSrc,
+	TransferDst
+};
+
+struct RenderImageInfo {
+	vk::Format format;
+	vk::Extent2D extent;
+	vk::SampleCountFlagBits samples;
+};
+
+// A frame described as passes that declare the images they read and write.
+// compile() culls passes whose output nobody reads, works out the layout
+// transitions and barriers between the rest, and lets transient images
+// whose lifetimes do not overlap share memory. compile() only looks at the
+// declarations, so it runs without a device; realize() creates the
+// transient images and their memory, and execute() records the barriers
+// and calls each pass in turn.
+//
+// Transient images are shared by every frame in flight, so the first
+// barrier on each waits for the last use of its memory in the frame before.
+//
+// Passes run in the order they are added, which has to be an order in
+// which every image is written before it is read. Each pass records its
+// own vk::RenderPass if it needs one, with the attachment layouts the
+// graph put its images in (see layout()).
+class RenderGraph
+{
+public:
+	typedef uint32_t Resource;
+	// index is whatever execute() was given, e.g. the swap chain image
+	typedef std::function<void(vk::CommandBuffer, uint32_t index)> Record;
+
+	struct Barrier {
+		Resource resource;
+		vk::ImageLayout oldLayout;
+		vk::ImageLayout newLayout;
+		vk::PipelineStageFlags srcStage;
+		vk::PipelineStageFlags dstStage;
+		vk::AccessFlags srcAccess;
+		vk::AccessFlags dstAccess;
+	};
+
+	// One surviving pass and the barriers recorded before it
+	struct Step {
+		uint32_t pass;
+		std::vector<Barrier> barriers;
+	};
+
+	static const uint32_t NONE;
+private:
+	struct Use {
+		Resource resource;
+		RenderAccess access;
+		bool write;
+	};
+
+	struct Pass {
+		std::string name;
+		Record record;
+		std::vector<Use> uses;
+		bool kept;
+	};
+
+	struct Image {
+		std::string name;
+		RenderImageInfo info;
+		bool imported;
+		vk::ImageLayout initialLayout;
+		vk::ImageLayout finalLayout;
+		vk::ImageUsageFlags usage;
+		vk::ImageAspectFlags aspect;
+		uint32_t first;	// step of the first and last use; NONE when culled
+		uint32_t last;
+		uint32_t block;	// memory shared with other transients
+		vk::Image image;	// owned when transient, bound by bind() when imported
+		DeviceHandle<vk::Image> owned;
+		DeviceHandle<vk::ImageView> view;
+	};
+
+	struct Block {
+		vk::DeviceSize size;
+		uint32_t memoryTypeBits;
+		DeviceHandle<vk::DeviceMemory> memory;
+	};
+
+	std::vector<Pass> passes;
+	std::vector<Image> images;
+	std::vector<Step> steps;
+	std::vector<Barrier> finalBarriers;
+	std::vector<Block> blocks;
+	vk::Device device;
+
+	void use(uint32_t pass, Resource resource, RenderAccess access, bool write);
+	void cull(std::vector<bool>& live) const;
+	void alias(const std::function<vk::MemoryRequirements(Resource)>& requirements);
+	void deriveBarriers();
+public:
+	RenderGraph();
+	~RenderGraph();
+
+	// An image owned outside the graph, e.g. a swap chain image; bind() it
+	// before each execute(). Passes writing it are never culled.
+	Resource importImage(const std::string& name, const RenderImageInfo& info,
+		vk::ImageLayout initialLayout, vk::ImageLayout finalLayout);
+	// An image that only lives for the frame; its contents start undefined
+	Resource createImage(const std::string& name, const RenderImageInfo& info);
+
+	uint32_t addPass(const std::string& name, Record record);
+	void read(uint32_t pass, Resource resource, RenderAccess access);
+	void write(uint32_t pass, Resource resource, RenderAccess access);
+	// For a pass whose results leave the graph some other way, e.g. a copy
+	// into a host buffer: it is never culled
+	void keep(uint32_t pass);
+
+	// requirements gives the size and memory types of each transient image;
+	// without it transients never share memory
+	void compile(const std::function<vk::MemoryRequirements(Resource)>& requirements = nullptr);
+	// Creates the transient images, compiles, then allocates and binds one
+	// vk::DeviceMemory per aliasing block
+	void realize(vk::Device device, const std::function<uint32_t(uint32_t memoryTypeBits)>& memoryType);
+	// Frees everything realize() made and forgets every declaration
+	void destroy();
+
+	void bind(Resource resource, vk::Image image);
+	void execute(vk::CommandBuffer commandBuffer, uint32_t index) const;
+
+	inline const std::vector<Step>& compiled() const { return steps; }
+	inline const std::vector<Barrier>& finalTransitions() const { return finalBarriers; }
+	inline const std::string& passName(uint32_t pass) const { return passes[pass].name; }
+	inline size_t blockCount() const { return blocks.size(); }
+	inline uint32_t memoryBlock(Resource resource) const { return images[resource].block; }
+	inline vk::ImageView view(Resource resource) const { return images[resource].view; }
+	// The layout a resource is in while pass runs
+	vk::ImageLayout layout(uint32_t pass, Resource resource) const;
+};
\ No newline at end of file
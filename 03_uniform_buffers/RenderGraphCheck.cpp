@@ -0,0 +1,132 @@
+#include "RenderGraphCheck.h"
+#include "RenderGraph.h"
+
+#include <Windows.h>
+#include <string>
+
+static void expect(bool condition, const std::string& what, int& failures)
+{
+	if (!condition) {
+		OutputDebugStringA(("render graph check failed: " + what + "\n").c_str());
+		failures++;
+	}
+}
+
+static const RenderGraph::Step* findStep(const RenderGraph& graph, const std::string& pass)
+{
+	for (const auto& step : graph.compiled()) {
+		if (graph.passName(step.pass) == pass) {
+			return &step;
+		}
+	}
+	return nullptr;
+}
+
+static const RenderGraph::Barrier* findBarrier(const std::vector<RenderGraph::Barrier>& barriers,
+	RenderGraph::Resource resource)
+{
+	for (const auto& barrier : barriers) {
+		if (barrier.resource == resource) {
+			return &barrier;
+		}
+	}
+	return nullptr;
+}
+
+// The barrier recorded before pass for resource, or null
+static const RenderGraph::Barrier* barrierBefore(const RenderGraph& graph, const std::string& pass,
+	RenderGraph::Resource resource)
+{
+	const RenderGraph::Step* step = findStep(graph, pass);
+	return step ? findBarrier(step->barriers, resource) : nullptr;
+}
+
+bool RenderGraphCheck::run()
+{
+	// shadow -> scene -> tonemap -> compose -> readback, plus a pass whose
+	// output nobody reads
+	const vk::Extent2D extent(640, 480);
+	const vk::SampleCountFlagBits e1 = vk::SampleCountFlagBits::e1;
+	RenderGraph graph;
+	RenderGraph::Resource swap = graph.importImage("swapchain", { vk::Format::eB8G8R8A8Srgb, extent, e1 },
+		vk::ImageLayout::eUndefined, vk::ImageLayout::ePresentSrcKHR);
+	RenderGraph::Resource shadow = graph.createImage("shadow", { vk::Format::eD32Sfloat, vk::Extent2D(1024, 1024), e1 });
+	RenderGraph::Resource depth = graph.createImage("depth", { vk::Format::eD32Sfloat, extent, e1 });
+	RenderGraph::Resource post = graph.createImage("post", { vk::Format::eR16G16B16A16Sfloat, extent, e1 });
+	RenderGraph::Resource ldr = graph.createImage("ldr", { vk::Format::eR8G8B8A8Unorm, extent, e1 });
+	RenderGraph::Resource bloom = graph.createImage("bloom", { vk::Format::eR16G16B16A16Sfloat, extent, e1 });
+
+	RenderGraph::Record nothing = [](vk::CommandBuffer, uint32_t) {};
+	uint32_t pass = graph.addPass("shadow", nothing);
+	graph.write(pass, shadow, RenderAccess::DepthAttachment);
+	pass = graph.addPass("scene", nothing);
+	graph.read(pass, shadow, RenderAccess::Sampled);
+	graph.write(pass, depth, RenderAccess::DepthAttachment);
+	graph.write(pass, post, RenderAccess::ColorAttachment);
+	pass = graph.addPass("unused", nothing);
+	graph.read(pass, post, RenderAccess::Sampled);
+	graph.write(pass, bloom, RenderAccess::ColorAttachment);
+	pass = graph.addPass("tonemap", nothing);
+	graph.read(pass, post, RenderAccess::Sampled);
+	graph.write(pass, ldr, RenderAccess::ColorAttachment);
+	pass = graph.addPass("compose", nothing);
+	graph.read(pass, ldr, RenderAccess::Sampled);
+	graph.write(pass, swap, RenderAccess::ColorAttachment);
+	pass = graph.addPass("readback", nothing);
+	graph.read(pass, swap, RenderAccess::TransferSrc);
+	graph.keep(pass);
+
+	// Every transient fits every block, so only lifetimes decide sharing
+	graph.compile([](RenderGraph::Resource) {
+		vk::MemoryRequirements requirements;
+		requirements.size = 1 << 20;
+		requirements.alignment = 256;
+		requirements.memoryTypeBits = 1;
+		return requirements;
+	});
+
+	int failures = 0;
+
+	// Culling
+	expect(graph.compiled().size() == 5, "expected 5 passes, got " + std::to_string(graph.compiled().size()), failures);
+	expect(!findStep(graph, "unused"), "the pass nobody reads was not culled", failures);
+	expect(findStep(graph, "readback") != nullptr, "the kept pass was culled", failures);
+	expect(graph.memoryBlock(bloom) == RenderGraph::NONE, "the culled pass's image was given memory", failures);
+
+	// Aliasing: shadow is done after scene, before ldr is first written
+	expect(graph.memoryBlock(ldr) == graph.memoryBlock(shadow), "ldr does not reuse shadow's memory", failures);
+	expect(graph.memoryBlock(post) != graph.memoryBlock(shadow) && graph.memoryBlock(post) != graph.memoryBlock(depth),
+		"post shares memory with an image it overlaps", failures);
+	expect(graph.blockCount() == 3, "expected 3 memory blocks, got " + std::to_string(graph.blockCount()), failures);
+
+	// Barriers between passes
+	const RenderGraph::Barrier* barrier = barrierBefore(graph, "tonemap", post);
+	expect(barrier && barrier->oldLayout == vk::ImageLayout::eColorAttachmentOptimal &&
+		barrier->newLayout == vk::ImageLayout::eShaderReadOnlyOptimal &&
+		barrier->srcStage == vk::PipelineStageFlags(vk::PipelineStageFlagBits::eColorAttachmentOutput) &&
+		barrier->dstStage == vk::PipelineStageFlags(vk::PipelineStageFlagBits::eFragmentShader),
+		"post is not made readable after scene writes it", failures);
+	barrier = barrierBefore(graph, "readback", swap);
+	expect(barrier && barrier->oldLayout == vk::ImageLayout::eColorAttachmentOptimal &&
+		barrier->newLayout == vk::ImageLayout::eTransferSrcOptimal,
+		"the swap chain image is not moved to eTransferSrcOptimal for readback", failures);
+	barrier = findBarrier(graph.finalTransitions(), swap);
+	expect(barrier && barrier->oldLayout == vk::ImageLayout::eTransferSrcOptimal &&
+		barrier->newLayout == vk::ImageLayout::ePresentSrcKHR &&
+		barrier->srcStage == vk::PipelineStageFlags(vk::PipelineStageFlagBits::eTransfer),
+		"the swap chain image is not moved to ePresentSrcKHR after readback", failures);
+
+	// First uses wait for the previous frame's last use of the same memory
+	barrier = barrierBefore(graph, "shadow", shadow);
+	expect(barrier && barrier->oldLayout == vk::ImageLayout::eUndefined &&
+		barrier->srcStage == vk::PipelineStageFlags(vk::PipelineStageFlagBits::eFragmentShader),
+		"shadow does not wait for the previous frame's reads of ldr", failures);
+	barrier = barrierBefore(graph, "scene", depth);
+	expect(barrier && (barrier->srcAccess & vk::AccessFlagBits::eDepthStencilAttachmentWrite),
+		"depth does not wait for the previous frame's depth writes", failures);
+
+	if (failures == 0) {
+		OutputDebugStringA("render graph check passed\n");
+	}
+	return failures == 0;
+}
\ No newline at end of file
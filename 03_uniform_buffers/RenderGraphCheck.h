@@ -0,0 +1,12 @@
+#pragma once
+
+// Compiles a made-up frame with RenderGraph and checks what compile() made
+// of it: which passes were culled, which transients share memory, and the
+// barriers between passes. compile() needs no device, so neither does this.
+// -check-render-graph runs it and exits with 1 if anything differs.
+class RenderGraphCheck
+{
+public:
+	// Logs every mismatch; true when there were none
+	static bool run();
+};
\ No newline at end of file
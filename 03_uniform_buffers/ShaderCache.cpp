@@ -0,0 +1,180 @@
+#include "ShaderCache.h"
+
+#include <Windows.h>
+#include <stdexcept>
+
+static const uint32_t SPIRV_MAGIC = 0x07230203;
+
+ShaderCache::ShaderCache()
+{
+}
+
+ShaderCache::~ShaderCache()
+{
+}
+
+void ShaderCache::create(vk::Device device)
+{
+	this->device = device;
+}
+
+void ShaderCache::destroy()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	modules.clear();
+	files.clear();
+	previous.clear();
+}
+
+vk::ShaderModule ShaderCache::load(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto known = files.find(path);
+	if (known != files.end()) {
+		return modules[known->second].module;
+	}
+
+	// FILE_SHARE_DELETE lets the shader watcher replace the file meanwhile
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("failed to open shader file!");
+	}
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	size_t size = (size_t)fileSize.QuadPart;
+
+	HANDLE mapping = size > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	const uint32_t* view = mapping ? (const uint32_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+	vk::ShaderModule module;
+	bool valid = view && size % sizeof(uint32_t) == 0 && view[0] == SPIRV_MAGIC;
+	if (valid) {
+		module = find(view, size);
+		files[path] = hash(view, size);
+	}
+
+	if (view) {
+		UnmapViewOfFile(view);
+	}
+	if (mapping) {
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+
+	if (!valid) {
+		throw std::runtime_error("shader file is not SPIR-V!");
+	}
+	return module;
+}
+
+vk::ShaderModule ShaderCache::get(const uint32_t* code, size_t size)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return find(code, size);
+}
+
+vk::ShaderModule ShaderCache::find(const uint32_t* code, size_t size)
+{
+	uint64_t key = hash(code, size);
+	auto cached = modules.find(key);
+	if (cached != modules.end()) {
+		return cached->second.module;
+	}
+
+	ShaderLayout layout = ShaderReflection::reflect(code, size);
+
+	vk::ShaderModuleCreateInfo createInfo = vk::ShaderModuleCreateInfo()
+		.setCodeSize(size)
+		.setPCode(code);
+	Entry& entry = modules[key];
+	entry.module = makeHandle(device, device.createShaderModule(createInfo));
+	entry.layout = layout;
+	return entry.module;
+}
+
+ShaderLayout ShaderCache::layout(vk::ShaderModule module)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const auto& entry : modules) {
+		if (entry.second.module.get() == module) {
+			return entry.second.layout;
+		}
+	}
+	throw std::runtime_error("shader module is not in the cache!");
+}
+
+void ShaderCache::invalidate(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto known = files.find(path);
+	if (known == files.end()) {
+		return;
+	}
+	uint64_t key = known->second;
+	files.erase(known);
+	// Invalidated again before the last reload was settled: only the
+	// module from before that reload is worth keeping
+	if (!previous.emplace(path, key).second) {
+		drop(key);
+	}
+}
+
+void ShaderCache::commit(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto replaced = previous.find(path);
+	if (replaced == previous.end()) {
+		return;
+	}
+	uint64_t key = replaced->second;
+	previous.erase(replaced);
+	drop(key);
+}
+
+void ShaderCache::revert(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto replaced = previous.find(path);
+	if (replaced == previous.end()) {
+		return;
+	}
+	auto known = files.find(path);
+	if (known != files.end()) {
+		uint64_t rejected = known->second;
+		known->second = replaced->second;
+		previous.erase(replaced);
+		drop(rejected);
+	}
+	else {
+		files[path] = replaced->second;
+		previous.erase(replaced);
+	}
+}
+
+void ShaderCache::drop(uint64_t key)
+{
+	for (const auto& file : files) {
+		if (file.second == key) {
+			return;
+		}
+	}
+	for (const auto& file : previous) {
+		if (file.second == key) {
+			return;
+		}
+	}
+	modules.erase(key);
+}
+
+uint64_t ShaderCache::hash(const uint32_t* code, size_t size)
+{
+	// FNV-1a over whole words, seeded with the length
+	uint64_t h = 14695981039346656037ull ^ size;
+	for (size_t i = 0; i < size / sizeof(uint32_t); i++) {
+		h ^= code[i];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vulkan\vulkan.hpp>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Handle.h"
+#include "ShaderReflection.h"
+
+// Owns every vk::ShaderModule the application creates, keyed by a hash of
+// the SPIR-V words, so identical code is only ever turned into one module.
+// A module a reload replaces is destroyed once the reload is settled;
+// pipelines do not need their modules after they are built. Files are mapped
+// rather than read: the view is page aligned, so the words are handed to
+// the driver in place without an intermediate copy. Each module is
+// reflected once when it is created.
+class ShaderCache
+{
+private:
+	vk::Device device;
+	// Loads may come from the shader watcher thread as well as the window
+	std::mutex mutex;
+	struct Entry {
+		DeviceHandle<vk::ShaderModule> module;
+		ShaderLayout layout;
+	};
+	std::unordered_map<uint64_t, Entry> modules;
+	// Path -> code hash of the last successful load; a hit skips all file I/O
+	std::unordered_map<std::string, uint64_t> files;
+	// Path -> code hash it had before invalidate(), until commit() or revert()
+	std::unordered_map<std::string, uint64_t> previous;
+
+	vk::ShaderModule find(const uint32_t* code, size_t size);
+	// Destroys the module unless a path still maps to it; mutex held
+	void drop(uint64_t key);
+public:
+	ShaderCache();
+	~ShaderCache();
+
+	void create(vk::Device device);
+	void destroy();
+
+	// Returns the module for a .spv file. Only the first call for a path
+	// touches the disk; later calls, e.g. from a pipeline rebuild, are a
+	// map lookup. Throws if the file is missing or is not SPIR-V.
+	vk::ShaderModule load(const std::string& path);
+	// Returns the module for code already in memory, such as an array
+	// compiled into the executable. size is in bytes.
+	vk::ShaderModule get(const uint32_t* code, size_t size);
+
+	// The reflected interface of a module returned by load() or get()
+	ShaderLayout layout(vk::ShaderModule module);
+
+	// Makes the next load() of path read the file again. The module path
+	// had is kept until commit() or revert() settles the reload.
+	void invalidate(const std::string& path);
+	// The reload of path was accepted: destroys the module it replaced
+	void commit(const std::string& path);
+	// The reload of path was rejected: path maps to its previous module
+	// again and the rejected one is destroyed
+	void revert(const std::string& path);
+
+	static uint64_t hash(const uint32_t* code, size_t size);
+};
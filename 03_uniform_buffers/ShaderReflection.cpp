@@ -0,0 +1,354 @@
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+// Opcodes, decorations and enumerants from the SPIR-V specification
+enum : uint32_t {
+	SpvMagic = 0x07230203,
+
+	OpEntryPoint = 15,
+	OpTypeInt = 21,
+	OpTypeFloat = 22,
+	OpTypeVector = 23,
+	OpTypeMatrix = 24,
+	OpTypeImage = 25,
+	OpTypeSampler = 26,
+	OpTypeSampledImage = 27,
+	OpTypeArray = 28,
+	OpTypeRuntimeArray = 29,
+	OpTypeStruct = 30,
+	OpTypePointer = 32,
+	OpConstant = 43,
+	OpVariable = 59,
+	OpDecorate = 71,
+	OpMemberDecorate = 72,
+
+	DecorationBlock = 2,
+	DecorationBufferBlock = 3,
+	DecorationArrayStride = 6,
+	DecorationMatrixStride = 7,
+	DecorationBuiltIn = 11,
+	DecorationLocation = 30,
+	DecorationBinding = 33,
+	DecorationDescriptorSet = 34,
+	DecorationOffset = 35,
+
+	StorageUniformConstant = 0,
+	StorageInput = 1,
+	StorageUniform = 2,
+	StoragePushConstant = 9,
+	StorageBuffer = 12,
+
+	DimBuffer = 5,
+	DimSubpassData = 6,
+};
+
+const uint32_t NONE = ~0u;
+
+struct Member {
+	uint32_t offset;
+	uint32_t matrixStride;
+};
+
+struct Id {
+	uint32_t word;	// first word of the defining instruction, 0 if none
+	uint32_t set;
+	uint32_t binding;
+	uint32_t location;
+	uint32_t arrayStride;
+	bool builtIn;
+	bool bufferBlock;
+	std::vector<Member> members;
+};
+
+class Module {
+private:
+	const uint32_t* code;
+	std::vector<Id> ids;
+public:
+	std::vector<uint32_t> variables;
+	vk::ShaderStageFlags stages;
+
+	Module(const uint32_t* code, size_t words)
+		: code(code)
+		, ids(code[3], { 0, NONE, NONE, NONE, 0, false, false, {} })
+	{
+		for (size_t word = 5; word < words; ) {
+			uint32_t opcode = code[word] & 0xffff;
+			uint32_t count = code[word] >> 16;
+			if (count == 0 || word + count > words) {
+				throw std::runtime_error("SPIR-V module is truncated!");
+			}
+			const uint32_t* in = code + word;
+
+			switch (opcode) {
+			case OpEntryPoint:
+				stages |= stage(in[1]);
+				break;
+			case OpDecorate:
+				decorate(id(in[1]), in[2], count > 3 ? in[3] : 0);
+				break;
+			case OpMemberDecorate: {
+				Id& target = id(in[1]);
+				if (target.members.size() <= in[2]) {
+					target.members.resize(in[2] + 1, { 0, 0 });
+				}
+				if (in[3] == DecorationOffset) {
+					target.members[in[2]].offset = in[4];
+				}
+				else if (in[3] == DecorationMatrixStride) {
+					target.members[in[2]].matrixStride = in[4];
+				}
+				break;
+			}
+			case OpTypeInt: case OpTypeFloat: case OpTypeVector: case OpTypeMatrix:
+			case OpTypeImage: case OpTypeSampler: case OpTypeSampledImage:
+			case OpTypeArray: case OpTypeRuntimeArray: case OpTypeStruct: case OpTypePointer:
+				id(in[1]).word = (uint32_t)word;
+				break;
+			case OpConstant:
+				id(in[2]).word = (uint32_t)word;
+				break;
+			case OpVariable:
+				id(in[2]).word = (uint32_t)word;
+				variables.push_back(in[2]);
+				break;
+			}
+			word += count;
+		}
+	}
+
+	Id& id(uint32_t value) {
+		if (value >= ids.size()) {
+			throw std::runtime_error("SPIR-V id is out of bounds!");
+		}
+		return ids[value];
+	}
+
+	const uint32_t* def(uint32_t value) {
+		Id& entry = id(value);
+		if (entry.word == 0) {
+			throw std::runtime_error("SPIR-V id is not defined!");
+		}
+		return code + entry.word;
+	}
+
+	uint32_t opcode(uint32_t value) { return def(value)[0] & 0xffff; }
+
+	void decorate(Id& target, uint32_t decoration, uint32_t value) {
+		switch (decoration) {
+		case DecorationBufferBlock: target.bufferBlock = true; break;
+		case DecorationArrayStride: target.arrayStride = value; break;
+		case DecorationBuiltIn: target.builtIn = true; break;
+		case DecorationLocation: target.location = value; break;
+		case DecorationBinding: target.binding = value; break;
+		case DecorationDescriptorSet: target.set = value; break;
+		}
+	}
+
+	static vk::ShaderStageFlags stage(uint32_t executionModel) {
+		switch (executionModel) {
+		case 0: return vk::ShaderStageFlagBits::eVertex;
+		case 1: return vk::ShaderStageFlagBits::eTessellationControl;
+		case 2: return vk::ShaderStageFlagBits::eTessellationEvaluation;
+		case 3: return vk::ShaderStageFlagBits::eGeometry;
+		case 4: return vk::ShaderStageFlagBits::eFragment;
+		case 5: return vk::ShaderStageFlagBits::eCompute;
+		}
+		return vk::ShaderStageFlags();
+	}
+
+	uint32_t constant(uint32_t value) {
+		const uint32_t* in = def(value);
+		if ((in[0] & 0xffff) != OpConstant) {
+			throw std::runtime_error("SPIR-V array length is not a constant!");
+		}
+		return in[3];
+	}
+
+	// Bytes occupied by a type inside a block, using the explicit layout
+	// decorations where SPIR-V provides them
+	uint32_t size(uint32_t type, uint32_t matrixStride = 0) {
+		const uint32_t* in = def(type);
+		switch (in[0] & 0xffff) {
+		case OpTypeInt:
+		case OpTypeFloat:
+			return in[2] / 8;
+		case OpTypeVector:
+			return size(in[2]) * in[3];
+		case OpTypeMatrix:
+			return (matrixStride ? matrixStride : size(in[2])) * in[3];
+		case OpTypeArray: {
+			uint32_t stride = id(type).arrayStride;
+			return (stride ? stride : size(in[2])) * constant(in[3]);
+		}
+		case OpTypeStruct: {
+			const Id& info = id(type);
+			uint32_t end = 0;
+			uint32_t memberCount = (in[0] >> 16) - 2;
+			for (uint32_t m = 0; m < memberCount; m++) {
+				Member member = m < info.members.size() ? info.members[m] : Member{ 0, 0 };
+				end = std::max(end, member.offset + size(in[2 + m], member.matrixStride));
+			}
+			return end;
+		}
+		}
+		return 0;
+	}
+
+	vk::DescriptorType imageType(const uint32_t* image, bool sampler) {
+		if (image[3] == DimSubpassData) {
+			return vk::DescriptorType::eInputAttachment;
+		}
+		if (image[3] == DimBuffer) {
+			return image[7] == 2 ? vk::DescriptorType::eStorageTexelBuffer : vk::DescriptorType::eUniformTexelBuffer;
+		}
+		if (sampler) {
+			return vk::DescriptorType::eCombinedImageSampler;
+		}
+		return image[7] == 2 ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+	}
+
+	vk::Format format(uint32_t type) {
+		const uint32_t* in = def(type);
+		uint32_t components = 1;
+		if ((in[0] & 0xffff) == OpTypeVector) {
+			components = in[3];
+			in = def(in[2]);
+		}
+		if (in[2] != 32 || components < 1 || components > 4) {
+			return vk::Format::eUndefined;
+		}
+		if ((in[0] & 0xffff) == OpTypeFloat) {
+			const vk::Format formats[] = { vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat,
+				vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32A32Sfloat };
+			return formats[components - 1];
+		}
+		if ((in[0] & 0xffff) == OpTypeInt && in[3]) {
+			const vk::Format formats[] = { vk::Format::eR32Sint, vk::Format::eR32G32Sint,
+				vk::Format::eR32G32B32Sint, vk::Format::eR32G32B32A32Sint };
+			return formats[components - 1];
+		}
+		if ((in[0] & 0xffff) == OpTypeInt) {
+			const vk::Format formats[] = { vk::Format::eR32Uint, vk::Format::eR32G32Uint,
+				vk::Format::eR32G32B32Uint, vk::Format::eR32G32B32A32Uint };
+			return formats[components - 1];
+		}
+		return vk::Format::eUndefined;
+	}
+};
+
+}
+
+ShaderLayout ShaderReflection::reflect(const uint32_t* code, size_t size)
+{
+	size_t words = size / sizeof(uint32_t);
+	if (words < 5 || code[0] != SpvMagic) {
+		throw std::runtime_error("not a SPIR-V module!");
+	}
+
+	Module module(code, words);
+	ShaderLayout layout;
+	layout.stages = module.stages;
+	layout.pushConstantSize = 0;
+
+	for (uint32_t variable : module.variables) {
+		const uint32_t* in = module.def(variable);
+		uint32_t storage = in[3];
+		const Id& info = module.id(variable);
+		const uint32_t* pointer = module.def(in[1]);
+		uint32_t type = pointer[3];
+
+		if (storage == StoragePushConstant) {
+			// Ranges are in multiples of four bytes
+			layout.pushConstantSize = std::max(layout.pushConstantSize, (module.size(type) + 3) & ~3u);
+			layout.pushConstantStages = module.stages;
+			continue;
+		}
+		if (storage == StorageInput) {
+			if (module.stages & vk::ShaderStageFlagBits::eVertex && !info.builtIn && info.location != NONE) {
+				layout.inputs.push_back({ info.location, module.format(type) });
+			}
+			continue;
+		}
+		if (storage != StorageUniform && storage != StorageUniformConstant && storage != StorageBuffer) {
+			continue;
+		}
+
+		ShaderBinding binding = { info.set == NONE ? 0 : info.set, info.binding == NONE ? 0 : info.binding,
+			vk::DescriptorType::eUniformBuffer, 1, module.stages };
+		while (module.opcode(type) == OpTypeArray || module.opcode(type) == OpTypeRuntimeArray) {
+			const uint32_t* array = module.def(type);
+			binding.count = module.opcode(type) == OpTypeArray ? binding.count * module.constant(array[3]) : 0;
+			type = array[2];
+		}
+
+		const uint32_t* pointee = module.def(type);
+		switch (pointee[0] & 0xffff) {
+		case OpTypeStruct:
+			binding.type = storage == StorageBuffer || module.id(type).bufferBlock ?
+				vk::DescriptorType::eStorageBuffer : vk::DescriptorType::eUniformBuffer;
+			break;
+		case OpTypeSampler:
+			binding.type = vk::DescriptorType::eSampler;
+			break;
+		case OpTypeSampledImage:
+			binding.type = module.imageType(module.def(pointee[2]), true);
+			break;
+		case OpTypeImage:
+			binding.type = module.imageType(pointee, false);
+			break;
+		default:
+			continue;
+		}
+		layout.bindings.push_back(binding);
+	}
+
+	std::sort(layout.bindings.begin(), layout.bindings.end(), [](const ShaderBinding& a, const ShaderBinding& b) {
+		return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+	});
+	std::sort(layout.inputs.begin(), layout.inputs.end(), [](const ShaderInput& a, const ShaderInput& b) {
+		return a.location < b.location;
+	});
+	return layout;
+}
+
+ShaderLayout ShaderReflection::merge(const ShaderLayout& a, const ShaderLayout& b)
+{
+	ShaderLayout layout;
+	layout.stages = a.stages | b.stages;
+	layout.pushConstantSize = std::max(a.pushConstantSize, b.pushConstantSize);
+	layout.pushConstantStages = a.pushConstantStages | b.pushConstantStages;
+
+	layout.inputs = a.inputs;
+	layout.inputs.insert(layout.inputs.end(), b.inputs.begin(), b.inputs.end());
+	std::sort(layout.inputs.begin(), layout.inputs.end(), [](const ShaderInput& a, const ShaderInput& b) {
+		return a.location < b.location;
+	});
+
+	auto before = [](const ShaderBinding& a, const ShaderBinding& b) {
+		return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+	};
+	size_t i = 0;
+	size_t j = 0;
+	while (i < a.bindings.size() || j < b.bindings.size()) {
+		if (j == b.bindings.size() || (i < a.bindings.size() && before(a.bindings[i], b.bindings[j]))) {
+			layout.bindings.push_back(a.bindings[i++]);
+		}
+		else if (i == a.bindings.size() || before(b.bindings[j], a.bindings[i])) {
+			layout.bindings.push_back(b.bindings[j++]);
+		}
+		else {
+			if (a.bindings[i].type != b.bindings[j].type || a.bindings[i].count != b.bindings[j].count) {
+				throw std::runtime_error("shader stages disagree on a descriptor binding!");
+			}
+			ShaderBinding binding = a.bindings[i++];
+			binding.stages |= b.bindings[j++].stages;
+			layout.bindings.push_back(binding);
+		}
+	}
+	return layout;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vulkan\vulkan.hpp>
+#include <vector>
+
+struct ShaderBinding {
+	uint32_t set;
+	uint32_t binding;
+	vk::DescriptorType type;
+	uint32_t count;	// 0 for a runtime-sized array
+	vk::ShaderStageFlags stages;
+};
+
+struct ShaderInput {
+	uint32_t location;
+	vk::Format format;	// as declared in the shader, e.g. vec2 -> eR32G32Sfloat
+};
+
+// The interface a module, or a set of linked stages, expects from its
+// pipeline layout and vertex input state
+struct ShaderLayout {
+	vk::ShaderStageFlags stages;
+	std::vector<ShaderBinding> bindings;	// sorted by set, then binding
+	uint32_t pushConstantSize;	// 0 when there is no push-constant block
+	vk::ShaderStageFlags pushConstantStages;
+	std::vector<ShaderInput> inputs;	// vertex stage only, sorted by location
+};
+
+// Minimal SPIR-V reflection: walks the module's declarations once and
+// reports descriptor bindings, the push-constant block size and vertex
+// inputs. Nothing here needs a device.
+class ShaderReflection
+{
+public:
+	// Throws if code is not a SPIR-V module. size is in bytes.
+	static ShaderLayout reflect(const uint32_t* code, size_t size);
+	// Combines the stages of one pipeline; bindings used by several stages
+	// must agree on type and count.
+	static ShaderLayout merge(const ShaderLayout& a, const ShaderLayout& b);
+};
@@ -0,0 +1,152 @@
+#include "ShaderWatcher.h"
+
+#include <stdexcept>
+
+// Editors often save in several writes; wait for them to settle
+static const DWORD DEBOUNCE_MS = 100;
+
+ShaderWatcher::ShaderWatcher()
+	: stopEvent(nullptr)
+{
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+	stop();
+}
+
+void ShaderWatcher::start(const std::string& directory, const std::vector<Source>& sources,
+	std::function<void(const std::vector<std::string>&)> compiled)
+{
+	stop();
+
+	this->directory = directory.empty() ? std::string(".") : directory;
+	this->compiled = compiled;
+	watched.clear();
+	for (const auto& source : sources) {
+		watched.push_back({ source, lastWriteTime(this->directory + "\\" + source.source) });
+	}
+
+	// Prefer the SDK's copy, otherwise rely on PATH
+	char sdk[MAX_PATH];
+	DWORD length = GetEnvironmentVariableA("VULKAN_SDK", sdk, sizeof(sdk));
+	compiler = length > 0 && length < sizeof(sdk) ?
+		std::string(sdk) + "\\Bin\\glslangValidator.exe" : std::string("glslangValidator.exe");
+
+	stopEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+	if (!stopEvent) {
+		throw std::runtime_error("failed to create shader watcher event!");
+	}
+	thread = std::thread(&ShaderWatcher::run, this);
+}
+
+void ShaderWatcher::stop()
+{
+	if (thread.joinable()) {
+		SetEvent(stopEvent);
+		thread.join();
+	}
+	if (stopEvent) {
+		CloseHandle(stopEvent);
+		stopEvent = nullptr;
+	}
+}
+
+void ShaderWatcher::run()
+{
+	HANDLE change = FindFirstChangeNotificationA(directory.c_str(), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE);
+	if (change == INVALID_HANDLE_VALUE) {
+		OutputDebugStringA("shader watcher: cannot watch shader directory\n");
+		return;
+	}
+
+	HANDLE handles[] = { stopEvent, change };
+	while (WaitForMultipleObjects(2, handles, FALSE, INFINITE) == WAIT_OBJECT_0 + 1) {
+		if (WaitForSingleObject(stopEvent, DEBOUNCE_MS) == WAIT_OBJECT_0) {
+			break;
+		}
+		FindNextChangeNotification(change);
+
+		// Our own .spv writes land here too; only changed sources count
+		std::vector<std::string> outputs;
+		for (auto& entry : watched) {
+			FILETIME lastWrite = lastWriteTime(directory + "\\" + entry.files.source);
+			if (CompareFileTime(&lastWrite, &entry.lastWrite) == 0) {
+				continue;
+			}
+			entry.lastWrite = lastWrite;
+			if (compile(entry.files)) {
+				outputs.push_back(entry.files.output);
+			}
+		}
+		if (!outputs.empty()) {
+			compiled(outputs);
+		}
+	}
+
+	FindCloseChangeNotification(change);
+}
+
+bool ShaderWatcher::compile(const Source& files) const
+{
+	std::string source = directory + "\\" + files.source;
+	std::string output = directory + "\\" + files.output;
+	std::string temporary = output + ".tmp";
+	std::string commandLine = "\"" + compiler + "\" -V \"" + source + "\" -o \"" + temporary + "\"";
+
+	// Capture the compiler's output so errors end up in the debug log
+	SECURITY_ATTRIBUTES inherit = { sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+	HANDLE readPipe, writePipe;
+	if (!CreatePipe(&readPipe, &writePipe, &inherit, 0)) {
+		return false;
+	}
+	SetHandleInformation(readPipe, HANDLE_FLAG_INHERIT, 0);
+
+	STARTUPINFOA startup = {};
+	startup.cb = sizeof(startup);
+	startup.dwFlags = STARTF_USESTDHANDLES;
+	startup.hStdOutput = writePipe;
+	startup.hStdError = writePipe;
+	PROCESS_INFORMATION process = {};
+	BOOL launched = CreateProcessA(nullptr, &commandLine[0], nullptr, nullptr, TRUE,
+		CREATE_NO_WINDOW, nullptr, nullptr, &startup, &process);
+	CloseHandle(writePipe);
+	if (!launched) {
+		CloseHandle(readPipe);
+		OutputDebugStringA("shader watcher: failed to run glslangValidator\n");
+		return false;
+	}
+
+	std::string log;
+	char buffer[512];
+	DWORD read;
+	while (ReadFile(readPipe, buffer, sizeof(buffer), &read, nullptr) && read > 0) {
+		log.append(buffer, read);
+	}
+	CloseHandle(readPipe);
+
+	WaitForSingleObject(process.hProcess, INFINITE);
+	DWORD exitCode = 1;
+	GetExitCodeProcess(process.hProcess, &exitCode);
+	CloseHandle(process.hProcess);
+	CloseHandle(process.hThread);
+
+	if (exitCode != 0 || !MoveFileExA(temporary.c_str(), output.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+		DeleteFileA(temporary.c_str());
+		OutputDebugStringA(("shader watcher: " + files.source + " failed to compile\n").c_str());
+		OutputDebugStringA(log.c_str());
+		return false;
+	}
+	OutputDebugStringA(("shader watcher: recompiled " + files.source + "\n").c_str());
+	return true;
+}
+
+FILETIME ShaderWatcher::lastWriteTime(const std::string& path)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes)) {
+		FILETIME none = {};
+		return none;
+	}
+	return attributes.ftLastWriteTime;
+}
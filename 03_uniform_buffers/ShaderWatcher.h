@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Windows.h>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Development helper that watches GLSL sources and recompiles them with
+// glslangValidator on a background thread. Each output is written to a
+// temporary file and moved over the .spv, so a reader never sees a partial
+// file. The callback runs on the watcher thread after every batch in which
+// at least one shader compiled.
+class ShaderWatcher
+{
+public:
+	struct Source {
+		std::string source;	// e.g. shader.vert
+		std::string output;	// e.g. vert.spv
+	};
+private:
+	struct Watched {
+		Source files;
+		FILETIME lastWrite;
+	};
+
+	std::string directory;
+	std::vector<Watched> watched;
+	std::function<void(const std::vector<std::string>&)> compiled;
+	std::string compiler;
+
+	HANDLE stopEvent;
+	std::thread thread;
+
+	void run();
+	bool compile(const Source& files) const;
+	static FILETIME lastWriteTime(const std::string& path);
+public:
+	ShaderWatcher();
+	~ShaderWatcher();
+
+	// Starts watching directory. compiled receives the outputs that changed.
+	void start(const std::string& directory, const std::vector<Source>& sources,
+		std::function<void(const std::vector<std::string>&)> compiled);
+	void stop();
+
+	inline bool watching() const { return thread.joinable(); }
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// A fixed-size ring for handing items from exactly one producer thread to
+// exactly one consumer thread. Neither side locks, blocks or allocates:
+// push() fails when the ring is full and pop() fails when it is empty.
+// CAPACITY must be a power of two.
+template <typename T, size_t CAPACITY>
+class SpscQueue
+{
+private:
+	static_assert((CAPACITY & (CAPACITY - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+	// head is only written by the consumer and tail only by the producer;
+	// the padding keeps them on separate cache lines
+	std::atomic<size_t> head;
+	char headPadding[64 - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t> tail;
+	char tailPadding[64 - sizeof(std::atomic<size_t>)];
+	T items[CAPACITY];
+public:
+	SpscQueue()
+		: head(0)
+		, tail(0)
+	{
+	}
+
+	// Producer thread only
+	bool push(const T& item)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == CAPACITY) {
+			return false;
+		}
+		items[t & (CAPACITY - 1)] = item;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer thread only
+	bool pop(T& item)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		item = items[h & (CAPACITY - 1)];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Exact on either thread for its own side, a snapshot otherwise
+	inline size_t size() const
+	{
+		return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+	}
+};
\ No newline at end of file
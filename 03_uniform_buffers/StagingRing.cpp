@@ -0,0 +1,177 @@
+#include "StagingRing.h"
+#include "DebugUtils.h"
+#include "MemoryTracker.h"
+
+#include <algorithm>
+
+StagingRing::StagingRing()
+	: mapped(nullptr)
+	, size(0)
+	, head(0)
+	, chunk(0)
+	, recording(false)
+{
+}
+
+StagingRing::~StagingRing()
+{
+}
+
+void StagingRing::create(vk::Device device, vk::PhysicalDevice physicalDevice, vk::CommandPool commandPool, vk::Queue queue,
+	vk::DeviceSize size, vk::DeviceSize chunkSize)
+{
+	this->device = device;
+	this->commandPool = commandPool;
+	this->transferQueue = queue;
+	this->size = size;
+	this->chunk = std::min(chunkSize, size / 2);
+	head = 0;
+
+	vk::BufferCreateInfo bufferInfo = vk::BufferCreateInfo()
+		.setSize(size)
+		.setUsage(vk::BufferUsageFlagBits::eTransferSrc)
+		.setSharingMode(vk::SharingMode::eExclusive);
+	buffer = makeHandle(device, device.createBuffer(bufferInfo));
+
+	vk::MemoryRequirements memRequirements = device.getBufferMemoryRequirements(buffer);
+	vk::MemoryPropertyFlags properties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+	auto memProperties = physicalDevice.getMemoryProperties();
+	uint32_t memoryType = ~0u;
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+		if ((memRequirements.memoryTypeBits & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			memoryType = i;
+			break;
+		}
+	}
+	if (memoryType == ~0u) {
+		throw std::runtime_error("failed to find suitable memory type");
+	}
+
+	vk::MemoryAllocateInfo allocInfo = vk::MemoryAllocateInfo()
+		.setAllocationSize(memRequirements.size)
+		.setMemoryTypeIndex(memoryType);
+	memory = makeHandle(device, MemoryTracker::allocate(device, allocInfo, MemoryCategory::Staging, size));
+	device.bindBufferMemory(buffer, memory, 0);
+	mapped = (char*)device.mapMemory(memory, 0, size);
+	DEBUG_NAME(device, buffer, "staging ring");
+	DEBUG_NAME(device, memory, "staging ring");
+}
+
+void StagingRing::destroy()
+{
+	if (!buffer) {
+		return;
+	}
+	flush();
+	device.unmapMemory(memory);
+	buffer.reset();
+	memory.reset();
+	mapped = nullptr;
+}
+
+void StagingRing::begin()
+{
+	vk::CommandBufferAllocateInfo allocInfo = vk::CommandBufferAllocateInfo()
+		.setLevel(vk::CommandBufferLevel::ePrimary)
+		.setCommandPool(commandPool)
+		.setCommandBufferCount(1);
+	current.commandBuffer = device.allocateCommandBuffers(allocInfo)[0];
+	current.fence = makeHandle(device, device.createFence(vk::FenceCreateInfo()));
+	current.begin = current.end = head;
+	current.commandBuffer.begin(vk::CommandBufferBeginInfo().setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+	DEBUG_NAME(device, current.commandBuffer, "staging batch");
+	// Closed in submit(), around every copy of the batch
+	DEBUG_LABEL_BEGIN(current.commandBuffer, "staging upload");
+	recording = true;
+}
+
+void StagingRing::retire(Batch& batch)
+{
+	device.waitForFences({ batch.fence.get() }, VK_TRUE, std::numeric_limits<uint64_t>::max());
+	batch.fence.reset();
+	device.freeCommandBuffers(commandPool, { batch.commandBuffer });
+}
+
+void StagingRing::waitFor(vk::DeviceSize begin, vk::DeviceSize end)
+{
+	// Batches complete in submission order, so retiring from the front
+	// until nothing overlaps is enough.
+	while (!inFlight.empty()) {
+		bool overlaps = false;
+		for (const auto& batch : inFlight) {
+			if (batch.begin < end && begin < batch.end) {
+				overlaps = true;
+				break;
+			}
+		}
+		if (!overlaps) {
+			break;
+		}
+		retire(inFlight.front());
+		inFlight.pop_front();
+	}
+}
+
+void* StagingRing::allocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset)
+{
+	if (size > chunk) {
+		throw std::runtime_error("staging allocation larger than the ring chunk size");
+	}
+
+	vk::DeviceSize aligned = (head + alignment - 1) / alignment * alignment;
+	if (aligned + size > this->size) {
+		// Batches never straddle the end of the ring
+		submit();
+		aligned = 0;
+	}
+	if (recording && current.begin < aligned + size && aligned < current.end) {
+		submit();
+	}
+	waitFor(aligned, aligned + size);
+
+	if (!recording) {
+		begin();
+		current.begin = aligned;
+	}
+	current.end = aligned + size;
+	head = aligned + size;
+	offset = aligned;
+	return mapped + aligned;
+}
+
+void StagingRing::copy(vk::Buffer dstBuffer, vk::DeviceSize srcOffset, vk::DeviceSize dstOffset, vk::DeviceSize size)
+{
+	current.commandBuffer.copyBuffer(buffer, dstBuffer, { vk::BufferCopy(srcOffset, dstOffset, size) });
+}
+
+void StagingRing::submit()
+{
+	if (!recording) {
+		return;
+	}
+
+	// Make the copies visible to vertex input of anything submitted later
+	vk::MemoryBarrier barrier = vk::MemoryBarrier()
+		.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+		.setDstAccessMask(vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead);
+	current.commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eVertexInput,
+		vk::DependencyFlags(), { barrier }, {}, {});
+	DEBUG_LABEL_END(current.commandBuffer);
+	current.commandBuffer.end();
+
+	vk::SubmitInfo submitInfo = vk::SubmitInfo()
+		.setCommandBufferCount(1)
+		.setPCommandBuffers(&current.commandBuffer);
+	transferQueue.submit({ submitInfo }, current.fence);
+	inFlight.push_back(std::move(current));
+	recording = false;
+}
+
+void StagingRing::flush()
+{
+	submit();
+	while (!inFlight.empty()) {
+		retire(inFlight.front());
+		inFlight.pop_front();
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vulkan\vulkan.hpp>
+#include <deque>
+
+#include "Handle.h"
+
+// A persistently mapped, host-visible ring of staging memory. Copies are
+// recorded into a batch command buffer that is submitted whenever the ring
+// wraps or submit() is called; space is reclaimed by waiting on the fence
+// of the oldest batch still using it.
+class StagingRing
+{
+private:
+	struct Batch {
+		vk::CommandBuffer commandBuffer;
+		DeviceHandle<vk::Fence> fence;
+		vk::DeviceSize begin;
+		vk::DeviceSize end;
+	};
+
+	vk::Device device;
+	vk::CommandPool commandPool;
+	vk::Queue transferQueue;
+
+	DeviceHandle<vk::Buffer> buffer;
+	DeviceHandle<vk::DeviceMemory> memory;
+	char* mapped;
+	vk::DeviceSize size;
+	vk::DeviceSize head;
+	vk::DeviceSize chunk;
+
+	Batch current;
+	bool recording;
+	std::deque<Batch> inFlight;
+
+	void begin();
+	void retire(Batch& batch);
+	void waitFor(vk::DeviceSize begin, vk::DeviceSize end);
+public:
+	StagingRing();
+	~StagingRing();
+
+	void create(vk::Device device, vk::PhysicalDevice physicalDevice, vk::CommandPool commandPool, vk::Queue queue,
+		vk::DeviceSize size, vk::DeviceSize chunkSize);
+	void destroy();
+
+	// Returns a host pointer to size bytes (at most chunkSize()) of staging
+	// memory, and its offset within buffer() in offset.
+	void* allocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset);
+	void copy(vk::Buffer dstBuffer, vk::DeviceSize srcOffset, vk::DeviceSize dstOffset, vk::DeviceSize size);
+	void submit();
+	// Submits pending copies and waits for every batch to complete
+	void flush();
+
+	inline vk::Buffer stagingBuffer() const { return buffer; }
+	inline vk::CommandPool pool() const { return commandPool; }
+	inline vk::Queue queue() const { return transferQueue; }
+	inline vk::DeviceSize chunkSize() const { return chunk; }
+};
@@ -0,0 +1,82 @@
+#include "StartupTimeline.h"
+
+#include <Windows.h>
+#include <algorithm>
+#include <cstdio>
+
+StartupTimeline::StartupTimeline()
+	: origin(Clock::now())
+	, last(origin)
+	, processMs(processAge())
+	, firstFrameMs(-1.0)
+{
+}
+
+StartupTimeline::~StartupTimeline()
+{
+}
+
+double StartupTimeline::processAge()
+{
+	// Both in 100ns units since 1601
+	FILETIME creation, exit, kernel, user, now;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+		return 0.0;
+	}
+	GetSystemTimeAsFileTime(&now);
+	uint64_t created = (uint64_t)creation.dwHighDateTime << 32 | creation.dwLowDateTime;
+	uint64_t current = (uint64_t)now.dwHighDateTime << 32 | now.dwLowDateTime;
+	return current > created ? (current - created) / 1.0e4 : 0.0;
+}
+
+double StartupTimeline::since(Clock::time_point time) const
+{
+	return std::chrono::duration<double, std::milli>(time - origin).count();
+}
+
+void StartupTimeline::mark(const std::string& name)
+{
+	Clock::time_point start = last;
+	last = Clock::now();
+	std::lock_guard<std::mutex> lock(mutex);
+	recorded.push_back({ name, "render", since(start), std::chrono::duration<double, std::milli>(last - start).count() });
+}
+
+void StartupTimeline::record(const std::string& name, Clock::time_point start, const std::string& thread)
+{
+	Clock::time_point end = Clock::now();
+	std::lock_guard<std::mutex> lock(mutex);
+	recorded.push_back({ name, thread, since(start), std::chrono::duration<double, std::milli>(end - start).count() });
+}
+
+void StartupTimeline::firstFrame()
+{
+	if (done()) {
+		return;
+	}
+	mark("first frame");
+	firstFrameMs = since(last);
+
+	// In start order, so steps that overlapped sit next to each other
+	std::vector<Step> timeline = steps();
+	std::stable_sort(timeline.begin(), timeline.end(), [](const Step& a, const Step& b) {
+		return a.startMs < b.startMs;
+	});
+	char line[256];
+	snprintf(line, sizeof(line), "startup: %.2f ms from process start to the window object\n", processMs);
+	OutputDebugStringA(line);
+	for (const auto& step : timeline) {
+		snprintf(line, sizeof(line), "startup: %9.2f ms %9.2f ms  %-6s %s\n",
+			step.startMs, step.durationMs, step.thread.c_str(), step.name.c_str());
+		OutputDebugStringA(line);
+	}
+	snprintf(line, sizeof(line), "startup: first frame after %.2f ms, %.2f ms from process start\n",
+		initMs(), timeToFirstFrameMs());
+	OutputDebugStringA(line);
+}
+
+std::vector<StartupTimeline::Step> StartupTimeline::steps()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return recorded;
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Records how long each startup step takes, on the render thread and on
+// the threads initialization is spread over, until the first frame has
+// been presented. The whole timeline is logged once at that point.
+class StartupTimeline
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Step {
+		std::string name;
+		std::string thread;
+		double startMs;	// since the timeline began
+		double durationMs;
+	};
+private:
+	Clock::time_point origin;
+	Clock::time_point last;	// where the render thread's previous step ended
+	double processMs;	// from process start to origin
+	double firstFrameMs;	// from origin; negative until the first frame
+
+	std::mutex mutex;
+	std::vector<Step> recorded;
+
+	double since(Clock::time_point time) const;
+	static double processAge();
+public:
+	// The timeline begins here
+	StartupTimeline();
+	~StartupTimeline();
+
+	inline Clock::time_point began() const { return origin; }
+
+	// Render thread: a step from where its previous one ended until now
+	void mark(const std::string& name);
+	// Any thread: a step from start until now
+	void record(const std::string& name, Clock::time_point start, const std::string& thread);
+	// After each present; only the first counts and logs the timeline
+	void firstFrame();
+
+	inline bool done() const { return firstFrameMs >= 0.0; }
+	// Counted from process start, so loading and the C runtime are in it
+	inline double timeToFirstFrameMs() const { return done() ? processMs + firstFrameMs : 0.0; }
+	// Counted from when the timeline began
+	inline double initMs() const { return done() ? firstFrameMs : 0.0; }
+	std::vector<Step> steps();
+};
\ No newline at end of file
@@ -1,20 +1,33 @@
 #include "UniformBufferWindow.h"
 
 #include "Application.h"
+#include "MeshOptimizer.h"
+#include "MeshFile.h"
+#include "DispatchBenchmark.h"
+#include "RenderGraphCheck.h"
 #include <vulkan\vulkan_win32.h>
 #include <vector>
+#include <algorithm>
 #include <set> 
-#include <fstream>
 #include <string>
 
 #include <cstring>
+#include <cstdio>
+#include <cmath>
 
 DECLARE_APP(UniformBufferWindow)
 
 const int WIDTH = 800;
 const int HEIGHT = 600;
+// Posted by the render thread for the UI thread to resize the window to
+// wParam x lParam, since SetWindowPos waits for the UI thread
+const UINT WM_RESIZE_WINDOW = WM_APP;
 
 const int UniformBufferWindow::MAX_FRAMES_IN_FLIGHT = 2;
+// Late enough for pipelines and caches to have settled
+const uint64_t UniformBufferWindow::CAPTURE_FRAME = 60;
+const uint32_t UniformBufferWindow::MAX_OBJECTS = 4096;
+const uint32_t UniformBufferWindow::OVERDRAW_LAYERS = 16;
 const std::vector<Vertex> UniformBufferWindow::vertices = {
 	{ { -0.5f, -0.5f },{ 1.0f, 0.0f, 0.0f } },
 	{ { 0.5f, -0.5f },{ 0.0f, 1.0f, 0.0f } },
@@ -43,129 +56,370 @@ const bool enableValidationLayers = false;
 const bool enableValidationLayers = true;
 #endif
 
-static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
-	VkDebugReportFlagsEXT flags,
-	VkDebugReportObjectTypeEXT objType,
-	uint64_t obj,
-	size_t location,
-	int32_t code,
-	const char* layerPrefix,
-	const char* msg,
-	void* userData)
+// Where option appears as a whole word, so -capture is not found in
+// -capture-frame; the end of it, or npos
+static size_t findOption(const std::string& commandLine, const char* option)
 {
-	OutputDebugStringA("validation layer: ");
-	OutputDebugStringA(msg);
-	OutputDebugStringA("\n");
+	size_t length = strlen(option);
+	for (size_t position = commandLine.find(option); position != std::string::npos;
+		position = commandLine.find(option, position + 1)) {
+		size_t end = position + length;
+		if ((position == 0 || commandLine[position - 1] == ' ') &&
+			(end == commandLine.size() || commandLine[end] == ' ')) {
+			return end;
+		}
+	}
+	return std::string::npos;
+}
 
-	return VK_FALSE;
+static bool commandLineFlag(const char* option)
+{
+	return findOption(GetCommandLineA(), option) != std::string::npos;
 }
 
-VkResult CreateDebugReportCallbackEXT(
-	VkInstance instance,
-	const VkDebugReportCallbackCreateInfoEXT* pCreateInfo,
-	const VkAllocationCallbacks* pAllocator,
-	VkDebugReportCallbackEXT* pCallback)
+static std::string commandLineValue(const char* option)
 {
-	auto func = (PFN_vkCreateDebugReportCallbackEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugReportCallbackEXT");
-	if (func != nullptr) {
-		return func(instance, pCreateInfo, pAllocator, pCallback);
+	std::string commandLine = GetCommandLineA();
+	size_t position = findOption(commandLine, option);
+	if (position == std::string::npos) {
+		return std::string();
 	}
-	else {
-		return VK_ERROR_EXTENSION_NOT_PRESENT;
+	position = commandLine.find_first_not_of(' ', position);
+	if (position == std::string::npos) {
+		return std::string();
+	}
+	if (commandLine[position] == '"') {
+		size_t end = commandLine.find('"', position + 1);
+		return commandLine.substr(position + 1, end == std::string::npos ? std::string::npos : end - position - 1);
 	}
+	return commandLine.substr(position, commandLine.find(' ', position) - position);
 }
 
-void DestroyDebugReportCallbackEXT(
-	VkInstance instance,
-	VkDebugReportCallbackEXT callback,
-	const VkAllocationCallbacks* pAllocator)
+static SurfacePreference parseSurfacePreference(const std::string& name)
 {
-	auto func = (PFN_vkDestroyDebugReportCallbackEXT)vkGetInstanceProcAddr(instance, "vkDestroyDebugReportCallbackEXT");
-	if (func != nullptr) {
-		func(instance, callback, pAllocator);
+	if (name == "srgb") {
+		return SurfacePreference::Srgb;
+	}
+	if (name == "hdr10") {
+		return SurfacePreference::Hdr10;
+	}
+	if (name == "scrgb") {
+		return SurfacePreference::ScRgb;
+	}
+	return SurfacePreference::Unorm;
+}
+
+static std::vector<vk::PresentModeKHR> parsePresentModes(const std::string& name)
+{
+	if (name == "fifo") {
+		return { vk::PresentModeKHR::eFifo };
+	}
+	if (name == "fifo-relaxed") {
+		return { vk::PresentModeKHR::eFifoRelaxed };
+	}
+	if (name == "mailbox") {
+		return { vk::PresentModeKHR::eMailbox };
+	}
+	if (name == "immediate") {
+		return { vk::PresentModeKHR::eImmediate };
+	}
+	return {};
+}
+
+static std::string presentModeName(vk::PresentModeKHR mode)
+{
+	switch (mode) {
+	case vk::PresentModeKHR::eImmediate:
+		return "immediate";
+	case vk::PresentModeKHR::eMailbox:
+		return "mailbox";
+	case vk::PresentModeKHR::eFifoRelaxed:
+		return "fifo-relaxed";
+	default:
+		return "fifo";
 	}
 }
 
 UniformBufferWindow::UniformBufferWindow()
-	: currentFrame(0)
+	: msaaSamples(vk::SampleCountFlagBits::e1)
+	, colorSpaceExtension(false)
+	, instanceVersion(VK_API_VERSION_1_0)
+	, properties2Extension(false)
+	, memoryBudgetExtension(false)
+	, leakCheck(commandLineFlag("-leak-check"))
+	, currentFrame(0)
+	, frameNumber(0)
+	, swapChainCapturable(false)
+	, streamTotals()
+	, readbackFrame(false)
+	, goldenTolerance(ImageCompare::DEFAULT_TOLERANCE)
+	, vertexFormat(commandLineFlag("-packed-vertices") ? VertexFormat::Packed : VertexFormat::Float)
+	, benchmarkMesh(GeometryPool::NO_MESH)
+	, depthPrepass(commandLineFlag("-depth-prepass"))
+	, pipelineReady(false)
+	, demoMesh(GeometryPool::NO_MESH)
+	, bindless(commandLineFlag("-bindless"))
+	, drawPath(DrawPath::PushConstants)
+	, objectCount(0)
+	, objectLayers(1)
+	, objectData(nullptr)
+	, objectStride(0)
+	, objectBufferIndex(0)
 {
 	observe(WM_CREATE, [this](WPARAM wParam, LPARAM lParam) {
 		Size(WIDTH, HEIGHT);
-		initVulkan();
+		startup.record("create window", startup.began(), "ui");
+		windowCreated.set_value();
+	});
+
+	observe(WM_RESIZE_WINDOW, [this](WPARAM wParam, LPARAM lParam) {
+		Size((LONG)wParam, (LONG)lParam);
 	});
 
 	observe(WM_SIZE, [this](WPARAM wParam, LPARAM lParam) {
-		recreateSwapChain();
+		if (renderThread.joinable()) {
+			postRenderEvent({ WM_SIZE, wParam, lParam });
+		}
 	});
 
 	observe(WM_DESTROY, [this](WPARAM wParam, LPARAM lParam) {
-		cleanupSwapChain();
+		if (renderThread.joinable()) {
+			postRenderEvent({ WM_DESTROY, wParam, lParam });
+			renderThread.join();
+		}
+	});
 
-		device.destroyDescriptorSetLayout(&descriptorSetLayout);
-		device.destroyBuffer(vertexBuffer);
-		device.freeMemory(vertexBufferMemory);
-		device.destroyBuffer(indexBuffer);
-		device.freeMemory(indexBufferMemory);
+	// Only the render thread touches Vulkan; this thread pumps messages and
+	// forwards the ones it cares about. The instance and the device list
+	// need no window, so they are built while the window is created.
+	windowReady = windowCreated.get_future().share();
+	renderThread = std::thread([this]() {
+		renderLoop();
+	});
+}
 
-		for (auto buffer : uniformBuffers) {
-			device.destroyBuffer(buffer);
-		}
-		for (auto memory : uniformBuffersMemory) {
-			device.freeMemory(memory);
+void UniformBufferWindow::postRenderEvent(const RenderEvent& event)
+{
+	// The render thread drains the queue every frame, so a full queue only
+	// lasts as long as one frame
+	while (!renderEvents.push(event)) {
+		std::this_thread::yield();
+	}
+}
+
+void UniformBufferWindow::renderLoop()
+{
+	try {
+		runRenderer();
+	}
+	catch (const std::exception& e) {
+		OutputDebugStringA("render thread failed: ");
+		OutputDebugStringA(e.what());
+		OutputDebugStringA("\n");
+		shaderWatcher.stop();
+		// The message loop ends with a non-zero exit code; with no window
+		// coming, the destructor is already waiting to join this thread
+		if (waitForWindow()) {
+			PostMessage(Handle(), WM_CLOSE, 1, 0);
 		}
+	}
+}
 
-		for (auto semaphore : imageAvailableSemaphores) {
-			device.destroySemaphore(semaphore);
+bool UniformBufferWindow::waitForWindow()
+{
+	try {
+		windowReady.get();
+		return true;
+	}
+	catch (const std::future_error&) {
+		return false;
+	}
+}
+
+void UniformBufferWindow::runRenderer()
+{
+	// -check-render-graph: exits with 1 if compile() got the made-up frame wrong
+	if (commandLineFlag("-check-render-graph")) {
+		bool passed = RenderGraphCheck::run();
+		if (waitForWindow()) {
+			PostMessage(Handle(), WM_CLOSE, passed ? 0 : 1, 0);
 		}
-		for (auto semaphore : renderFinishedSemaphores) {
-			device.destroySemaphore(semaphore);
+		return;
+	}
+	// -pacing low-latency|power-saving|uncapped, -target-fps N for power-saving
+	pacer.setMode(FramePacer::parse(commandLineValue("-pacing")), atof(commandLineValue("-target-fps").c_str()));
+	swapChainConfig.imageCount = (uint32_t)atoi(commandLineValue("-swapchain-images").c_str());
+	swapChainConfig.presentModes = parsePresentModes(commandLineValue("-present-mode"));
+	swapChainConfig.surface = parseSurfacePreference(commandLineValue("-surface-format"));
+	initVulkan();
+	std::string capturePath = commandLineValue("-capture");
+	if (!capturePath.empty()) {
+		std::string captureFrame = commandLineValue("-capture-frame");
+		frameCapture.request(captureFrame.empty() ? CAPTURE_FRAME : _atoi64(captureFrame.c_str()), capturePath);
+		// -tolerance C: per channel, -tolerance-pixels F: fraction allowed to differ
+		goldenPath = commandLineValue("-golden");
+		std::string tolerance = commandLineValue("-tolerance");
+		std::string tolerancePixels = commandLineValue("-tolerance-pixels");
+		if (!tolerance.empty()) {
+			goldenTolerance.channel = (uint32_t)atoi(tolerance.c_str());
 		}
-		for (auto fence : inFlightFences) {
-			device.destroyFence(fence);
+		if (!tolerancePixels.empty()) {
+			goldenTolerance.pixels = atof(tolerancePixels.c_str());
 		}
+	}
+	if (Benchmark::requested()) {
+		createBenchmarks();
+	}
+	if (commandLineFlag("-hot-reload")) {
+		// Sources sit next to the .spv files in the working directory
+		shaderWatcher.start(".", { { "shader.vert", "vert.spv" }, { "shader.frag", "frag.spv" } },
+			[this](const std::vector<std::string>& outputs) {
+			reloadShaders(outputs);
+		});
+	}
 
-		device.destroyCommandPool(commandPool);
-		device.destroy();
-		instance.destroySurfaceKHR(surface);
-		if (enableValidationLayers) {
-			DestroyDebugReportCallbackEXT((VkInstance)instance, callback, nullptr);
+	while (true) {
+		// A drag sends a burst of WM_SIZE; the swap chain is rebuilt once
+		bool resized = false;
+		RenderEvent event;
+		while (renderEvents.pop(event)) {
+			if (event.message == WM_DESTROY) {
+				cleanupVulkan();
+				return;
+			}
+			if (event.message == WM_SIZE) {
+				resized = true;
+			}
 		}
-		instance.destroy();
-	});
+		if (resized) {
+			recreateSwapChain();
+		}
+		drawFrame();
+	}
+}
+
+void UniformBufferWindow::cleanupVulkan()
+{
+	shaderWatcher.stop();
+	frameCapture.destroy();
+	frameStream.destroy();
+	device.waitIdle();
+	retired.releaseAll();
+	cleanupSwapChain();
+	swapChain.reset();
+	pendingPipeline.reset();
+	pendingPrepassPipeline.reset();
+	pipelineCache.reset();
+	statisticsPool.reset();
+
+	destroyObjectResources();
+	for (auto& allocator : frameDescriptors) {
+		allocator.destroy();
+	}
+	descriptorCache.destroy();
+	bindlessTable.destroy();
+	layouts.destroy();
+	geometry.destroy();
+	stagingRing.destroy();
+	shaders.destroy();
+
+	uniformBuffers.clear();
+	uniformBuffersMemory.clear();
+	imageAvailableSemaphores.clear();
+	renderFinishedSemaphores.clear();
+	inFlightFences.clear();
+	imagesInFlight.clear();
+	commandPool.reset();
+
+	MemoryTracker::destroy();
+	device.destroy();
+	LiveHandles::destroyed(LiveHandles::DEVICE);
+	instance.destroySurfaceKHR(surface);
+	LiveHandles::destroyed(LiveHandles::SURFACE);
+	debugMessenger.destroy();
+	instance.destroy();
+	LiveHandles::destroyed(LiveHandles::INSTANCE);
+
+	// The instance is gone too, so anything still counted was never destroyed
+	if (leakCheck || LiveHandles::total() != 0) {
+		OutputDebugStringA(("leak check: live handles at shutdown: " + LiveHandles::describe() + "\n").c_str());
+	}
 }
 
 void UniformBufferWindow::recreateSwapChain()
 {
 	if (device) {
+		std::lock_guard<std::mutex> lock(pipelineMutex);
+		// Nearly everything below is destroyed and recreated, so nothing
+		// may be in flight
 		device.waitIdle();
+		retired.releaseAll();
+
+		// A reloaded pipeline still waiting to be swapped in targets the old render pass
+		pendingPipeline.reset();
+		pendingPrepassPipeline.reset();
+		pipelineReady = false;
 
+		// Everything but the swap chain itself, which createSwapChain hands
+		// over as oldSwapchain
+		cleanupSwapChain();
 		createSwapChain();
 		createImageViews();
+		createRenderGraph();
 		createRenderPass();
 		createGraphicsPipeline();
+		if (objectBuffer) {
+			createObjectPipelines();
+		}
 		createFramebuffers();
+		// The new swap chain may have more images than the last
+		createUniformBuffer();
+		createDescriptorSets();
 		createCommandBuffers();
+
+		if (leakCheck) {
+			OutputDebugStringA(("leak check: live handles after swap chain rebuild: " + LiveHandles::describe() + "\n").c_str());
+		}
 	}
 }
 
-void UniformBufferWindow::cleanupSwapChain()
+void UniformBufferWindow::configureSwapChain(const SwapChainConfig& config)
 {
-	for (auto buffer : swapChainFramebuffers) {
-		device.destroyFramebuffer(buffer);
-	}
-	device.freeCommandBuffers(commandPool, commandBuffers);
-	device.destroyPipeline(graphicsPipeline);
-	device.destroyPipelineLayout(pipelineLayout);
-	device.destroyRenderPass(renderPass);
+	swapChainConfig = config;
+	recreateSwapChain();
+}
 
-	for (auto swapChainImageView : swapChainImageViews) {
-		device.destroyImageView(swapChainImageView);
+void UniformBufferWindow::cleanupSwapChain()
+{
+	// Users before what they use
+	swapChainFramebuffers.clear();
+	if (!commandBuffers.empty()) {
+		device.freeCommandBuffers(commandPool, commandBuffers);
+		commandBuffers.clear();
 	}
-	device.destroySwapchainKHR(swapChain);
+	graphicsPipeline.reset();
+	depthPrepassPipeline.reset();
+	uniformObjectPipeline.reset();
+	dynamicObjectPipeline.reset();
+	bindlessObjectPipeline.reset();
+	renderPass.reset();
+	frameGraph.destroy();
+
+	swapChainImageViews.clear();
 }
 
 UniformBufferWindow::~UniformBufferWindow()
 {
+	// WM_DESTROY stops the render thread; it has to arrive while the
+	// members it uses are still alive, not from ~Window
+	Destroy();
+	// The window was never created, so the render thread is still waiting
+	// for it or has given up. Breaking the promise lets it give up.
+	if (renderThread.joinable()) {
+		windowCreated = std::promise<void>();
+		postRenderEvent({ WM_DESTROY, 0, 0 });
+		renderThread.join();
+	}
 }
 
 void UniformBufferWindow::initVulkan()
@@ -173,22 +427,72 @@ void UniformBufferWindow::initVulkan()
 	OutputDebugString(TEXT("InitVulkan\n"));
 
 	createInstance();
+	startup.mark("create instance");
 	setupDebugCallback();
+	startup.mark("debug messenger");
+	std::vector<vk::PhysicalDevice> candidates = enumerateDevices();
+	startup.mark("enumerate devices");
+	if (!waitForWindow()) {
+		throw std::runtime_error("window was never created!");
+	}
+	startup.mark("wait for window");
 	createSurface();
-	pickPhysicalDevice();
+	startup.mark("create surface");
+	pickPhysicalDevice(candidates);
+	startup.mark("pick device");
 	createLogicalDevice();
+	startup.mark("create device");
+	trackMemory();
+	shaders.create(device);
+	layouts.create(device);
+	descriptorCache.create(device);
+	if (bindless) {
+		bindlessTable.create(device);
+	}
+	frameDescriptors.resize(MAX_FRAMES_IN_FLIGHT);
+	for (auto& allocator : frameDescriptors) {
+		allocator.create(device);
+	}
+	pipelineCache = makeHandle(device, device.createPipelineCache(vk::PipelineCacheCreateInfo()));
+	createQueryPool();
+	startup.mark("caches and pools");
 	createSwapChain();
 	createImageViews();
+	startup.mark("create swap chain");
+	createRenderGraph();
 	createRenderPass();
-	createDescriptorSetLayout();
-	createGraphicsPipeline();
+	startup.mark("attachments and render pass");
+
+	// Shader loading and pipeline compilation only need the render pass,
+	// so they run on a worker while the buffers are created and uploaded.
+	// Both caches they go through are locked, and nothing below touches
+	// the pipeline layout or the pipelines until the worker is done.
+	std::future<void> pipelines = std::async(std::launch::async, [this]() {
+		StartupTimeline::Clock::time_point start = StartupTimeline::Clock::now();
+		createPipelineLayout();
+		startup.record("load shaders, pipeline layout", start, "worker");
+		start = StartupTimeline::Clock::now();
+		createGraphicsPipeline();
+		startup.record("compile pipelines", start, "worker");
+	});
 	createFramebuffers();
 	createCommandPool();
-	createVertexBuffers();
-	createIndexBuffers();
+	frameCapture.create(device, physicalDevice, [this](const std::string& path, const RgbImage& image) {
+		compareCapture(path, image);
+	});
+	startup.mark("framebuffers and command pool");
+	createGeometry();
+	startup.mark("upload geometry");
 	createUniformBuffer();
+	startup.mark("create uniform buffers");
+	// Rethrows whatever the worker threw
+	pipelines.get();
+	startup.mark("wait for pipelines");
+
+	createDescriptorSets();
 	createCommandBuffers();
 	createSyncObjects();
+	startup.mark("descriptor sets and command buffers");
 }
 
 std::vector<const char*> UniformBufferWindow::getRequiredExtensions() {
@@ -198,7 +502,7 @@ std::vector<const char*> UniformBufferWindow::getRequiredExtensions() {
 	};
 
 	if (enableValidationLayers) {
-		extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
+		extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 	}
 	return extensions;
 }
@@ -238,7 +542,9 @@ void UniformBufferWindow::createInstance() {
 		.setApplicationVersion(VK_MAKE_VERSION(1, 0, 0))
 		.setPEngineName("No Engine")
 		.setEngineVersion(VK_MAKE_VERSION(1, 0, 0))
-		.setApiVersion(VK_API_VERSION_1_0);
+		// Descriptor indexing is queried through vkGetPhysicalDeviceFeatures2
+		.setApiVersion(bindless ? VK_API_VERSION_1_1 : VK_API_VERSION_1_0);
+	instanceVersion = appInfo.apiVersion;
 
 	std::vector<const char*> extensions = getRequiredExtensions();
 
@@ -247,6 +553,16 @@ void UniformBufferWindow::createInstance() {
 	{
 		OutputDebugStringA(prop.extensionName);
 		OutputDebugStringA("\n");
+		// Only adds color spaces to what surfaces may report, so it is
+		// always enabled when there
+		if (strcmp(prop.extensionName, VK_EXT_SWAPCHAIN_COLOR_SPACE_EXTENSION_NAME) == 0) {
+			extensions.push_back(VK_EXT_SWAPCHAIN_COLOR_SPACE_EXTENSION_NAME);
+			colorSpaceExtension = true;
+		}
+		if (strcmp(prop.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0) {
+			extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+			properties2Extension = true;
+		}
 	}
 	vk::InstanceCreateInfo createInfo = vk::InstanceCreateInfo()
 		.setPApplicationInfo(&appInfo)
@@ -256,52 +572,83 @@ void UniformBufferWindow::createInstance() {
 		.setPpEnabledLayerNames(enableValidationLayers ? validationLayers.data() : nullptr);
 
 	instance = vk::createInstance(createInfo);
+	LiveHandles::created(LiveHandles::INSTANCE);
 }
 
 void UniformBufferWindow::setupDebugCallback()
 {
 	if (!enableValidationLayers) return;
 
-	VkDebugReportCallbackCreateInfoEXT createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_REPORT_CALLBACK_CREATE_INFO_EXT;
-	createInfo.flags = VK_DEBUG_REPORT_ERROR_BIT_EXT |
-		VK_DEBUG_REPORT_WARNING_BIT_EXT |
-		VK_DEBUG_REPORT_INFORMATION_BIT_EXT |
-		VK_DEBUG_REPORT_DEBUG_BIT_EXT;
-	createInfo.pfnCallback = debugCallback;
-
-
-	if (CreateDebugReportCallbackEXT((VkInstance)instance, &createInfo, nullptr, &callback) != VK_SUCCESS) {
-		throw std::runtime_error("failed to set up debug callback!");
+	// -debug-severity verbose|info|warning|error, -debug-types general,validation,performance,
+	// -debug-rate messages per second
+	DebugFilter filter = DebugFilter::DEFAULT;
+	std::string severity = commandLineValue("-debug-severity");
+	if (!severity.empty()) {
+		filter.severities = DebugMessenger::parseSeverity(severity);
 	}
+	filter.types = DebugMessenger::parseTypes(commandLineValue("-debug-types"));
+	std::string rate = commandLineValue("-debug-rate");
+	if (!rate.empty()) {
+		filter.maxPerSecond = (uint32_t)atoi(rate.c_str());
+	}
+	debugMessenger.create(instance, filter);
+	DebugUtils::load(instance);
 }
 
-void UniformBufferWindow::pickPhysicalDevice()
+std::vector<vk::PhysicalDevice> UniformBufferWindow::enumerateDevices() const
 {
-	physicalDevice = optimalDevice();
+	std::vector<vk::PhysicalDevice> candidates;
+	for (const auto& device : instance.enumeratePhysicalDevices()) {
+		OutputDebugStringA("Device: ");
+		OutputDebugStringA(device.getProperties().deviceName);
+		OutputDebugStringA("\n");
+		if (checkDeviceExtensionSupport(device)) {
+			candidates.push_back(device);
+		}
+	}
+	return candidates;
 }
 
-bool UniformBufferWindow::isDeviceSuitable(const vk::PhysicalDevice& device) const
+void UniformBufferWindow::pickPhysicalDevice(const std::vector<vk::PhysicalDevice>& candidates)
 {
-	auto deviceProperties = device.getProperties();
-	auto deviceFeatures = device.getFeatures();
-
-	OutputDebugStringA("Device: ");
-	OutputDebugStringA(deviceProperties.deviceName);
+	physicalDevice = optimalDevice(candidates);
+	msaaSamples = chooseSampleCount();
+}
 
-	bool extensionsSupported = checkDeviceExtensionSupport(device);
-	bool swapChainAdequate = false;
-	if (extensionsSupported) {
-		SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
-		swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
+vk::SampleCountFlagBits UniformBufferWindow::chooseSampleCount() const
+{
+	std::string value = commandLineValue("-msaa");
+	uint32_t requested = value.empty() ? 1 : (uint32_t)atoi(value.c_str());
+
+	// Both attachments are multisampled, so both limits apply
+	vk::PhysicalDeviceLimits limits = physicalDevice.getProperties().limits;
+	vk::SampleCountFlags supported = limits.framebufferColorSampleCounts & limits.framebufferDepthSampleCounts;
+	const vk::SampleCountFlagBits counts[] = {
+		vk::SampleCountFlagBits::e8, vk::SampleCountFlagBits::e4, vk::SampleCountFlagBits::e2
+	};
+	for (vk::SampleCountFlagBits count : counts) {
+		if ((uint32_t)count <= requested && (supported & count)) {
+			if ((uint32_t)count != requested) {
+				OutputDebugStringA(("-msaa clamped to " + std::to_string((uint32_t)count) + "\n").c_str());
+			}
+			return count;
+		}
 	}
+	return vk::SampleCountFlagBits::e1;
+}
+
+bool UniformBufferWindow::isDeviceSuitable(const vk::PhysicalDevice& device) const
+{
+	// Extensions were checked by enumerateDevices; what is left needs the surface
+	SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
+	bool swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
 
-	return findQueueFamilies(device).isComplete() && extensionsSupported && swapChainAdequate;
+	return findQueueFamilies(device).isComplete() && swapChainAdequate;
 }
 
-vk::PhysicalDevice UniformBufferWindow::optimalDevice() const
+vk::PhysicalDevice UniformBufferWindow::optimalDevice(const std::vector<vk::PhysicalDevice>& candidates) const
 {
-	for (const auto& device : instance.enumeratePhysicalDevices()) {
+	for (const auto& device : candidates) {
 		if (isDeviceSuitable(device)) {
 			return device;
 		}
@@ -352,29 +699,66 @@ void UniformBufferWindow::createLogicalDevice()
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
-	vk::PhysicalDeviceFeatures deviceFeatures = vk::PhysicalDeviceFeatures();
+	// Only used to count fragment shader invocations in the benchmark
+	vk::PhysicalDeviceFeatures deviceFeatures = vk::PhysicalDeviceFeatures()
+		.setPipelineStatisticsQuery(physicalDevice.getFeatures().pipelineStatisticsQuery);
+
+	std::vector<const char*> extensions = deviceExtensions;
+	vk::PhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = BindlessTable::requiredFeatures();
+	if (bindless && !BindlessTable::supported(physicalDevice)) {
+		OutputDebugStringA("descriptor indexing not supported, -bindless ignored\n");
+		bindless = false;
+	}
+	if (bindless) {
+		extensions.insert(extensions.end(), BindlessTable::EXTENSIONS.begin(), BindlessTable::EXTENSIONS.end());
+	}
+	memoryBudgetExtension = false;
+	if (bindless || properties2Extension) {
+		for (const auto& prop : physicalDevice.enumerateDeviceExtensionProperties()) {
+			if (strcmp(prop.extensionName, MemoryTracker::EXTENSION_NAME) == 0) {
+				extensions.push_back(MemoryTracker::EXTENSION_NAME);
+				memoryBudgetExtension = true;
+			}
+		}
+	}
 
 	vk::DeviceCreateInfo createInfo = vk::DeviceCreateInfo()
+		.setPNext(bindless ? &indexingFeatures : nullptr)
 		.setPQueueCreateInfos(queueCreateInfos.data())
 		.setQueueCreateInfoCount(queueCreateInfos.size())
 		.setPEnabledFeatures(&deviceFeatures)
-		.setPpEnabledExtensionNames(deviceExtensions.data())
-		.setEnabledExtensionCount(deviceExtensions.size())
+		.setPpEnabledExtensionNames(extensions.data())
+		.setEnabledExtensionCount(extensions.size())
 		.setEnabledLayerCount(enableValidationLayers ? validationLayers.size() : 0)
 		.setPpEnabledLayerNames(enableValidationLayers ? validationLayers.data() : nullptr);
 
 	device = physicalDevice.createDevice(createInfo);
+	LiveHandles::created(LiveHandles::DEVICE);
 
 	graphicsQueue = device.getQueue(indices.graphicsFamily, 0);
 	presentQueue = device.getQueue(indices.presentFamily, 0);
 }
 
+void UniformBufferWindow::trackMemory()
+{
+	MemoryTracker::create(instance, instanceVersion, physicalDevice, memoryBudgetExtension);
+	MemoryTracker::setSoftBudget((vk::DeviceSize)(atof(commandLineValue("-memory-budget").c_str()) * 1024 * 1024));
+	MemoryTracker::setLogInterval(std::chrono::seconds(atoi(commandLineValue("-memory-log").c_str())));
+
+	// A capture keeps a swap chain image's worth of host memory per slot
+	// long after it is written; the next capture allocates it again
+	MemoryTracker::addEvictor("idle capture buffers", [this](vk::DeviceSize) {
+		return frameCapture.trim();
+	});
+}
+
 void UniformBufferWindow::createSurface()
 {
 	vk::Win32SurfaceCreateInfoKHR createInfo = vk::Win32SurfaceCreateInfoKHR()
 		.setHwnd(Handle())
 		.setHinstance(GetModuleHandle(nullptr));
 	surface = instance.createWin32SurfaceKHR(createInfo);
+	LiveHandles::created(LiveHandles::SURFACE);
 }
 
 
@@ -389,13 +773,50 @@ SwapChainSupportDetails UniformBufferWindow::querySwapChainSupport(const vk::Phy
 
 vk::SurfaceFormatKHR UniformBufferWindow::chooseSwapSurfaceFormat(const std::vector<vk::SurfaceFormatKHR>& availableFormats) const
 {
+	std::vector<vk::SurfaceFormatKHR> preferred;
+	switch (swapChainConfig.surface) {
+	case SurfacePreference::Srgb:
+		preferred = {
+			{ vk::Format::eB8G8R8A8Srgb, vk::ColorSpaceKHR::eSrgbNonlinear },
+			{ vk::Format::eR8G8B8A8Srgb, vk::ColorSpaceKHR::eSrgbNonlinear }
+		};
+		break;
+	case SurfacePreference::Hdr10:
+		if (colorSpaceExtension) {
+			preferred = {
+				{ vk::Format::eA2B10G10R10UnormPack32, vk::ColorSpaceKHR::eHdr10St2084EXT },
+				{ vk::Format::eA2R10G10B10UnormPack32, vk::ColorSpaceKHR::eHdr10St2084EXT }
+			};
+		}
+		break;
+	case SurfacePreference::ScRgb:
+		if (colorSpaceExtension) {
+			preferred = { { vk::Format::eR16G16B16A16Sfloat, vk::ColorSpaceKHR::eExtendedSrgbLinearEXT } };
+		}
+		break;
+	default:
+		break;
+	}
+	// What every preference falls back to
+	preferred.push_back({ vk::Format::eB8G8R8A8Unorm, vk::ColorSpaceKHR::eSrgbNonlinear });
+
 	if (availableFormats.size() == 1 && availableFormats[0].format == vk::Format::eUndefined) {
-		return { vk::Format::eB8G8R8A8Unorm, vk::ColorSpaceKHR::eSrgbNonlinear };
+		// Any format will do, though only in the sRGB color space
+		for (const auto& format : preferred) {
+			if (format.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear) {
+				return format;
+			}
+		}
 	}
 
-	for (const auto& availableFormat : availableFormats) {
-		if (availableFormat.format == vk::Format::eB8G8R8A8Unorm && availableFormat.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear) {
-			return availableFormat;
+	for (size_t i = 0; i < preferred.size(); i++) {
+		for (const auto& availableFormat : availableFormats) {
+			if (availableFormat.format == preferred[i].format && availableFormat.colorSpace == preferred[i].colorSpace) {
+				if (i + 1 == preferred.size() && swapChainConfig.surface != SurfacePreference::Unorm) {
+					OutputDebugStringA("-surface-format not supported, falling back to unorm\n");
+				}
+				return availableFormat;
+			}
 		}
 	}
 
@@ -404,16 +825,12 @@ vk::SurfaceFormatKHR UniformBufferWindow::chooseSwapSurfaceFormat(const std::vec
 
 vk::PresentModeKHR UniformBufferWindow::chooseSwapPresentMode(const std::vector<vk::PresentModeKHR>& availablePresentModes) const
 {
-	vk::PresentModeKHR bestMode = vk::PresentModeKHR::eFifo;
-	for (const auto& availableMode : availablePresentModes) {
-		if (availableMode == vk::PresentModeKHR::eMailbox) {
-			return availableMode;
-		}
-		else if (availableMode == vk::PresentModeKHR::eImmediate) {
-			bestMode = availableMode;
+	for (vk::PresentModeKHR mode : swapChainConfig.presentModes) {
+		if (std::find(availablePresentModes.begin(), availablePresentModes.end(), mode) != availablePresentModes.end()) {
+			return mode;
 		}
 	}
-	return bestMode;
+	return pacer.presentMode(availablePresentModes);
 }
 
 vk::Extent2D UniformBufferWindow::chooseSwapExtent(const vk::SurfaceCapabilitiesKHR& capabilities) const
@@ -439,7 +856,9 @@ void UniformBufferWindow::createSwapChain()
 	vk::PresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
 	vk::Extent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-	uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+	uint32_t imageCount = swapChainConfig.imageCount > 0 ?
+		std::max(swapChainConfig.imageCount, swapChainSupport.capabilities.minImageCount) :
+		swapChainSupport.capabilities.minImageCount + 1;
 	if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
 		imageCount = swapChainSupport.capabilities.maxImageCount;
 	}
@@ -451,6 +870,11 @@ void UniformBufferWindow::createSwapChain()
 		.setImageExtent(extent)
 		.setImageArrayLayers(1)
 		.setImageUsage(vk::ImageUsageFlagBits::eColorAttachment);
+	// For frame capture
+	swapChainCapturable = (bool)(swapChainSupport.capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferSrc);
+	if (swapChainCapturable) {
+		createInfo.setImageUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc);
+	}
 
 	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 	uint32_t queueFamilyIndices[] = { (uint32_t)indices.graphicsFamily, (uint32_t)indices.presentFamily };
@@ -469,11 +893,16 @@ void UniformBufferWindow::createSwapChain()
 		.setCompositeAlpha(vk::CompositeAlphaFlagBitsKHR::eOpaque)
 		.setPresentMode(presentMode)
 		.setClipped(VK_TRUE)
-		.setOldSwapchain(VK_NULL_HANDLE);
+		// Lets the driver hand over resources from the one being replaced
+		.setOldSwapchain(swapChain);
 
-	swapChain = device.createSwapchainKHR(createInfo);
+	// The old one goes once the new one exists
+	swapChain = makeHandle(device, device.createSwapchainKHR(createInfo));
 
 	swapChainImages = device.getSwapchainImagesKHR(swapChain);
+	for (size_t i = 0; i < swapChainImages.size(); i++) {
+		DEBUG_NAME(device, swapChainImages[i], "swap chain image " + std::to_string(i));
+	}
 
 	swapChainImageFormat = surfaceFormat.format;
 	swapChainExtent = extent;
@@ -481,7 +910,7 @@ void UniformBufferWindow::createSwapChain()
 
 void UniformBufferWindow::createImageViews()
 {
-	swapChainImageViews.erase(swapChainImageViews.begin(), swapChainImageViews.end());
+	swapChainImageViews.clear();
 	for (const auto& swapChainImage : swapChainImages) {
 		vk::ImageViewCreateInfo createInfo = vk::ImageViewCreateInfo()
 			.setImage(swapChainImage)
@@ -492,75 +921,107 @@ void UniformBufferWindow::createImageViews()
 				vk::ComponentSwizzle::eIdentity,
 				vk::ComponentSwizzle::eIdentity })
 			.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
-		swapChainImageViews.push_back(device.createImageView(createInfo));
+		swapChainImageViews.push_back(makeHandle(device, device.createImageView(createInfo)));
+		DEBUG_NAME(device, swapChainImageViews.back(), "swap chain view " + std::to_string(swapChainImageViews.size() - 1));
+	}
+}
+
+vk::Format UniformBufferWindow::findSupportedFormat(const std::vector<vk::Format>& candidates, vk::ImageTiling tiling,
+	vk::FormatFeatureFlags features) const
+{
+	for (vk::Format format : candidates) {
+		vk::FormatProperties properties = physicalDevice.getFormatProperties(format);
+		vk::FormatFeatureFlags supported = tiling == vk::ImageTiling::eLinear ?
+			properties.linearTilingFeatures : properties.optimalTilingFeatures;
+		if ((supported & features) == features) {
+			return format;
+		}
 	}
+	throw std::runtime_error("failed to find supported format!");
 }
 
 void UniformBufferWindow::createRenderPass()
 {
+	// With MSAA the multisampled color is resolved into the swap chain
+	// image at the end of the subpass and then thrown away. Every
+	// attachment starts and ends in the layout the frame graph put it in
+	// for the scene pass, so the pass leaves layouts alone.
+	bool multisampled = colorResource != RenderGraph::NONE;
+	vk::ImageLayout colorLayout = frameGraph.layout(scenePass, multisampled ? colorResource : swapChainResource);
+	vk::ImageLayout depthLayout = frameGraph.layout(scenePass, depthResource);
+	vk::ImageLayout resolveLayout = frameGraph.layout(scenePass, swapChainResource);
+
 	vk::AttachmentDescription colorAttachment = vk::AttachmentDescription()
 		.setFormat(swapChainImageFormat)
-		.setSamples(vk::SampleCountFlagBits::e1)
+		.setSamples(msaaSamples)
 		.setLoadOp(vk::AttachmentLoadOp::eClear)
+		.setStoreOp(multisampled ? vk::AttachmentStoreOp::eDontCare : vk::AttachmentStoreOp::eStore)
+		.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+		.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+		.setInitialLayout(colorLayout)
+		.setFinalLayout(colorLayout);
+
+	// Cleared every frame and never read back, so it need not be stored
+	vk::AttachmentDescription depthAttachment = vk::AttachmentDescription()
+		.setFormat(depthFormat)
+		.setSamples(msaaSamples)
+		.setLoadOp(vk::AttachmentLoadOp::eClear)
+		.setStoreOp(vk::AttachmentStoreOp::eDontCare)
+		.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+		.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+		.setInitialLayout(depthLayout)
+		.setFinalLayout(depthLayout);
+
+	vk::AttachmentDescription resolveAttachment = vk::AttachmentDescription()
+		.setFormat(swapChainImageFormat)
+		.setSamples(vk::SampleCountFlagBits::e1)
+		.setLoadOp(vk::AttachmentLoadOp::eDontCare)
 		.setStoreOp(vk::AttachmentStoreOp::eStore)
 		.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
 		.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
-		.setInitialLayout(vk::ImageLayout::eUndefined)
-		.setFinalLayout(vk::ImageLayout::ePresentSrcKHR);
+		.setInitialLayout(resolveLayout)
+		.setFinalLayout(resolveLayout);
 
 	vk::AttachmentReference colorAttachmentRef = vk::AttachmentReference()
 		.setAttachment(0)
-		.setLayout(vk::ImageLayout::eColorAttachmentOptimal);
+		.setLayout(colorLayout);
+	vk::AttachmentReference depthAttachmentRef = vk::AttachmentReference()
+		.setAttachment(1)
+		.setLayout(depthLayout);
+	vk::AttachmentReference resolveAttachmentRef = vk::AttachmentReference()
+		.setAttachment(2)
+		.setLayout(resolveLayout);
 
 	vk::SubpassDescription subpass = vk::SubpassDescription()
 		.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
 		.setColorAttachmentCount(1)
-		.setPColorAttachments(&colorAttachmentRef);
-
-	vk::SubpassDependency dependency = vk::SubpassDependency()
-		.setSrcSubpass(VK_SUBPASS_EXTERNAL)
-		.setDstSubpass(0)
-		.setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
-		//.setSrcAccessMask(0)
-		.setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
-		.setDstAccessMask(vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite);
-
-
+		.setPColorAttachments(&colorAttachmentRef)
+		.setPResolveAttachments(multisampled ? &resolveAttachmentRef : nullptr)
+		.setPDepthStencilAttachment(&depthAttachmentRef);
+
+	// No external dependency: the graph's barriers before the scene pass
+	// already wait for the image acquire and, on the transients, for the
+	// previous frame's last use of their memory
+	vk::AttachmentDescription attachments[] = { colorAttachment, depthAttachment, resolveAttachment };
 	vk::RenderPassCreateInfo renderPassInfo = vk::RenderPassCreateInfo()
-		.setAttachmentCount(1)
-		.setPAttachments(&colorAttachment)
-		.setDependencyCount(1)
-		.setPDependencies(&dependency)
+		.setAttachmentCount(multisampled ? 3 : 2)
+		.setPAttachments(attachments)
 		.setSubpassCount(1)
 		.setPSubpasses(&subpass);
 
-	renderPass = device.createRenderPass(renderPassInfo);
-}
-
-static std::vector<char> readFile(const std::string& filename) {
-	std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-	if (!file.is_open()) {
-		throw std::runtime_error("failed to open file!");
-	}
-	size_t fileSize = (size_t)file.tellg();
-	std::vector<char> buffer(fileSize);
-
-	file.seekg(0);
-	file.read(buffer.data(), fileSize);
-
-	file.close();
-
-	return buffer;
+	renderPass = makeHandle(device, device.createRenderPass(renderPassInfo));
 }
 
 void UniformBufferWindow::createGraphicsPipeline() {
-	auto vertShaderCode = readFile("vert.spv");
-	auto fragShaderCode = readFile("frag.spv");
-
-	vk::ShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-	vk::ShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+	// Modules stay in the cache, so a rebuild after a resize does no file I/O
+	graphicsPipeline = buildGraphicsPipeline(shaders.load("vert.spv"), shaders.load("frag.spv"), pipelineLayout,
+		"mesh pipeline");
+	depthPrepassPipeline = buildGraphicsPipeline(shaders.load("vert.spv"), nullptr, pipelineLayout,
+		"depth prepass pipeline");
+}
 
+DeviceHandle<vk::Pipeline> UniformBufferWindow::buildGraphicsPipeline(vk::ShaderModule vertShaderModule, vk::ShaderModule fragShaderModule,
+	vk::PipelineLayout layout, const char* name) {
 	vk::PipelineShaderStageCreateInfo vertShaderStageInfo = vk::PipelineShaderStageCreateInfo()
 		.setStage(vk::ShaderStageFlagBits::eVertex)
 		.setModule(vertShaderModule)
@@ -571,9 +1032,20 @@ void UniformBufferWindow::createGraphicsPipeline() {
 		.setModule(fragShaderModule)
 		.setPName("main");
 	vk::PipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
-
-	auto bindingDescription = Vertex::getBindingDescription();
-	auto attributeDescription = Vertex::getAttributeDescriptions();
+	uint32_t stageCount = fragShaderModule ? 2 : 1;
+
+	auto bindingDescription = vertexFormat == VertexFormat::Packed ?
+		PackedVertex::getBindingDescription() : Vertex::getBindingDescription();
+	auto attributeDescription = vertexFormat == VertexFormat::Packed ?
+		PackedVertex::getAttributeDescriptions() : Vertex::getAttributeDescriptions();
+
+	for (const auto& input : shaders.layout(vertShaderModule).inputs) {
+		auto attribute = std::find_if(attributeDescription.begin(), attributeDescription.end(),
+			[&input](const vk::VertexInputAttributeDescription& a) { return a.location == input.location; });
+		if (attribute == attributeDescription.end()) {
+			throw std::runtime_error("vertex shader input has no matching attribute!");
+		}
+	}
 
 	vk::PipelineVertexInputStateCreateInfo vertexInputInfo = vk::PipelineVertexInputStateCreateInfo()
 		.setVertexBindingDescriptionCount(1)
@@ -615,15 +1087,28 @@ void UniformBufferWindow::createGraphicsPipeline() {
 
 	vk::PipelineMultisampleStateCreateInfo multisampling = vk::PipelineMultisampleStateCreateInfo()
 		.setSampleShadingEnable(VK_FALSE)
-		.setRasterizationSamples(vk::SampleCountFlagBits::e1)
+		.setRasterizationSamples(msaaSamples)
 		.setMinSampleShading(1)
 		.setPSampleMask(nullptr)
 		.setAlphaToCoverageEnable(VK_FALSE)
 		.setAlphaToOneEnable(VK_FALSE);
 
+	// Less-or-equal lets the shading pass through where a depth prepass
+	// already wrote the same depth
+	vk::PipelineDepthStencilStateCreateInfo depthStencil = vk::PipelineDepthStencilStateCreateInfo()
+		.setDepthTestEnable(VK_TRUE)
+		.setDepthWriteEnable(VK_TRUE)
+		.setDepthCompareOp(vk::CompareOp::eLessOrEqual)
+		.setDepthBoundsTestEnable(VK_FALSE)
+		.setStencilTestEnable(VK_FALSE);
+
+	vk::ColorComponentFlags colorWrites = vk::ColorComponentFlags();
+	if (fragShaderModule) {
+		colorWrites = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+			vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+	}
 	vk::PipelineColorBlendAttachmentState colorBlendAttachment = vk::PipelineColorBlendAttachmentState()
-		.setColorWriteMask(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
-			vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA)
+		.setColorWriteMask(colorWrites)
 		.setBlendEnable(VK_FALSE)
 		.setSrcColorBlendFactor(vk::BlendFactor::eOne)
 		.setDstColorBlendFactor(vk::BlendFactor::eZero)
@@ -647,71 +1132,60 @@ void UniformBufferWindow::createGraphicsPipeline() {
 		.setDynamicStateCount(2)
 		.setPDynamicStates(dynamicStates);
 
-	vk::PipelineLayoutCreateInfo pipelineLayoutInfo = vk::PipelineLayoutCreateInfo()
-		.setSetLayoutCount(1)
-		.setPSetLayouts(&descriptorSetLayout)
-		.setPushConstantRangeCount(0)
-		.setPPushConstantRanges(nullptr);
-
-	pipelineLayout = device.createPipelineLayout(pipelineLayoutInfo);
-
 	vk::GraphicsPipelineCreateInfo pipelineInfo = vk::GraphicsPipelineCreateInfo()
-		.setStageCount(2)
+		.setStageCount(stageCount)
 		.setPStages(shaderStages)
 		.setPVertexInputState(&vertexInputInfo)
 		.setPInputAssemblyState(&inputAssembly)
 		.setPViewportState(&viewportState)
 		.setPRasterizationState(&rasterizer)
 		.setPMultisampleState(&multisampling)
-		.setPDepthStencilState(nullptr)
+		.setPDepthStencilState(&depthStencil)
 		.setPColorBlendState(&colorBlending)
 		.setPDynamicState(nullptr)
-		.setLayout(pipelineLayout)
+		.setLayout(layout)
 		.setRenderPass(renderPass)
 		.setSubpass(0)
 		.setBasePipelineHandle(VK_NULL_HANDLE)
 		.setBasePipelineIndex(-1);
 
-	graphicsPipeline = device.createGraphicsPipeline(VK_NULL_HANDLE, pipelineInfo);
-
-	device.destroyShaderModule(vertShaderModule);
-	device.destroyShaderModule(fragShaderModule);
-}
-
-vk::ShaderModule UniformBufferWindow::createShaderModule(const std::vector<char>& code) {
-	vk::ShaderModuleCreateInfo createInfo = vk::ShaderModuleCreateInfo()
-		.setCodeSize(code.size())
-		.setPCode(reinterpret_cast<const uint32_t*>(code.data()));
-	return device.createShaderModule(createInfo);
+	DeviceHandle<vk::Pipeline> pipeline = makeHandle(device, device.createGraphicsPipeline(pipelineCache, pipelineInfo));
+	DEBUG_NAME(device, pipeline, name);
+	return pipeline;
 }
 
 void UniformBufferWindow::createFramebuffers()
 {
 	swapChainFramebuffers.erase(swapChainFramebuffers.begin(), swapChainFramebuffers.end());
+	bool multisampled = colorResource != RenderGraph::NONE;
 	for (const auto& swapChainImageView : swapChainImageViews) {
+		// Matches the attachment order in createRenderPass
 		vk::ImageView attachments[] = {
+			multisampled ? frameGraph.view(colorResource) : swapChainImageView.get(),
+			frameGraph.view(depthResource),
 			swapChainImageView
 		};
 
 		vk::FramebufferCreateInfo frameBufferInfo = vk::FramebufferCreateInfo()
 			.setRenderPass(renderPass)
-			.setAttachmentCount(1)
+			.setAttachmentCount(multisampled ? 3 : 2)
 			.setPAttachments(attachments)
 			.setWidth(swapChainExtent.width)
 			.setHeight(swapChainExtent.height)
 			.setLayers(1);
 
-		swapChainFramebuffers.push_back(device.createFramebuffer(frameBufferInfo));
+		swapChainFramebuffers.push_back(makeHandle(device, device.createFramebuffer(frameBufferInfo)));
 	}
 }
 
 void UniformBufferWindow::createCommandPool()
 {
 	QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+	// Command buffers of the per-draw benchmark scene are re-recorded every frame
 	vk::CommandPoolCreateInfo poolInfo = vk::CommandPoolCreateInfo()
-		.setQueueFamilyIndex(queueFamilyIndices.graphicsFamily);
-	//.setFlags(0);
-	commandPool = device.createCommandPool(poolInfo);
+		.setQueueFamilyIndex(queueFamilyIndices.graphicsFamily)
+		.setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer);
+	commandPool = makeHandle(device, device.createCommandPool(poolInfo));
 }
 
 void UniformBufferWindow::createCommandBuffers()
@@ -721,34 +1195,160 @@ void UniformBufferWindow::createCommandBuffers()
 		.setLevel(vk::CommandBufferLevel::ePrimary)
 		.setCommandBufferCount(swapChainFramebuffers.size());
 	commandBuffers = device.allocateCommandBuffers(allocInfo);
+	imagesInFlight.assign(commandBuffers.size(), vk::Fence());
+	readbackRecorded.assign(commandBuffers.size(), false);
+	staleCommandBuffers.assign(commandBuffers.size(), false);
 
-	for (size_t i = 0; i < commandBuffers.size(); i++) {
-		vk::CommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo()
-			.setFlags(vk::CommandBufferUsageFlagBits::eSimultaneousUse)
-			.setPInheritanceInfo(nullptr);
-		commandBuffers[i].begin(beginInfo);
+	for (uint32_t i = 0; i < commandBuffers.size(); i++) {
+		DEBUG_NAME(device, commandBuffers[i], "frame " + std::to_string(i));
+		recordCommandBuffer(i);
+	}
+}
 
-		std::array<float, 4> colorComponents = { 0.0f,0.0f,0.0f,0.0f };
-		vk::ClearColorValue clearColor = vk::ClearColorValue(colorComponents);
-		vk::ClearValue clearValue = vk::ClearValue(clearColor);
-		vk::RenderPassBeginInfo renderPassInfo = vk::RenderPassBeginInfo()
-			.setRenderPass(renderPass)
-			.setFramebuffer(swapChainFramebuffers[i])
-			.setRenderArea(vk::Rect2D({ 0,0 }, swapChainExtent))
-			.setClearValueCount(1)
-			.setPClearValues(&clearValue);
-		commandBuffers[i].beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
-		commandBuffers[i].bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline);
+void UniformBufferWindow::recordCommandBuffer(uint32_t imageIndex)
+{
+	vk::CommandBuffer commandBuffer = commandBuffers[imageIndex];
+	vk::CommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo()
+		.setFlags(objectCount > 0 || readbackFrame ? vk::CommandBufferUsageFlagBits::eOneTimeSubmit : vk::CommandBufferUsageFlagBits::eSimultaneousUse)
+		.setPInheritanceInfo(nullptr);
+	commandBuffer.begin(beginInfo);
+	frameGraph.bind(swapChainResource, swapChainImages[imageIndex]);
+	frameGraph.execute(commandBuffer, imageIndex);
+	commandBuffer.end();
+	staleCommandBuffers[imageIndex] = false;
+}
+
+void UniformBufferWindow::createRenderGraph()
+{
+	// Post-processing or shadow passes go in here, declaring what they
+	// read and write; the graph places the barriers between them and owns
+	// the images that only live for the frame
+	frameGraph.destroy();
+	swapChainResource = frameGraph.importImage("swapchain",
+		{ swapChainImageFormat, swapChainExtent, vk::SampleCountFlagBits::e1 },
+		vk::ImageLayout::eUndefined, vk::ImageLayout::ePresentSrcKHR);
+
+	// Best precision first; nothing here uses stencil
+	depthFormat = findSupportedFormat(
+		{ vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint, vk::Format::eD24UnormS8Uint },
+		vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eDepthStencilAttachment);
+	depthResource = frameGraph.createImage("depth attachment", { depthFormat, swapChainExtent, msaaSamples });
+	colorResource = RenderGraph::NONE;
+	if (msaaSamples != vk::SampleCountFlagBits::e1) {
+		colorResource = frameGraph.createImage("multisampled color attachment",
+			{ swapChainImageFormat, swapChainExtent, msaaSamples });
+	}
+
+	// With MSAA the swap chain image is the resolve target
+	scenePass = frameGraph.addPass("scene", [this](vk::CommandBuffer commandBuffer, uint32_t imageIndex) {
+		recordScene(commandBuffer, imageIndex);
+	});
+	if (colorResource != RenderGraph::NONE) {
+		frameGraph.write(scenePass, colorResource, RenderAccess::ColorAttachment);
+	}
+	frameGraph.write(scenePass, depthResource, RenderAccess::DepthAttachment);
+	frameGraph.write(scenePass, swapChainResource, RenderAccess::ColorAttachment);
+
+	// Captures and the stream copy the image before it is presented
+	if (swapChainCapturable) {
+		uint32_t readback = frameGraph.addPass("readback", [this](vk::CommandBuffer commandBuffer, uint32_t imageIndex) {
+			recordReadback(commandBuffer, imageIndex);
+		});
+		frameGraph.read(readback, swapChainResource, RenderAccess::TransferSrc);
+		frameGraph.keep(readback);
+	}
+
+	// Lazily allocated memory where the device has it, device local
+	// otherwise; only attachment-only transients are offered it
+	frameGraph.realize(device, [this](uint32_t memoryTypeBits) {
+		auto memProperties = physicalDevice.getMemoryProperties();
+		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+			if ((memoryTypeBits & (1 << i)) &&
+				(memProperties.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eLazilyAllocated)) {
+				return i;
+			}
+		}
+		return findMemoryType(memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
+	});
+}
+
+void UniformBufferWindow::recordReadback(vk::CommandBuffer commandBuffer, uint32_t imageIndex)
+{
+	// Recording ahead of time, e.g. in createCommandBuffers, copies nothing
+	bool recorded = false;
+	if (readbackFrame) {
+		vk::Image image = swapChainImages[imageIndex];
+		recorded = frameCapture.record(commandBuffer, image, swapChainImageFormat, swapChainExtent, frameNumber);
+		if (frameStream.active()) {
+			recorded = frameStream.record(commandBuffer, image, swapChainImageFormat, swapChainExtent, frameNumber) ||
+				recorded;
+		}
+	}
+	readbackRecorded[imageIndex] = recorded;
+}
 
-		commandBuffers[i].bindVertexBuffers(0, { vertexBuffer }, { 0 });
-		commandBuffers[i].bindIndexBuffer(indexBuffer, 0, vk::IndexType::eUint16);
+void UniformBufferWindow::recordScene(vk::CommandBuffer commandBuffer, uint32_t imageIndex)
+{
+	// The benchmark scene is recorded every frame, so the query can belong
+	// to the frame rather than the image
+	bool countFragments = statisticsPool && objectCount > 0;
+	uint32_t query = (uint32_t)currentFrame;
+	if (countFragments) {
+		commandBuffer.resetQueryPool(statisticsPool, query, 1);
+		commandBuffer.beginQuery(statisticsPool, query, vk::QueryControlFlags());
+	}
 
-		commandBuffers[i].drawIndexed(indices.size(), 1, 0, 0, 0);
-		commandBuffers[i].endRenderPass();
-		commandBuffers[i].end();
+	std::array<float, 4> colorComponents = { 0.0f,0.0f,0.0f,0.0f };
+	vk::ClearValue clearValues[] = {
+		vk::ClearColorValue(colorComponents),
+		vk::ClearDepthStencilValue(1.0f, 0)
+	};
+	vk::RenderPassBeginInfo renderPassInfo = vk::RenderPassBeginInfo()
+		.setRenderPass(renderPass)
+		.setFramebuffer(swapChainFramebuffers[imageIndex])
+		.setRenderArea(vk::Rect2D({ 0,0 }, swapChainExtent))
+		.setClearValueCount(2)
+		.setPClearValues(clearValues);
+	commandBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
+
+	if (objectCount > 0) {
+		recordObjects(commandBuffer, imageIndex);
+	}
+	else {
+		auto drawMeshes = [this, commandBuffer, imageIndex](vk::Pipeline pipeline) {
+			commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+			commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0,
+				{ descriptorSets[imageIndex] }, nullptr);
+
+			geometry.bind(commandBuffer);
+			geometry.drawAll(commandBuffer, [this, commandBuffer](uint32_t mesh) {
+				ObjectConstants constants = { meshTransform(mesh), glm::vec4(1.0f) };
+				commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex,
+					0, sizeof(constants), &constants);
+			});
+		};
+		if (depthPrepass) {
+			DEBUG_LABEL(commandBuffer, "depth prepass");
+			drawMeshes(depthPrepassPipeline);
+		}
+		DEBUG_LABEL(commandBuffer, "meshes");
+		drawMeshes(graphicsPipeline);
+	}
+	commandBuffer.endRenderPass();
+	if (countFragments) {
+		commandBuffer.endQuery(statisticsPool, query);
 	}
 }
 
+glm::mat4 UniformBufferWindow::meshTransform(uint32_t mesh) const
+{
+	// Packed positions are dequantized by the model matrix
+	if (vertexFormat == VertexFormat::Packed && mesh < meshBounds.size()) {
+		return meshBounds[mesh].transform();
+	}
+	return glm::mat4(1.0f);
+}
+
 void UniformBufferWindow::createSyncObjects()
 {
 	vk::SemaphoreCreateInfo semaphoreInfo;
@@ -759,10 +1359,25 @@ void UniformBufferWindow::createSyncObjects()
 	inFlightFences.erase(inFlightFences.begin(), inFlightFences.end());
 
 	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-		imageAvailableSemaphores.push_back(device.createSemaphore(semaphoreInfo));
-		renderFinishedSemaphores.push_back(device.createSemaphore(semaphoreInfo));
-		inFlightFences.push_back(device.createFence(fenceInfo));
+		imageAvailableSemaphores.push_back(makeHandle(device, device.createSemaphore(semaphoreInfo)));
+		renderFinishedSemaphores.push_back(makeHandle(device, device.createSemaphore(semaphoreInfo)));
+		inFlightFences.push_back(makeHandle(device, device.createFence(fenceInfo)));
 	}
+	retired.create(MAX_FRAMES_IN_FLIGHT);
+}
+
+void UniformBufferWindow::createQueryPool()
+{
+	statisticsPending.assign(MAX_FRAMES_IN_FLIGHT, false);
+	if (!physicalDevice.getFeatures().pipelineStatisticsQuery) {
+		OutputDebugStringA("pipeline statistics not supported, fragments_per_pixel unavailable\n");
+		return;
+	}
+	vk::QueryPoolCreateInfo queryPoolInfo = vk::QueryPoolCreateInfo()
+		.setQueryType(vk::QueryType::ePipelineStatistics)
+		.setQueryCount(MAX_FRAMES_IN_FLIGHT)
+		.setPipelineStatistics(vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations);
+	statisticsPool = makeHandle(device, device.createQueryPool(queryPoolInfo));
 }
 
 void UniformBufferWindow::drawFrame()
@@ -770,14 +1385,78 @@ void UniformBufferWindow::drawFrame()
 	if (commandBuffers.size() == 0) {
 		return;
 	}
+	swapPendingPipeline();
+	// PowerSaving waits on the last frame before sleeping, so its latency
+	// is taken when it completes rather than when the sleep ends
+	pacer.wait([this](std::chrono::nanoseconds timeout) {
+		size_t lastFrame = (currentFrame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT;
+		device.waitForFences({ inFlightFences[lastFrame] }, VK_TRUE, (uint64_t)timeout.count());
+		pollFrameFences();
+	});
 	device.waitForFences({ inFlightFences[currentFrame] }, VK_TRUE, std::numeric_limits<uint64_t>::max());
-	device.resetFences({ inFlightFences[currentFrame] });
-	auto result = device.acquireNextImageKHR(swapChain, std::numeric_limits<uint64_t>::max(), imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE);
-	if (result.result == vk::Result::eErrorOutOfDateKHR) {
+	pacer.completed(currentFrame);
+	retired.release(currentFrame);
+	if (statisticsPending[currentFrame]) {
+		// Above 1.0 is overdraw: pixels shaded more than once. The frame
+		// is done, so the result is there without waiting.
+		statisticsPending[currentFrame] = false;
+		uint64_t invocations = 0;
+		if (device.getQueryPoolResults<uint64_t>(statisticsPool, (uint32_t)currentFrame, 1, invocations,
+			sizeof(uint64_t), vk::QueryResultFlagBits::e64) == vk::Result::eSuccess) {
+			benchmark.sample("fragments_per_pixel",
+				(double)invocations / ((double)swapChainExtent.width * swapChainExtent.height));
+		}
+	}
+	MemoryTracker::poll();
+	frameDescriptors[currentFrame].reset();
+	// The UI thread resizes the window whenever it likes, so the swap chain
+	// can go out of date between any two frames
+	uint32_t imageIndex;
+	try {
+		imageIndex = device.acquireNextImageKHR(swapChain, std::numeric_limits<uint64_t>::max(),
+			imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE).value;
+	}
+	catch (const vk::OutOfDateKHRError&) {
 		recreateSwapChain();
 		return;
 	}
-	uint32_t imageIndex = result.value;
+
+	// The uniform buffer and the command buffer belong to the image, and the
+	// frame that last drew to it may still be in flight
+	if (imagesInFlight[imageIndex]) {
+		device.waitForFences({ imagesInFlight[imageIndex] }, VK_TRUE, std::numeric_limits<uint64_t>::max());
+		pollFrameFences();
+	}
+	imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+
+	// Animation is sampled only now, once the image is ours, so what is
+	// shown is as fresh as it can be.
+	pacer.sample();
+	updateUniformBuffer(imageIndex);
+	bool readback = swapChainCapturable && (frameCapture.due(frameNumber) || frameStream.active());
+	if (objectCount > 0) {
+		// Every frame writes the one object buffer while recording, so the
+		// frame before this one has to be done reading it
+		size_t previousFrame = (currentFrame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT;
+		device.waitForFences({ inFlightFences[previousFrame] }, VK_TRUE, std::numeric_limits<uint64_t>::max());
+		pacer.completed(previousFrame);
+		auto recordStart = std::chrono::steady_clock::now();
+		commandBuffers[imageIndex].reset(vk::CommandBufferResetFlags());
+		readbackFrame = readback;
+		recordCommandBuffer(imageIndex);
+		readbackFrame = false;
+		benchmark.sample("record_ms", std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - recordStart).count());
+		benchmark.sample("descriptor_pools", (double)frameDescriptors[currentFrame].poolCount());
+	}
+	else if (readback || readbackRecorded[imageIndex] || staleCommandBuffers[imageIndex]) {
+		// Otherwise recorded once and reused; the wait on the image's fence
+		// above has made the buffer safe to reset
+		commandBuffers[imageIndex].reset(vk::CommandBufferResetFlags());
+		readbackFrame = readback;
+		recordCommandBuffer(imageIndex);
+		readbackFrame = false;
+	}
 
 	vk::Semaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
 	vk::PipelineStageFlags waitStages[] = {
@@ -793,7 +1472,13 @@ void UniformBufferWindow::drawFrame()
 		.setSignalSemaphoreCount(1)
 		.setPSignalSemaphores(signalSemaphores);
 
+	// Only now, so a frame that gave up on acquiring leaves its fence signalled
+	device.resetFences({ inFlightFences[currentFrame] });
 	graphicsQueue.submit({ submitInfo }, inFlightFences[currentFrame]);
+	pacer.submitted(currentFrame);
+	statisticsPending[currentFrame] = statisticsPool && objectCount > 0;
+	frameCapture.submitted(graphicsQueue);
+	frameStream.submitted(graphicsQueue);
 
 	vk::SwapchainKHR swapChains[] = { swapChain };
 	vk::PresentInfoKHR presentInfo = vk::PresentInfoKHR()
@@ -803,61 +1488,616 @@ void UniformBufferWindow::drawFrame()
 		.setPSwapchains(swapChains)
 		.setPImageIndices(&imageIndex)
 		.setPResults(nullptr);
-	presentQueue.presentKHR(presentInfo);
-	presentQueue.waitIdle();
-
+	bool outOfDate = false;
+	try {
+		outOfDate = presentQueue.presentKHR(presentInfo) == vk::Result::eSuboptimalKHR;
+	}
+	catch (const vk::OutOfDateKHRError&) {
+		outOfDate = true;
+	}
+	// Low latency keeps the queue empty, so the next frame samples input
+	// with nothing queued ahead of it; the other modes let the in-flight
+	// fences keep up to MAX_FRAMES_IN_FLIGHT frames queued
+	if (pacer.mode() == PacingMode::LowLatency) {
+		presentQueue.waitIdle();
+	}
+	// Latency is exact when one of the fence waits blocked; a frame that
+	// finished while the CPU was busy is only seen at the next check
+	pollFrameFences();
+	pacer.presented();
+	startup.firstFrame();
+	benchmark.sample("latency_ms", pacer.latencyMs());
+	benchmark.sample("cpu_percent", pacer.cpuPercent());
+	benchmark.sample("memory_mb", MemoryTracker::total().live / (1024.0 * 1024.0));
+
+	frameCapture.poll();
+	if (frameStream.active()) {
+		// Per frame, so the means are the share of frames each happened to
+		frameStream.poll();
+		uint64_t totals[] = { frameStream.streamedFrames(), frameStream.droppedFrames(), frameStream.skippedFrames() };
+		benchmark.sample("stream_delivered", (double)(totals[0] - streamTotals[0]));
+		benchmark.sample("stream_dropped", (double)(totals[1] - streamTotals[1]));
+		benchmark.sample("stream_skipped", (double)(totals[2] - streamTotals[2]));
+		std::copy(totals, totals + 3, streamTotals);
+	}
 	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	frameNumber++;
+
+	// The frame still went out; the next one is drawn at the new size
+	if (outOfDate) {
+		recreateSwapChain();
+	}
+
+	if (benchmark.running()) {
+		benchmark.tick();
+		if (!benchmark.running()) {
+			benchmark.report("benchmark.csv");
+			// Quit from the thread that owns the message loop
+			PostMessage(Handle(), WM_CLOSE, 0, 0);
+		}
+	}
+}
+
+void UniformBufferWindow::pollFrameFences()
+{
+	for (size_t i = 0; i < inFlightFences.size(); i++) {
+		if (device.getFenceStatus(inFlightFences[i]) == vk::Result::eSuccess) {
+			pacer.completed(i);
+		}
+	}
 }
 
-void UniformBufferWindow::createVertexBuffers()
+void UniformBufferWindow::reloadShaders(const std::vector<std::string>& outputs)
 {
-	vk::DeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+	// Runs on the watcher thread; the old pipeline keeps rendering meanwhile
+	std::lock_guard<std::mutex> lock(pipelineMutex);
+	for (const auto& output : outputs) {
+		shaders.invalidate(output);
+	}
 
-	vk::Buffer stagingBuffer;
-	vk::DeviceMemory stagingBufferMemory;
-	createBuffer(bufferSize,
-		vk::BufferUsageFlagBits::eTransferSrc,
-		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-		stagingBuffer, stagingBufferMemory);
+	DeviceHandle<vk::Pipeline> pipeline;
+	DeviceHandle<vk::Pipeline> prepassPipeline;
+	try {
+		vk::ShaderModule vertShaderModule = shaders.load("vert.spv");
+		vk::ShaderModule fragShaderModule = shaders.load("frag.spv");
+		// Descriptor sets and command buffers are built against pipelineLayout;
+		// a reloaded shader with a different interface needs a restart
+		ShaderLayout interfaceLayout = ShaderReflection::merge(
+			shaders.layout(vertShaderModule), shaders.layout(fragShaderModule));
+		if (layouts.pipelineLayout(interfaceLayout) != pipelineLayout) {
+			throw std::runtime_error("shader interface does not match the pipeline layout!");
+		}
+		pipeline = buildGraphicsPipeline(vertShaderModule, fragShaderModule, pipelineLayout,
+			"mesh pipeline (reloaded)");
+		prepassPipeline = buildGraphicsPipeline(vertShaderModule, nullptr, pipelineLayout,
+			"depth prepass pipeline (reloaded)");
+	}
+	catch (const std::exception& e) {
+		OutputDebugStringA("shader reload failed: ");
+		OutputDebugStringA(e.what());
+		OutputDebugStringA("\n");
+		// Later pipeline builds, e.g. for a new swap chain, keep using the
+		// shaders the running pipeline was built from
+		for (const auto& output : outputs) {
+			shaders.revert(output);
+		}
+		return;
+	}
+	for (const auto& output : outputs) {
+		shaders.commit(output);
+	}
+	// Replaces any build that was never swapped in
+	pendingPipeline = std::move(pipeline);
+	pendingPrepassPipeline = std::move(prepassPipeline);
+	pipelineReady = true;
+}
+
+void UniformBufferWindow::swapPendingPipeline()
+{
+	// Never wait for a build in progress; pick it up on a later frame
+	if (!pipelineReady || !pipelineMutex.try_lock()) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(pipelineMutex, std::adopt_lock);
+	if (pendingPipeline) {
+		// Frames already submitted still use the old pipelines; the last of
+		// them is the one before this
+		size_t lastFrame = (currentFrame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT;
+		retired.retire(lastFrame, std::move(graphicsPipeline));
+		retired.retire(lastFrame, std::move(depthPrepassPipeline));
+		graphicsPipeline = std::move(pendingPipeline);
+		depthPrepassPipeline = std::move(pendingPrepassPipeline);
+		// Rather than waiting for the device to go idle, each command
+		// buffer is recorded again after its own image's fence
+		staleCommandBuffers.assign(commandBuffers.size(), true);
+	}
+	pipelineReady = false;
+}
+
+void UniformBufferWindow::rebuildCommandBuffers()
+{
+	// Frames in flight may still be executing the buffers freed here
+	device.waitIdle();
+	device.freeCommandBuffers(commandPool, commandBuffers);
+	createCommandBuffers();
+}
+
+static void makeGrid(uint32_t columns, uint32_t rows, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	vertices.clear();
+	indices.clear();
+	for (uint32_t y = 0; y <= rows; y++) {
+		for (uint32_t x = 0; x <= columns; x++) {
+			float u = (float)x / columns;
+			float v = (float)y / rows;
+			vertices.push_back({ { u * 1.6f - 0.8f, v * 1.6f - 0.8f },{ u, v, 1.0f - u } });
+		}
+	}
+	for (uint32_t y = 0; y < rows; y++) {
+		for (uint32_t x = 0; x < columns; x++) {
+			uint32_t i = y * (columns + 1) + x;
+			indices.insert(indices.end(), { i, i + 1, i + columns + 2, i + columns + 2, i + columns + 1, i });
+		}
+	}
+}
+
+void UniformBufferWindow::createBenchmarks()
+{
+	// First, and over before it runs: reports how long startup took. The
+	// frames that follow draw the plain demo scene.
+	benchmark.add("startup", [this]() {
+		objectCount = 0;
+		depthPrepass = false;
+		benchmark.counter("time_to_first_frame_ms", startup.timeToFirstFrameMs());
+		benchmark.counter("init_ms", startup.initMs());
+	});
+
+	auto scene = [this](IndexCompression compression, bool optimize) {
+		return [this, compression, optimize]() {
+			std::vector<Vertex> gridVertices;
+			std::vector<uint32_t> gridIndices;
+			makeGrid(400, 400, gridVertices, gridIndices);
+
+			MeshStats before = MeshOptimizer::analyze(gridIndices, (uint32_t)gridVertices.size());
+			if (optimize) {
+				MeshOptimizer::optimizeOverdraw(gridIndices, gridVertices);
+				MeshOptimizer::optimizeVertexFetch(gridVertices, gridIndices);
+			}
+			MeshStats after = MeshOptimizer::analyze(gridIndices, (uint32_t)gridVertices.size());
+
+			if (benchmarkMesh != GeometryPool::NO_MESH) {
+				geometry.remove(benchmarkMesh);
+			}
+			benchmarkMesh = addMesh(gridVertices, gridIndices, compression);
+			// The upload may replace the buffers frames in flight are reading
+			device.waitIdle();
+			geometry.upload(commandPool, graphicsQueue);
+			rebuildCommandBuffers();
+
+			benchmark.counter("vertices", (double)gridVertices.size());
+			benchmark.counter("index_bytes", (double)geometry.indexBytes(benchmarkMesh));
+			benchmark.counter("draws", (double)geometry.drawCount(benchmarkMesh));
+			benchmark.counter("acmr_before", before.acmr);
+			benchmark.counter("acmr_after", after.acmr);
+			benchmark.counter("atvr_before", before.atvr);
+			benchmark.counter("atvr_after", after.atvr);
+		};
+	};
+	benchmark.add("indices-uint32", scene(IndexCompression::None, false));
+	benchmark.add("indices-auto", scene(IndexCompression::Auto, false));
+	benchmark.add("indices-auto-optimized", scene(IndexCompression::Auto, true));
+
+	// Same scene, same draws; only the way each draw gets its transform differs
+	auto objects = [this](DrawPath path) {
+		return [this, path]() {
+			createObjectResources();
+			drawPath = path;
+			objectCount = MAX_OBJECTS;
+			objectLayers = 1;
+			depthPrepass = false;
+			objectStart = std::chrono::steady_clock::now();
+
+			benchmark.counter("draws", objectCount);
+			benchmark.counter("bytes_per_draw", path == DrawPath::PushConstants || path == DrawPath::Bindless ?
+				(double)sizeof(ObjectConstants) : (double)objectStride);
+		};
+	};
+	benchmark.add("draws-uniform-buffer", objects(DrawPath::UniformBuffer));
+	benchmark.add("draws-dynamic-uniform-buffer", objects(DrawPath::DynamicUniformBuffer));
+	benchmark.add("draws-transient-sets", objects(DrawPath::TransientUniformBuffer));
+	benchmark.add("draws-push-constants", objects(DrawPath::PushConstants));
+	if (bindless) {
+		benchmark.add("draws-bindless", objects(DrawPath::Bindless));
+	}
+
+	// Stacks of copies drawn back to front; fragments_per_pixel shows what
+	// the prepass saves in shading
+	auto overdraw = [this](bool prepass) {
+		return [this, prepass]() {
+			createObjectResources();
+			drawPath = DrawPath::PushConstants;
+			objectCount = MAX_OBJECTS;
+			objectLayers = OVERDRAW_LAYERS;
+			depthPrepass = prepass;
+			objectStart = std::chrono::steady_clock::now();
+
+			benchmark.counter("draws", prepass ? objectCount * 2.0 : objectCount);
+			benchmark.counter("layers", objectLayers);
+		};
+	};
+	benchmark.add("overdraw", overdraw(false));
+	benchmark.add("overdraw-depth-prepass", overdraw(true));
+
+	// The plain demo scene under each pacing mode
+	auto pacing = [this](PacingMode mode) {
+		return [this, mode]() {
+			objectCount = 0;
+			depthPrepass = false;
+			pacer.setMode(mode, pacer.targetFps());
+			recreateSwapChain();
+
+			benchmark.counter("target_fps", mode == PacingMode::PowerSaving ? pacer.targetFps() : 0.0);
+		};
+	};
+	benchmark.add("pacing-low-latency", pacing(PacingMode::LowLatency));
+	benchmark.add("pacing-power-saving", pacing(PacingMode::PowerSaving));
+	benchmark.add("pacing-uncapped", pacing(PacingMode::Uncapped));
+
+	// Swap chain depth against each present mode the surface offers
+	SwapChainSupportDetails support = querySwapChainSupport(physicalDevice);
+	for (vk::PresentModeKHR mode : support.presentModes) {
+		for (uint32_t imageCount = 2; imageCount <= 4; imageCount++) {
+			if (imageCount < support.capabilities.minImageCount ||
+				(support.capabilities.maxImageCount > 0 && imageCount > support.capabilities.maxImageCount)) {
+				continue;
+			}
+			benchmark.add("swapchain-" + presentModeName(mode) + "-" + std::to_string(imageCount),
+				[this, mode, imageCount]() {
+				objectCount = 0;
+				depthPrepass = false;
+				SwapChainConfig config = swapChainConfig;
+				config.imageCount = imageCount;
+				config.presentModes = { mode };
+				configureSwapChain(config);
+
+				benchmark.counter("images", (double)swapChainImages.size());
+			});
+		}
+	}
 
-	void* data = device.mapMemory(stagingBufferMemory, 0, bufferSize);
-	memcpy(data, vertices.data(), (size_t)bufferSize);
-	device.unmapMemory(stagingBufferMemory);
+	// CPU only; the frames that follow draw the plain demo scene
+	benchmark.add("observable-dispatch", [this]() {
+		objectCount = 0;
+		depthPrepass = false;
+		DispatchTimings timings = DispatchBenchmark::measure();
+		benchmark.counter("map_ns_per_message", timings.mapNs);
+		benchmark.counter("flat_ns_per_message", timings.flatNs);
+		benchmark.counter("observed_messages", timings.observed);
+	});
 
-	createBuffer(bufferSize,
-		vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer,
-		vk::MemoryPropertyFlagBits::eDeviceLocal, vertexBuffer, vertexBufferMemory);
+	// Last, since the stream keeps running until cleanup. The resize to
+	// 1080p, as far as the screen allows, arrives as WM_SIZE during warmup.
+	benchmark.add("readback-stream", [this]() {
+		objectCount = 0;
+		depthPrepass = false;
+		PostMessage(Handle(), WM_RESIZE_WINDOW, 1920, 1080);
+		// Stands in for an encoder by reading every byte once
+		startFrameStream([](const ReadbackFrame& frame) {
+			const uint64_t* words = (const uint64_t*)frame.data;
+			size_t count = (size_t)frame.rowPitch * frame.extent.height / sizeof(uint64_t);
+			uint64_t sum = 0;
+			for (size_t i = 0; i < count; i++) {
+				sum += words[i];
+			}
+			volatile uint64_t sink = sum;
+		});
+	});
+}
 
-	copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+void UniformBufferWindow::compareCapture(const std::string& path, const RgbImage& image)
+{
+	// On the capture worker thread
+	if (goldenPath.empty()) {
+		return;
+	}
+	bool passed = false;
+	try {
+		RgbImage golden = ImageFile::read(goldenPath);
+		CompareResult result = ImageCompare::compare(image, golden, goldenTolerance);
+		OutputDebugStringA(("golden " + goldenPath + ": " + ImageCompare::describe(result) + "\n").c_str());
+		if (!result.passed && !result.sizeMismatch) {
+			ImageFile::write(path + ".diff.ppm", ImageCompare::difference(image, golden, goldenTolerance));
+		}
+		passed = result.passed;
+	}
+	catch (const std::exception& e) {
+		OutputDebugStringA(("golden " + goldenPath + ": " + e.what() + "\n").c_str());
+	}
+	// The exit code is the result, for running headless
+	PostMessage(Handle(), WM_CLOSE, passed ? 0 : 1, 0);
+}
 
-	device.destroyBuffer(stagingBuffer);
-	device.freeMemory(stagingBufferMemory);
+void UniformBufferWindow::startFrameStream(FrameStream::Consumer consumer)
+{
+	if (!swapChainCapturable) {
+		OutputDebugStringA("swap chain images cannot be read back, not streaming\n");
+		return;
+	}
+	// Three copies in flight cover a frame or two of GPU latency; two
+	// queued frames let the consumer absorb a hiccup
+	frameStream.destroy();
+	frameStream.create(device, physicalDevice, 3, 2, consumer);
+	std::fill(streamTotals, streamTotals + 3, 0);
 }
 
-void UniformBufferWindow::createIndexBuffers()
+void UniformBufferWindow::createObjectResources()
 {
-	vk::DeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+	if (objectBuffer) {
+		return;
+	}
+	// A shader reload may destroy the modules it replaces meanwhile
+	std::lock_guard<std::mutex> lock(pipelineMutex);
 
-	vk::Buffer stagingBuffer;
-	vk::DeviceMemory stagingBufferMemory;
-	createBuffer(bufferSize,
-		vk::BufferUsageFlagBits::eTransferSrc,
+	vk::DeviceSize alignment = physicalDevice.getProperties().limits.minUniformBufferOffsetAlignment;
+	objectStride = (sizeof(ObjectConstants) + alignment - 1) / alignment * alignment;
+	createBuffer(objectStride * MAX_OBJECTS, vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer,
 		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-		stagingBuffer, stagingBufferMemory);
+		objectBuffer, objectBufferMemory, MemoryCategory::Uniform, "object constants");
+	objectData = (char*)device.mapMemory(objectBufferMemory, 0, VK_WHOLE_SIZE);
+
+	// Both variants read set 1 the same way; they differ only in its descriptor type
+	ShaderLayout uniformInterface = ShaderReflection::merge(
+		shaders.layout(shaders.load("vert_ubo.spv")), shaders.layout(shaders.load("frag.spv")));
+	ShaderLayout dynamicInterface = uniformInterface;
+	for (auto& binding : dynamicInterface.bindings) {
+		if (binding.set == 1) {
+			binding.type = vk::DescriptorType::eUniformBufferDynamic;
+		}
+	}
+	std::vector<vk::DescriptorSetLayout> uniformSetLayouts;
+	std::vector<vk::DescriptorSetLayout> dynamicSetLayouts;
+	uniformObjectLayout = layouts.pipelineLayout(uniformInterface, &uniformSetLayouts);
+	dynamicObjectLayout = layouts.pipelineLayout(dynamicInterface, &dynamicSetLayouts);
+
+	objectSetLayout = uniformSetLayouts[1];
+	objectSets.clear();
+	for (uint32_t i = 0; i < MAX_OBJECTS; i++) {
+		objectSets.push_back(descriptorCache.get(objectSetLayout, {
+			DescriptorBinding::forBuffer(0, vk::DescriptorType::eUniformBuffer, objectBuffer, i * objectStride, sizeof(ObjectConstants))
+		}));
+	}
+	dynamicObjectSet = descriptorCache.get(dynamicSetLayouts[1], {
+		DescriptorBinding::forBuffer(0, vk::DescriptorType::eUniformBufferDynamic, objectBuffer, 0, sizeof(ObjectConstants))
+	});
+
+	if (bindless) {
+		// Set 0 is shared with the other paths; set 1 is the table itself
+		objectBufferIndex = bindlessTable.addBuffer(objectBuffer);
+		ShaderLayout bindlessInterface = shaders.layout(shaders.load("vert_bindless.spv"));
+		bindlessObjectLayout = layouts.pipelineLayout({ descriptorSetLayouts[0], bindlessTable.setLayout() },
+			vk::PushConstantRange(bindlessInterface.pushConstantStages, 0, bindlessInterface.pushConstantSize));
+	}
+
+	createObjectPipelines();
+}
+
+void UniformBufferWindow::createObjectPipelines()
+{
+	vk::ShaderModule vertShaderModule = shaders.load("vert_ubo.spv");
+	vk::ShaderModule fragShaderModule = shaders.load("frag.spv");
+	uniformObjectPipeline = buildGraphicsPipeline(vertShaderModule, fragShaderModule, uniformObjectLayout,
+		"uniform object pipeline");
+	dynamicObjectPipeline = buildGraphicsPipeline(vertShaderModule, fragShaderModule, dynamicObjectLayout,
+		"dynamic object pipeline");
+	if (bindless) {
+		bindlessObjectPipeline = buildGraphicsPipeline(shaders.load("vert_bindless.spv"), fragShaderModule,
+			bindlessObjectLayout, "bindless object pipeline");
+	}
+}
+
+void UniformBufferWindow::destroyObjectResources()
+{
+	// The pipelines go with the swap chain in cleanupSwapChain
+	if (!objectBuffer) {
+		return;
+	}
+	if (bindless) {
+		bindlessTable.removeBuffer(objectBufferIndex);
+	}
+	device.unmapMemory(objectBufferMemory);
+	objectBuffer.reset();
+	objectBufferMemory.reset();
+	objectData = nullptr;
+	objectCount = 0;
+}
+
+void UniformBufferWindow::recordObjects(vk::CommandBuffer commandBuffer, uint32_t imageIndex)
+{
+	DEBUG_LABEL(commandBuffer, "objects");
+	vk::Pipeline pipeline = graphicsPipeline;
+	vk::PipelineLayout layout = pipelineLayout;
+	if (drawPath == DrawPath::UniformBuffer || drawPath == DrawPath::TransientUniformBuffer) {
+		pipeline = uniformObjectPipeline;
+		layout = uniformObjectLayout;
+	}
+	else if (drawPath == DrawPath::DynamicUniformBuffer) {
+		pipeline = dynamicObjectPipeline;
+		layout = dynamicObjectLayout;
+	}
+	else if (drawPath == DrawPath::Bindless) {
+		pipeline = bindlessObjectPipeline;
+		layout = bindlessObjectLayout;
+	}
 
-	void* data = device.mapMemory(stagingBufferMemory, 0, bufferSize);
-	memcpy(data, indices.data(), (size_t)bufferSize);
-	device.unmapMemory(stagingBufferMemory);
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 0,
+		{ descriptorSets[imageIndex] }, nullptr);
+	if (drawPath == DrawPath::Bindless) {
+		// The only descriptor bind of the pass; every draw below reaches its data by index
+		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 1,
+			{ bindlessTable.descriptorSet() }, nullptr);
+	}
+	geometry.bind(commandBuffer, geometry.mesh(demoMesh).indexType);
+
+	// A square grid of copies, each spinning at its own rate. With several
+	// layers every cell holds a stack, drawn farthest first so without a
+	// prepass each layer shades over the one before.
+	float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - objectStart).count();
+	uint32_t cells = objectCount / objectLayers;
+	uint32_t columns = (uint32_t)std::ceil(std::sqrt((float)cells));
+	float cell = 2.0f / columns;
+	glm::mat4 meshModel = meshTransform(demoMesh);
+
+	auto objectConstants = [&](uint32_t i) {
+		uint32_t c = i % cells;
+		uint32_t layer = i / cells;
+		float angle = time * (1.0f + (i % 7) * 0.25f);
+		float scale = cell * 0.9f;
+		ObjectConstants constants;
+		constants.model = glm::mat4(1.0f);
+		constants.model[0][0] = std::cos(angle) * scale;
+		constants.model[0][1] = std::sin(angle) * scale;
+		constants.model[1][0] = -std::sin(angle) * scale;
+		constants.model[1][1] = std::cos(angle) * scale;
+		constants.model[3][0] = -1.0f + cell * (c % columns + 0.5f);
+		constants.model[3][1] = -1.0f + cell * (c / columns + 0.5f);
+		constants.model[3][2] = 1.0f - (layer + 1.0f) / (objectLayers + 1.0f);
+		constants.model = constants.model * meshModel;
+		constants.tint = glm::vec4((float)(c % columns) / columns, (float)(c / columns) / columns,
+			1.0f - (float)layer / objectLayers, 1.0f);
+		return constants;
+	};
 
-	createBuffer(bufferSize,
-		vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer,
-		vk::MemoryPropertyFlagBits::eDeviceLocal,
-		indexBuffer, indexBufferMemory);
+	// Only the push constant path has a depth-only twin of its pipeline
+	if (depthPrepass && drawPath == DrawPath::PushConstants) {
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, depthPrepassPipeline);
+		for (uint32_t i = 0; i < objectCount; i++) {
+			ObjectConstants constants = objectConstants(i);
+			commandBuffer.pushConstants(layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(constants), &constants);
+			geometry.draw(commandBuffer, demoMesh);
+		}
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+	}
 
-	copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+	for (uint32_t i = 0; i < objectCount; i++) {
+		ObjectConstants constants = objectConstants(i);
 
-	device.destroyBuffer(stagingBuffer);
-	device.freeMemory(stagingBufferMemory);
+		switch (drawPath) {
+		case DrawPath::PushConstants:
+			commandBuffer.pushConstants(layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(constants), &constants);
+			break;
+		case DrawPath::UniformBuffer:
+			memcpy(objectData + i * objectStride, &constants, sizeof(constants));
+			commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 1, { objectSets[i] }, nullptr);
+			break;
+		case DrawPath::TransientUniformBuffer: {
+			memcpy(objectData + i * objectStride, &constants, sizeof(constants));
+			vk::DescriptorSet set = frameDescriptors[currentFrame].allocate(objectSetLayout);
+			vk::DescriptorBufferInfo bufferInfo(objectBuffer, i * objectStride, sizeof(constants));
+			vk::WriteDescriptorSet descriptorWrite = vk::WriteDescriptorSet()
+				.setDstSet(set)
+				.setDstBinding(0)
+				.setDstArrayElement(0)
+				.setDescriptorType(vk::DescriptorType::eUniformBuffer)
+				.setDescriptorCount(1)
+				.setPBufferInfo(&bufferInfo);
+			device.updateDescriptorSets({ descriptorWrite }, nullptr);
+			commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 1, { set }, nullptr);
+			break;
+		}
+		case DrawPath::DynamicUniformBuffer: {
+			memcpy(objectData + i * objectStride, &constants, sizeof(constants));
+			uint32_t offset = (uint32_t)(i * objectStride);
+			commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout, 1, { dynamicObjectSet }, { offset });
+			break;
+		}
+		case DrawPath::Bindless: {
+			// Tightly packed: the shader reads a std430 array, not one block per draw
+			memcpy(objectData + i * sizeof(constants), &constants, sizeof(constants));
+			BindlessIndices draw = { objectBufferIndex, i };
+			commandBuffer.pushConstants(layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(draw), &draw);
+			break;
+		}
+		}
+		geometry.draw(commandBuffer, demoMesh);
+	}
+}
+
+void UniformBufferWindow::createGeometry()
+{
+	std::vector<Vertex> meshVertices(vertices);
+	std::vector<uint32_t> meshIndices(indices.begin(), indices.end());
+
+	MeshStats before = MeshOptimizer::analyze(meshIndices, (uint32_t)meshVertices.size());
+	MeshOptimizer::optimizeOverdraw(meshIndices, meshVertices);
+	MeshOptimizer::optimizeVertexFetch(meshVertices, meshIndices);
+	MeshStats after = MeshOptimizer::analyze(meshIndices, (uint32_t)meshVertices.size());
+
+	char message[128];
+	snprintf(message, sizeof(message), "mesh: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+		before.acmr, after.acmr, before.atvr, after.atvr);
+	OutputDebugStringA(message);
+
+	uint32_t stride = vertexFormat == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+	geometry.create(device, physicalDevice, stride, 1024, 4096);
+	stagingRing.create(device, physicalDevice, commandPool, graphicsQueue, 8 << 20, 1 << 20);
+	demoMesh = addMesh(meshVertices, meshIndices);
+	geometry.upload(commandPool, graphicsQueue);
+
+	std::string meshPath = commandLineValue("-mesh");
+	if (!meshPath.empty()) {
+		loadMesh(meshPath);
+	}
+}
+
+uint32_t UniformBufferWindow::loadMesh(const std::string& path)
+{
+	MeshFile file;
+	file.open(path);
+
+	uint32_t mesh = geometry.stream(file, stagingRing);
+	stagingRing.flush();
+
+	if (file.header().vertexFormat == (uint32_t)VertexFormat::Packed) {
+		QuantizationBounds bounds;
+		bounds.center = glm::vec2(file.header().boundsCenter[0], file.header().boundsCenter[1]);
+		bounds.extent = glm::vec2(file.header().boundsExtent[0], file.header().boundsExtent[1]);
+		if (meshBounds.size() <= mesh) {
+			meshBounds.resize(mesh + 1);
+		}
+		meshBounds[mesh] = bounds;
+	}
+	return mesh;
+}
+
+uint32_t UniformBufferWindow::addMesh(const std::vector<Vertex>& meshVertices, const std::vector<uint32_t>& meshIndices,
+	IndexCompression compression)
+{
+	if (vertexFormat == VertexFormat::Float) {
+		return geometry.add(meshVertices, meshIndices, compression);
+	}
+
+	QuantizationBounds bounds = VertexQuantizer::bounds(meshVertices);
+	std::vector<PackedVertex> packed;
+	VertexQuantizer::encode(meshVertices, bounds, packed);
+
+	QuantizationReport report = VertexQuantizer::validate(meshVertices, packed, bounds);
+	char message[160];
+	snprintf(message, sizeof(message), "packed vertices: %zu -> %zu bytes, max error position %g color %g\n",
+		report.floatBytes, report.packedBytes, report.maxPositionError, report.maxColorError);
+	OutputDebugStringA(message);
+	if (benchmark.running()) {
+		benchmark.counter("vertex_bytes", (double)report.packedBytes);
+		benchmark.counter("max_position_error", report.maxPositionError);
+	}
+
+	uint32_t mesh = geometry.add(packed, meshIndices, compression);
+	// Applied through the model matrix so the shader sees plain positions
+	if (meshBounds.size() <= mesh) {
+		meshBounds.resize(mesh + 1);
+	}
+	meshBounds[mesh] = bounds;
+	return mesh;
 }
 
 uint32_t UniformBufferWindow::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties)
@@ -875,15 +2115,17 @@ void UniformBufferWindow::createBuffer(
 	vk::DeviceSize size,
 	vk::BufferUsageFlags usage,
 	vk::MemoryPropertyFlags properties,
-	vk::Buffer& buffer,
-	vk::DeviceMemory& bufferMemory)
+	DeviceHandle<vk::Buffer>& buffer,
+	DeviceHandle<vk::DeviceMemory>& bufferMemory,
+	MemoryCategory category,
+	const char* name)
 {
 	vk::BufferCreateInfo bufferInfo = vk::BufferCreateInfo()
 		.setSize(size)
 		.setUsage(usage)
 		.setSharingMode(vk::SharingMode::eExclusive);
 
-	buffer = device.createBuffer(bufferInfo);
+	buffer = makeHandle(device, device.createBuffer(bufferInfo));
 
 	vk::MemoryRequirements memRequirements = device.getBufferMemoryRequirements(buffer);
 
@@ -891,8 +2133,11 @@ void UniformBufferWindow::createBuffer(
 		.setAllocationSize(memRequirements.size)
 		.setMemoryTypeIndex(findMemoryType(memRequirements.memoryTypeBits, properties));
 
-	bufferMemory = device.allocateMemory(allocInfo);
+	bufferMemory = makeHandle(device, MemoryTracker::allocate(device, allocInfo, category, size));
 	device.bindBufferMemory(buffer, bufferMemory, 0);
+
+	DEBUG_NAME(device, buffer, name);
+	DEBUG_NAME(device, bufferMemory, name);
 }
 
 void UniformBufferWindow::copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size)
@@ -906,12 +2151,14 @@ void UniformBufferWindow::copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer,
 	vk::CommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo()
 		.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
 	commandBuffer[0].begin(beginInfo);
+	DEBUG_LABEL_BEGIN(commandBuffer[0], "copy buffer");
 
 	vk::BufferCopy copyRegion = vk::BufferCopy()
 		.setSrcOffset(0)
 		.setDstOffset(0)
 		.setSize(size);
 	commandBuffer[0].copyBuffer(srcBuffer, dstBuffer, { copyRegion });
+	DEBUG_LABEL_END(commandBuffer[0]);
 	commandBuffer[0].end();
 
 	vk::SubmitInfo submitInfo = vk::SubmitInfo()
@@ -922,37 +2169,52 @@ void UniformBufferWindow::copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer,
 	device.freeCommandBuffers(commandPool, commandBuffer);
 }
 
-void UniformBufferWindow::createDescriptorSetLayout()
+void UniformBufferWindow::createPipelineLayout()
 {
-	vk::DescriptorSetLayoutBinding uboLayoutBinding = vk::DescriptorSetLayoutBinding()
-		.setBinding(0)
-		.setDescriptorType(vk::DescriptorType::eUniformBuffer)
-		.setDescriptorCount(1)
-		.setStageFlags(vk::ShaderStageFlagBits::eVertex)
-		.setPImmutableSamplers(nullptr);
-
-	vk::DescriptorSetLayoutCreateInfo layoutInfo = vk::DescriptorSetLayoutCreateInfo()
-		.setBindingCount(1)
-		.setPBindings(&uboLayoutBinding);
-
-	descriptorSetLayout = device.createDescriptorSetLayout(layoutInfo);
-
+	// Derived from the shaders, so layout(binding = ...) in shader.vert is
+	// the only place the interface is written down
+	ShaderLayout interfaceLayout = ShaderReflection::merge(
+		shaders.layout(shaders.load("vert.spv")), shaders.layout(shaders.load("frag.spv")));
+	// A vert.spv built before ObjectConstants moved to push constants would
+	// give a layout every pushConstants call in recordScene violates
+	if (interfaceLayout.pushConstantSize < sizeof(ObjectConstants)) {
+		throw std::runtime_error("vert.spv is older than shader.vert, rebuild the shaders!");
+	}
+	pipelineLayout = layouts.pipelineLayout(interfaceLayout, &descriptorSetLayouts);
 }
 
 void UniformBufferWindow::createUniformBuffer()
 {
+	// One per swap chain image, only ever grown; buffers left over from a
+	// deeper swap chain are kept until cleanup
 	vk::DeviceSize bufferSize = sizeof(UniformBufferObject);
-	uniformBuffers.erase(uniformBuffers.begin(), uniformBuffers.end()));
-	uniformBuffersMemory.erase(uniformBuffersMemory.begin(), uniformBuffersMemory.end());
-
-	for (const auto& swapChainImage : swapChainImages) {
-		vk::Buffer buffer;
-		vk::DeviceMemory memory;
+	while (uniformBuffers.size() < swapChainImages.size()) {
+		DeviceHandle<vk::Buffer> buffer;
+		DeviceHandle<vk::DeviceMemory> memory;
 		createBuffer(bufferSize, vk::BufferUsageFlagBits::eUniformBuffer,
 			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-			buffer, memory);
-		uniformBuffers.push_back(buffer);
-		uniformBuffersMemory.push_back(memory);
+			buffer, memory, MemoryCategory::Uniform, "uniform buffer");
+		uniformBuffers.push_back(std::move(buffer));
+		uniformBuffersMemory.push_back(std::move(memory));
 	}
+}
 
+void UniformBufferWindow::updateUniformBuffer(uint32_t imageIndex)
+{
+	// The demo draws straight into clip space; per-object placement is in ObjectConstants
+	UniformBufferObject ubo = { glm::mat4(1.0f), glm::mat4(1.0f) };
+
+	void* data = device.mapMemory(uniformBuffersMemory[imageIndex], 0, sizeof(ubo));
+	memcpy(data, &ubo, sizeof(ubo));
+	device.unmapMemory(uniformBuffersMemory[imageIndex]);
+}
+
+void UniformBufferWindow::createDescriptorSets()
+{
+	descriptorSets.clear();
+	for (const auto& buffer : uniformBuffers) {
+		descriptorSets.push_back(descriptorCache.get(descriptorSetLayouts[0], {
+			DescriptorBinding::forBuffer(0, vk::DescriptorType::eUniformBuffer, buffer, 0, sizeof(UniformBufferObject))
+		}));
+	}
 }
\ No newline at end of file
@@ -5,33 +5,33 @@
 
 #include <vulkan\vulkan.hpp>
 #include <glm\glm.hpp>
-
-struct Vertex {
-	glm::vec2 pos;
-	glm::vec3 color;
-
-	static inline vk::VertexInputBindingDescription getBindingDescription() {
-		vk::VertexInputBindingDescription bindingDescription = vk::VertexInputBindingDescription()
-			.setBinding(0)
-			.setStride(sizeof(Vertex))
-			.setInputRate(vk::VertexInputRate::eVertex);
-
-		return bindingDescription;
-	}
-
-	static inline std::array<vk::VertexInputAttributeDescription, 2> getAttributeDescriptions() {
-		std::array<vk::VertexInputAttributeDescription, 2> attributeDescriptions;
-		attributeDescriptions[0].setBinding(0)
-			.setLocation(0)
-			.setFormat(vk::Format::eR32G32Sfloat)
-			.setOffset(offsetof(Vertex, pos));
-		attributeDescriptions[1].setBinding(0)
-			.setLocation(1)
-			.setFormat(vk::Format::eR32G32B32Sfloat)
-			.setOffset(offsetof(Vertex, pos));
-		return attributeDescriptions;
-	}
-};
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#include "Vertex.h"
+#include "GeometryPool.h"
+#include "StagingRing.h"
+#include "ShaderCache.h"
+#include "ShaderWatcher.h"
+#include "LayoutCache.h"
+#include "DescriptorCache.h"
+#include "BindlessTable.h"
+#include "RenderGraph.h"
+#include "SpscQueue.h"
+#include "Handle.h"
+#include "MemoryTracker.h"
+#include "DebugMessenger.h"
+#include "DebugUtils.h"
+#include "FramePacer.h"
+#include "FrameCapture.h"
+#include "FrameStream.h"
+#include "ImageCompare.h"
+#include "VertexQuantizer.h"
+#include "Benchmark.h"
+#include "StartupTimeline.h"
 
 struct QueueFamilyIndices {
 	int graphicsFamily = -1;
@@ -48,19 +48,75 @@ struct SwapChainSupportDetails {
 	std::vector<vk::PresentModeKHR> presentModes;
 };
 
+// Which surface formats and color spaces the swap chain tries first
+enum class SurfacePreference {
+	Unorm,	// 8-bit, written as is
+	Srgb,	// 8-bit, encoded to sRGB on write
+	Hdr10,	// 10-bit, ST.2084 (PQ); needs VK_EXT_swapchain_colorspace
+	ScRgb	// 16-bit float, extended linear sRGB; needs VK_EXT_swapchain_colorspace
+};
+
+// Applied on every swap chain (re)creation; unsupported choices fall back
+struct SwapChainConfig {
+	uint32_t imageCount;	// 0 for one more than the surface minimum
+	std::vector<vk::PresentModeKHR> presentModes;	// in order of preference; empty leaves it to the pacer
+	SurfacePreference surface;
+};
+
+// Per-frame data, set 0 binding 0
 struct UniformBufferObject {
-	glm::mat4 model;
 	glm::mat4 view;
 	glm::mat4 proj;
 };
 
+// Per-draw data, pushed as constants; matches the push_constant block in shader.vert
+struct ObjectConstants {
+	glm::mat4 model;
+	glm::vec4 tint;
+};
+
+// How the per-draw benchmark scene delivers ObjectConstants to the shader
+enum class DrawPath {
+	PushConstants,
+	UniformBuffer,	// one descriptor set per draw
+	DynamicUniformBuffer,	// one descriptor set, a dynamic offset per draw
+	TransientUniformBuffer,	// a set allocated and written per draw, every frame
+	Bindless	// one storage buffer in the bindless table, an index pushed per draw
+};
+
+// Per-draw data for DrawPath::Bindless; matches the push_constant block in shader_bindless.vert
+struct BindlessIndices {
+	uint32_t buffer;
+	uint32_t object;
+};
+
+// A window message handed from the message loop to the render thread
+struct RenderEvent {
+	UINT message;
+	WPARAM wParam;
+	LPARAM lParam;
+};
+
 class UniformBufferWindow :
 	public Window
 {
 private:
+	// Begins as the window object is constructed; the first present ends it
+	StartupTimeline startup;
+
+	// Owns the device and runs the frame loop; the thread pumping messages
+	// never waits on the GPU and rendering never waits on messages. It is
+	// started before the window exists and waits on windowCreated only
+	// once it needs a surface.
+	std::thread renderThread;
+	std::promise<void> windowCreated;
+	std::shared_future<void> windowReady;
+	SpscQueue<RenderEvent, 256> renderEvents;
+
 	vk::Instance instance;
 
-	VkDebugReportCallbackEXT callback;
+	// Validation messages, filtered and rate limited off the calling thread
+	DebugMessenger debugMessenger;
 
 	vk::PhysicalDevice physicalDevice;
 	vk::Device device;
@@ -70,54 +126,186 @@ private:
 
 	vk::SurfaceKHR surface;
 
-	vk::SwapchainKHR swapChain;
+	// Picks the present mode and paces drawFrame; render thread only
+	FramePacer pacer;
+
+	// -swapchain-images N, -present-mode fifo|fifo-relaxed|mailbox|immediate,
+	// -surface-format unorm|srgb|hdr10|scrgb
+	SwapChainConfig swapChainConfig;
+	bool colorSpaceExtension;
+	uint32_t instanceVersion;	// the apiVersion the instance was created with
+	// VK_EXT_memory_budget needs vkGetPhysicalDeviceMemoryProperties2
+	bool properties2Extension;
+	bool memoryBudgetExtension;
+	// -leak-check: logs what is still alive after every swap chain rebuild,
+	// which should not grow, and at shutdown, which should be nothing
+	bool leakCheck;
+
+	DeviceHandle<vk::SwapchainKHR> swapChain;
 	std::vector<vk::Image> swapChainImages;
 	vk::Format swapChainImageFormat;
 	vk::Extent2D swapChainExtent;
 
-	std::vector<vk::ImageView> swapChainImageViews;
+	std::vector<DeviceHandle<vk::ImageView>> swapChainImageViews;
 
-	vk::RenderPass renderPass;
-	vk::DescriptorSetLayout descriptorSetLayout;
-	vk::PipelineLayout pipelineLayout;
-	vk::Pipeline graphicsPipeline;
-
-	std::vector<vk::Framebuffer> swapChainFramebuffers;
+	// -msaa 2|4|8: the pass renders into colorResource and resolves into the
+	// swap chain image at its end
+	vk::SampleCountFlagBits msaaSamples;
+	vk::Format depthFormat;
 
-	vk::CommandPool commandPool;
+	DeviceHandle<vk::RenderPass> renderPass;
+	// Both owned by layouts, shared by every pipeline with this interface
+	std::vector<vk::DescriptorSetLayout> descriptorSetLayouts;
+	vk::PipelineLayout pipelineLayout;
+	DeviceHandle<vk::Pipeline> graphicsPipeline;
+	// -depth-prepass: everything is drawn first with depthPrepassPipeline,
+	// which has no fragment shader, so graphicsPipeline shades each pixel
+	// once. Its depth test is less-or-equal so it passes only where the
+	// prepass left the nearest surface.
+	bool depthPrepass;
+	DeviceHandle<vk::Pipeline> depthPrepassPipeline;
+	DeviceHandle<vk::PipelineCache> pipelineCache;
+	ShaderCache shaders;
+	LayoutCache layouts;
+
+	// -hot-reload: pipelines rebuilt on the watcher thread wait in
+	// pendingPipeline until drawFrame swaps them in between frames
+	ShaderWatcher shaderWatcher;
+	std::mutex pipelineMutex;
+	DeviceHandle<vk::Pipeline> pendingPipeline;
+	DeviceHandle<vk::Pipeline> pendingPrepassPipeline;
+	std::atomic<bool> pipelineReady;
+
+	std::vector<DeviceHandle<vk::Framebuffer>> swapChainFramebuffers;
+
+	// Orders the frame's passes and owns the barriers between them; the
+	// swap chain image is bound to swapChainResource per command buffer.
+	// The depth and multisampled colour attachments are transients of the
+	// graph, recreated with the swap chain; colorResource is
+	// RenderGraph::NONE without MSAA.
+	RenderGraph frameGraph;
+	RenderGraph::Resource swapChainResource;
+	RenderGraph::Resource depthResource;
+	RenderGraph::Resource colorResource;
+	uint32_t scenePass;
+
+	DeviceHandle<vk::CommandPool> commandPool;
 	std::vector<vk::CommandBuffer> commandBuffers;
-
-	std::vector<vk::Semaphore> imageAvailableSemaphores;
-	std::vector<vk::Semaphore> renderFinishedSemaphores;
-	std::vector<vk::Fence> inFlightFences;
+	// Recorded with pipelines that have since been swapped out; drawFrame
+	// records each again once the last frame drawn to its image is done
+	std::vector<bool> staleCommandBuffers;
+
+	std::vector<DeviceHandle<vk::Semaphore>> imageAvailableSemaphores;
+	std::vector<DeviceHandle<vk::Semaphore>> renderFinishedSemaphores;
+	std::vector<DeviceHandle<vk::Fence>> inFlightFences;
+	std::vector<vk::Fence> imagesInFlight;	// per image, the fence of the frame last drawn to it
+	// Handles replaced mid-run, kept until the frames that used them are done
+	DeferredRelease retired;
 	size_t currentFrame;
-
-	vk::Buffer vertexBuffer;
-	vk::DeviceMemory vertexBufferMemory;
-
-	vk::Buffer indexBuffer;
-	vk::DeviceMemory indexBufferMemory;
-
-	std::vector<vk::Buffer> uniformBuffers;
-	std::vector<vk::DeviceMemory> uniformBuffersMemory;
+	uint64_t frameNumber;
+
+	// -capture out.png|out.ppm [-capture-frame N]: saves frame N (default
+	// CAPTURE_FRAME). With -golden image it is then compared against the
+	// golden image and the application exits with 0 on a match, 1 otherwise.
+	FrameCapture frameCapture;
+	bool swapChainCapturable;	// created with transfer source usage
+	// Every frame read back for a consumer other than the display; only
+	// started by the readback-stream benchmark. streamTotals holds its
+	// streamed, dropped and skipped counts as of the previous frame.
+	FrameStream frameStream;
+	uint64_t streamTotals[3];
+	// The graph's readback pass records the copies due only while drawFrame
+	// records the frame they are due in; readbackRecorded says which
+	// command buffers hold one, to be recorded again without it
+	bool readbackFrame;
+	std::vector<bool> readbackRecorded;
+	std::string goldenPath;
+	CompareTolerance goldenTolerance;
+
+	VertexFormat vertexFormat;
+	GeometryPool geometry;
+	StagingRing stagingRing;
+	std::vector<QuantizationBounds> meshBounds;
+
+	Benchmark benchmark;
+	uint32_t benchmarkMesh;
+	// Counts fragment shader invocations while the benchmark scene is
+	// drawn, one query per frame in flight; null when the device lacks
+	// pipelineStatisticsQuery. statisticsPending says which frames wrote
+	// theirs, to be read once the frame's fence has signalled.
+	DeviceHandle<vk::QueryPool> statisticsPool;
+	std::vector<bool> statisticsPending;
+
+	std::vector<DeviceHandle<vk::Buffer>> uniformBuffers;
+	std::vector<DeviceHandle<vk::DeviceMemory>> uniformBuffersMemory;
+	// Long-lived sets come from the cache; sets that only live for one
+	// frame come from that frame's allocator, reset once its fence signals
+	DescriptorCache descriptorCache;
+	std::vector<DescriptorAllocator> frameDescriptors;
+	std::vector<vk::DescriptorSet> descriptorSets;
+	uint32_t demoMesh;
+
+	// -bindless: VK_EXT_descriptor_indexing is enabled and resources are
+	// also reachable by index through bindlessTable. Cleared when the
+	// device lacks support.
+	bool bindless;
+	BindlessTable bindlessTable;
+
+	// Per-draw benchmark scene: objectCount copies of the demo mesh, each
+	// with its own transform, re-recorded every frame. 0 outside the scene.
+	DrawPath drawPath;
+	uint32_t objectCount;
+	// Copies stacked on each grid cell, drawn back to front
+	uint32_t objectLayers;
+	std::chrono::steady_clock::time_point objectStart;
+	DeviceHandle<vk::Buffer> objectBuffer;
+	DeviceHandle<vk::DeviceMemory> objectBufferMemory;
+	char* objectData;
+	vk::DeviceSize objectStride;
+	vk::DescriptorSetLayout objectSetLayout;
+	std::vector<vk::DescriptorSet> objectSets;
+	vk::DescriptorSet dynamicObjectSet;
+	vk::PipelineLayout uniformObjectLayout;
+	vk::PipelineLayout dynamicObjectLayout;
+	DeviceHandle<vk::Pipeline> uniformObjectPipeline;
+	DeviceHandle<vk::Pipeline> dynamicObjectPipeline;
+	uint32_t objectBufferIndex;
+	vk::PipelineLayout bindlessObjectLayout;
+	DeviceHandle<vk::Pipeline> bindlessObjectPipeline;
+
+	static const uint32_t MAX_OBJECTS;
+	static const uint32_t OVERDRAW_LAYERS;
+	static const uint64_t CAPTURE_FRAME;
 
 	static const int MAX_FRAMES_IN_FLIGHT;
 	static const std::vector<Vertex> vertices;
 	static const std::vector<uint16_t> indices;
 protected:
+	void postRenderEvent(const RenderEvent& event);
+	// Reports anything runRenderer throws and closes the window
+	void renderLoop();
+	void runRenderer();
+	// False when the window will never exist
+	bool waitForWindow();
 	void initVulkan();
+	void cleanupVulkan();
 	void createInstance();
 	bool checkValidationLayerSupport();
 	std::vector<const char*> getRequiredExtensions();
 	void setupDebugCallback();
-	void pickPhysicalDevice();
+	// Devices with the required extensions; needs no surface
+	std::vector<vk::PhysicalDevice> enumerateDevices() const;
+	void pickPhysicalDevice(const std::vector<vk::PhysicalDevice>& candidates);
+	vk::SampleCountFlagBits chooseSampleCount() const;
 	bool isDeviceSuitable(const vk::PhysicalDevice& device) const;
 	bool checkDeviceExtensionSupport(vk::PhysicalDevice device) const;
-	vk::PhysicalDevice optimalDevice() const;
+	vk::PhysicalDevice optimalDevice(const std::vector<vk::PhysicalDevice>& candidates) const;
 
 	QueueFamilyIndices findQueueFamilies(const vk::PhysicalDevice& device) const;
 
 	void createLogicalDevice();
+	// -memory-budget MB, -memory-log seconds
+	void trackMemory();
 
 	void createSurface();
 
@@ -127,19 +315,48 @@ protected:
 	vk::PresentModeKHR chooseSwapPresentMode(const std::vector<vk::PresentModeKHR>& availablePresentModes) const;
 	vk::Extent2D chooseSwapExtent(const vk::SurfaceCapabilitiesKHR& capabilities) const;
 	void createSwapChain();
+	// Recreates the swap chain, handing the current one over as oldSwapchain
+	void configureSwapChain(const SwapChainConfig& config);
 	void createImageViews();
+	vk::Format findSupportedFormat(const std::vector<vk::Format>& candidates, vk::ImageTiling tiling,
+		vk::FormatFeatureFlags features) const;
 	void createRenderPass();
 	void createGraphicsPipeline();
-	vk::ShaderModule createShaderModule(const std::vector<char>& code);
+	// A null fragment module builds a depth-only pipeline; name is what
+	// debuggers and profilers show for it
+	DeviceHandle<vk::Pipeline> buildGraphicsPipeline(vk::ShaderModule vertShaderModule, vk::ShaderModule fragShaderModule,
+		vk::PipelineLayout layout, const char* name);
+	void reloadShaders(const std::vector<std::string>& outputs);
+	void swapPendingPipeline();
 
 	void createFramebuffers();
 	void createCommandPool();
-	void createVertexBuffers();
-	void createIndexBuffers();
+	void createGeometry();
+	uint32_t loadMesh(const std::string& path);
+	uint32_t addMesh(const std::vector<Vertex>& meshVertices, const std::vector<uint32_t>& meshIndices,
+		IndexCompression compression = IndexCompression::Auto);
 	void createUniformBuffer();
+	void updateUniformBuffer(uint32_t imageIndex);
+	void createDescriptorSets();
 	void createCommandBuffers();
+	void recordCommandBuffer(uint32_t imageIndex);
+	void createRenderGraph();
+	void recordScene(vk::CommandBuffer commandBuffer, uint32_t imageIndex);
+	void recordReadback(vk::CommandBuffer commandBuffer, uint32_t imageIndex);
+	glm::mat4 meshTransform(uint32_t mesh) const;
+	void createObjectResources();
+	void createObjectPipelines();
+	void destroyObjectResources();
+	void recordObjects(vk::CommandBuffer commandBuffer, uint32_t imageIndex);
+	void rebuildCommandBuffers();
+	void createBenchmarks();
+	void compareCapture(const std::string& path, const RgbImage& image);
+	void startFrameStream(FrameStream::Consumer consumer);
 	void createSyncObjects();
-	void createDescriptorSetLayout();
+	// Hands every frame whose fence has signalled to the pacer
+	void pollFrameFences();
+	void createQueryPool();
+	void createPipelineLayout();
 
 	void recreateSwapChain();
 	void cleanupSwapChain();
@@ -150,8 +367,10 @@ protected:
 		vk::DeviceSize size,
 		vk::BufferUsageFlags usage,
 		vk::MemoryPropertyFlags properties,
-		vk::Buffer& buffer,
-		vk::DeviceMemory& bufferMemory);
+		DeviceHandle<vk::Buffer>& buffer,
+		DeviceHandle<vk::DeviceMemory>& bufferMemory,
+		MemoryCategory category,
+		const char* name);
 	void copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::DeviceSize size);
 
 public:
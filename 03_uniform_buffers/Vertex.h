@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vulkan\vulkan.hpp>
+#include <glm\glm.hpp>
+#include <array>
+
+struct Vertex {
+	glm::vec2 pos;
+	glm::vec3 color;
+
+	static inline vk::VertexInputBindingDescription getBindingDescription() {
+		vk::VertexInputBindingDescription bindingDescription = vk::VertexInputBindingDescription()
+			.setBinding(0)
+			.setStride(sizeof(Vertex))
+			.setInputRate(vk::VertexInputRate::eVertex);
+
+		return bindingDescription;
+	}
+
+	static inline std::array<vk::VertexInputAttributeDescription, 2> getAttributeDescriptions() {
+		std::array<vk::VertexInputAttributeDescription, 2> attributeDescriptions;
+		attributeDescriptions[0].setBinding(0)
+			.setLocation(0)
+			.setFormat(vk::Format::eR32G32Sfloat)
+			.setOffset(offsetof(Vertex, pos));
+		attributeDescriptions[1].setBinding(0)
+			.setLocation(1)
+			.setFormat(vk::Format::eR32G32B32Sfloat)
+			.setOffset(offsetof(Vertex, color));
+		return attributeDescriptions;
+	}
+};
+
+// 8 byte encoding of Vertex. Positions are snorm16 relative to the mesh
+// bounds (see QuantizationBounds), colors are unorm8 with alpha.
+struct PackedVertex {
+	int16_t pos[2];
+	uint8_t color[4];
+
+	static inline vk::VertexInputBindingDescription getBindingDescription() {
+		vk::VertexInputBindingDescription bindingDescription = vk::VertexInputBindingDescription()
+			.setBinding(0)
+			.setStride(sizeof(PackedVertex))
+			.setInputRate(vk::VertexInputRate::eVertex);
+
+		return bindingDescription;
+	}
+
+	static inline std::array<vk::VertexInputAttributeDescription, 2> getAttributeDescriptions() {
+		std::array<vk::VertexInputAttributeDescription, 2> attributeDescriptions;
+		attributeDescriptions[0].setBinding(0)
+			.setLocation(0)
+			.setFormat(vk::Format::eR16G16Snorm)
+			.setOffset(offsetof(PackedVertex, pos));
+		attributeDescriptions[1].setBinding(0)
+			.setLocation(1)
+			.setFormat(vk::Format::eR8G8B8A8Unorm)
+			.setOffset(offsetof(PackedVertex, color));
+		return attributeDescriptions;
+	}
+};
+
+enum class VertexFormat {
+	Float,
+	Packed
+};
@@ -0,0 +1,129 @@
+#include "VertexQuantizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define QUANTIZE_SSE2
+#endif
+
+glm::mat4 QuantizationBounds::transform() const
+{
+	glm::mat4 matrix(1.0f);
+	matrix[0][0] = extent.x;
+	matrix[1][1] = extent.y;
+	matrix[3][0] = center.x;
+	matrix[3][1] = center.y;
+	return matrix;
+}
+
+QuantizationBounds VertexQuantizer::bounds(const std::vector<Vertex>& vertices)
+{
+	if (vertices.empty()) {
+		return { glm::vec2(0.0f), glm::vec2(1.0f) };
+	}
+
+	glm::vec2 lo = vertices[0].pos;
+	glm::vec2 hi = vertices[0].pos;
+	for (const auto& vertex : vertices) {
+		lo = glm::min(lo, vertex.pos);
+		hi = glm::max(hi, vertex.pos);
+	}
+
+	QuantizationBounds result;
+	result.center = (lo + hi) * 0.5f;
+	result.extent = (hi - lo) * 0.5f;
+	// A flat axis still needs a non-zero scale to divide by
+	if (result.extent.x <= 0.0f) result.extent.x = 1.0f;
+	if (result.extent.y <= 0.0f) result.extent.y = 1.0f;
+	return result;
+}
+
+void VertexQuantizer::encode(const std::vector<Vertex>& vertices, const QuantizationBounds& bounds, std::vector<PackedVertex>& packed)
+{
+	packed.resize(vertices.size());
+	size_t i = 0;
+
+#ifdef QUANTIZE_SSE2
+	const __m128 center = _mm_setr_ps(bounds.center.x, bounds.center.y, bounds.center.x, bounds.center.y);
+	const __m128 scale = _mm_setr_ps(32767.0f / bounds.extent.x, 32767.0f / bounds.extent.y,
+		32767.0f / bounds.extent.x, 32767.0f / bounds.extent.y);
+	const __m128 snormMin = _mm_set1_ps(-32767.0f);
+	const __m128 snormMax = _mm_set1_ps(32767.0f);
+	const __m128 unormScale = _mm_set1_ps(255.0f);
+	const __m128 zero = _mm_setzero_ps();
+
+	// Two vertices per iteration: both positions share one register, colors
+	// go through one register each. Conversion rounds to nearest and the
+	// packs saturate, matching the scalar path below.
+	for (; i + 2 <= vertices.size(); i += 2) {
+		const Vertex& v0 = vertices[i];
+		const Vertex& v1 = vertices[i + 1];
+
+		__m128 pos = _mm_setr_ps(v0.pos.x, v0.pos.y, v1.pos.x, v1.pos.y);
+		pos = _mm_mul_ps(_mm_sub_ps(pos, center), scale);
+		pos = _mm_min_ps(_mm_max_ps(pos, snormMin), snormMax);
+		__m128i pos16 = _mm_packs_epi32(_mm_cvtps_epi32(pos), _mm_setzero_si128());
+		int16_t positions[8];
+		_mm_storeu_si128((__m128i*)positions, pos16);
+		memcpy(packed[i].pos, positions, sizeof(int16_t) * 2);
+		memcpy(packed[i + 1].pos, positions + 2, sizeof(int16_t) * 2);
+
+		__m128 c0 = _mm_mul_ps(_mm_setr_ps(v0.color.r, v0.color.g, v0.color.b, 1.0f), unormScale);
+		__m128 c1 = _mm_mul_ps(_mm_setr_ps(v1.color.r, v1.color.g, v1.color.b, 1.0f), unormScale);
+		c0 = _mm_min_ps(_mm_max_ps(c0, zero), unormScale);
+		c1 = _mm_min_ps(_mm_max_ps(c1, zero), unormScale);
+		__m128i c16 = _mm_packs_epi32(_mm_cvtps_epi32(c0), _mm_cvtps_epi32(c1));
+		__m128i c8 = _mm_packus_epi16(c16, c16);
+		int colors[4];
+		_mm_storeu_si128((__m128i*)colors, c8);
+		memcpy(packed[i].color, &colors[0], 4);
+		memcpy(packed[i + 1].color, &colors[1], 4);
+	}
+#endif
+
+	for (; i < vertices.size(); i++) {
+		const Vertex& vertex = vertices[i];
+		for (int c = 0; c < 2; c++) {
+			float value = (vertex.pos[c] - bounds.center[c]) / bounds.extent[c];
+			value = std::min(std::max(value, -1.0f), 1.0f);
+			packed[i].pos[c] = (int16_t)std::lrint(value * 32767.0f);
+		}
+		for (int c = 0; c < 3; c++) {
+			float value = std::min(std::max(vertex.color[c], 0.0f), 1.0f);
+			packed[i].color[c] = (uint8_t)std::lrint(value * 255.0f);
+		}
+		packed[i].color[3] = 255;
+	}
+}
+
+Vertex VertexQuantizer::decode(const PackedVertex& packed, const QuantizationBounds& bounds)
+{
+	Vertex vertex;
+	for (int c = 0; c < 2; c++) {
+		float value = std::max(packed.pos[c] / 32767.0f, -1.0f);
+		vertex.pos[c] = bounds.center[c] + bounds.extent[c] * value;
+	}
+	for (int c = 0; c < 3; c++) {
+		vertex.color[c] = packed.color[c] / 255.0f;
+	}
+	return vertex;
+}
+
+QuantizationReport VertexQuantizer::validate(const std::vector<Vertex>& vertices, const std::vector<PackedVertex>& packed,
+	const QuantizationBounds& bounds)
+{
+	QuantizationReport report = { 0.0f, 0.0f, sizeof(Vertex) * vertices.size(), sizeof(PackedVertex) * packed.size() };
+	for (size_t i = 0; i < vertices.size() && i < packed.size(); i++) {
+		Vertex decoded = decode(packed[i], bounds);
+		for (int c = 0; c < 2; c++) {
+			report.maxPositionError = std::max(report.maxPositionError, std::fabs(decoded.pos[c] - vertices[i].pos[c]));
+		}
+		for (int c = 0; c < 3; c++) {
+			report.maxColorError = std::max(report.maxColorError, std::fabs(decoded.color[c] - vertices[i].color[c]));
+		}
+	}
+	return report;
+}
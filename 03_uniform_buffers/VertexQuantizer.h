@@ -0,0 +1,34 @@
+#pragma once
+
+#include <glm\glm.hpp>
+#include <vector>
+
+#include "Vertex.h"
+
+// Decoded position = center + extent * snorm16 value
+struct QuantizationBounds {
+	glm::vec2 center;
+	glm::vec2 extent;
+
+	// Folded into the model matrix so the vertex shader needs no extra input
+	glm::mat4 transform() const;
+};
+
+struct QuantizationReport {
+	float maxPositionError;
+	float maxColorError;
+	size_t floatBytes;
+	size_t packedBytes;
+};
+
+class VertexQuantizer
+{
+public:
+	static QuantizationBounds bounds(const std::vector<Vertex>& vertices);
+	static void encode(const std::vector<Vertex>& vertices, const QuantizationBounds& bounds, std::vector<PackedVertex>& packed);
+	static Vertex decode(const PackedVertex& packed, const QuantizationBounds& bounds);
+
+	// Decodes every packed vertex and compares it with the float source
+	static QuantizationReport validate(const std::vector<Vertex>& vertices, const std::vector<PackedVertex>& packed,
+		const QuantizationBounds& bounds);
+};
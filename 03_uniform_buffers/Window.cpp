@@ -59,7 +59,8 @@ void Window::Create()
 		CW_USEDEFAULT, CW_USEDEFAULT,
 		nullptr, nullptr, GetModuleHandle(nullptr), this);
 
-	observe(WM_CLOSE, [](WPARAM, LPARAM) {PostQuitMessage(0); });
+	// A WM_CLOSE posted with a non-zero wParam makes that the exit code
+	observe(WM_CLOSE, [](WPARAM wParam, LPARAM) {PostQuitMessage((int)wParam); });
 }
 
 void Window::Update()
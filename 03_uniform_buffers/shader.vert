@@ -1,14 +1,21 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+// Per-frame data, written once per frame
 layout(binding = 0) uniform UniformBufferObject {
-	mat4 model;
 	mat4 view;
 	mat4 proj;
 } ubo;
 
+// Per-draw data travels in the command buffer, no descriptor update needed
+layout(push_constant) uniform ObjectConstants {
+	mat4 model;
+	vec4 tint;
+} object;
+
 layout(location = 0) in vec2 inPosition;
-layout(location = 1) in vec3 inColor;
+// Float and packed (unorm8 RGBA) colors both arrive here; a missing alpha reads as 1
+layout(location = 1) in vec4 inColor;
 
 layout(location = 0) out vec3 fragColor;
 
@@ -17,6 +24,6 @@ out gl_PerVertex {
 };
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 0.0, 1.0);
-    fragColor = inColor;
+    gl_Position = ubo.proj * ubo.view * object.model * vec4(inPosition, 0.0, 1.0);
+    fragColor = inColor.rgb * object.tint.rgb;
 }
\ No newline at end of file
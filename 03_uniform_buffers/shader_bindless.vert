@@ -0,0 +1,41 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+
+// shader.vert for -bindless: per-draw data lives in a storage buffer in the
+// bindless table and the push constants only say where to find it
+
+layout(binding = 0) uniform UniformBufferObject {
+	mat4 view;
+	mat4 proj;
+} ubo;
+
+struct ObjectConstants {
+	mat4 model;
+	vec4 tint;
+};
+
+// Every buffer in the table, see BindlessTable
+layout(set = 1, binding = 0) readonly buffer ObjectBuffer {
+	ObjectConstants objects[];
+} buffers[];
+
+layout(push_constant) uniform BindlessIndices {
+	uint buffer;
+	uint object;
+} draw;
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec4 inColor;
+
+layout(location = 0) out vec3 fragColor;
+
+out gl_PerVertex {
+    vec4 gl_Position;
+};
+
+void main() {
+    ObjectConstants object = buffers[draw.buffer].objects[draw.object];
+    gl_Position = ubo.proj * ubo.view * object.model * vec4(inPosition, 0.0, 1.0);
+    fragColor = inColor.rgb * object.tint.rgb;
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// shader.vert with per-draw data read from a uniform buffer instead of push
+// constants; only used to benchmark the two paths against each other
+
+layout(binding = 0) uniform UniformBufferObject {
+	mat4 view;
+	mat4 proj;
+} ubo;
+
+layout(set = 1, binding = 0) uniform ObjectConstants {
+	mat4 model;
+	vec4 tint;
+} object;
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec4 inColor;
+
+layout(location = 0) out vec3 fragColor;
+
+out gl_PerVertex {
+    vec4 gl_Position;
+};
+
+void main() {
+    gl_Position = ubo.proj * ubo.view * object.model * vec4(inPosition, 0.0, 1.0);
+    fragColor = inColor.rgb * object.tint.rgb;
+}
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include "GltfImporter.h"
+#include "Json.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+static std::vector<char> readBinary(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open " + path);
+	}
+	return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+std::vector<char> GltfImporter::decodeBase64(const std::string& text)
+{
+	static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	std::vector<char> result;
+	uint32_t bits = 0;
+	int count = 0;
+	for (char c : text) {
+		const char* position = strchr(alphabet, c);
+		if (c == '\0' || position == nullptr) {
+			continue;
+		}
+		bits = (bits << 6) | (uint32_t)(position - alphabet);
+		count += 6;
+		if (count >= 8) {
+			count -= 8;
+			result.push_back((char)((bits >> count) & 0xFF));
+		}
+	}
+	return result;
+}
+
+float GltfImporter::component(const char* data, int componentType, bool normalized)
+{
+	switch (componentType) {
+	case 5120: { int8_t v; memcpy(&v, data, 1); return normalized ? std::max(v / 127.0f, -1.0f) : v; }
+	case 5121: { uint8_t v; memcpy(&v, data, 1); return normalized ? v / 255.0f : v; }
+	case 5122: { int16_t v; memcpy(&v, data, 2); return normalized ? std::max(v / 32767.0f, -1.0f) : v; }
+	case 5123: { uint16_t v; memcpy(&v, data, 2); return normalized ? v / 65535.0f : v; }
+	case 5125: { uint32_t v; memcpy(&v, data, 4); return (float)v; }
+	case 5126: { float v; memcpy(&v, data, 4); return v; }
+	}
+	throw std::runtime_error("unsupported glTF component type");
+}
+
+static uint32_t componentSize(int componentType)
+{
+	switch (componentType) {
+	case 5120: case 5121: return 1;
+	case 5122: case 5123: return 2;
+	case 5125: case 5126: return 4;
+	}
+	throw std::runtime_error("unsupported glTF component type");
+}
+
+std::vector<char> GltfImporter::readAccessor(const Json& document, const std::vector<std::vector<char>>& buffers,
+	int accessor, uint32_t& count, uint32_t& components, int& componentType, bool& normalized)
+{
+	const Json& info = document["accessors"][accessor];
+	const std::string& type = info["type"].asString();
+	components = type == "SCALAR" ? 1 : type == "VEC2" ? 2 : type == "VEC3" ? 3 : type == "VEC4" ? 4 : 0;
+	if (components == 0) {
+		throw std::runtime_error("unsupported glTF accessor type " + type);
+	}
+	count = (uint32_t)info["count"].asInt();
+	componentType = info["componentType"].asInt();
+	normalized = info["normalized"].asBool(false);
+
+	uint32_t elementSize = components * componentSize(componentType);
+	std::vector<char> result((size_t)count * elementSize, 0);
+	if (!info.has("bufferView")) {
+		// Sparse-only or zero-initialized accessor
+		return result;
+	}
+
+	const Json& view = document["bufferViews"][info["bufferView"].asInt()];
+	const std::vector<char>& buffer = buffers.at(view["buffer"].asInt());
+	size_t offset = (size_t)view["byteOffset"].asNumber() + (size_t)info["byteOffset"].asNumber();
+	size_t stride = view.has("byteStride") ? (size_t)view["byteStride"].asNumber() : elementSize;
+	if (count > 0 && offset + stride * (count - 1) + elementSize > buffer.size()) {
+		throw std::runtime_error("glTF accessor runs past the end of its buffer");
+	}
+	for (uint32_t i = 0; i < count; i++) {
+		memcpy(result.data() + (size_t)i * elementSize, buffer.data() + offset + stride * i, elementSize);
+	}
+	return result;
+}
+
+void GltfImporter::load(const std::string& path, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::vector<char> bytes = readBinary(path);
+	std::string text;
+	std::vector<char> binaryChunk;
+
+	if (bytes.size() >= 12 && memcmp(bytes.data(), "glTF", 4) == 0) {
+		size_t offset = 12;
+		while (offset + 8 <= bytes.size()) {
+			uint32_t length, type;
+			memcpy(&length, bytes.data() + offset, 4);
+			memcpy(&type, bytes.data() + offset + 4, 4);
+			offset += 8;
+			if (offset + length > bytes.size()) {
+				throw std::runtime_error("truncated glb chunk in " + path);
+			}
+			if (type == 0x4E4F534A) {
+				text.assign(bytes.data() + offset, length);
+			}
+			else if (type == 0x004E4942) {
+				binaryChunk.assign(bytes.data() + offset, bytes.data() + offset + length);
+			}
+			offset += length;
+		}
+	}
+	else {
+		text.assign(bytes.begin(), bytes.end());
+	}
+
+	Json document = Json::parse(text);
+
+	std::string directory;
+	size_t slash = path.find_last_of("/\\");
+	if (slash != std::string::npos) {
+		directory = path.substr(0, slash + 1);
+	}
+
+	std::vector<std::vector<char>> buffers;
+	for (size_t i = 0; i < document["buffers"].size(); i++) {
+		const std::string& uri = document["buffers"][i]["uri"].asString();
+		if (uri.empty()) {
+			buffers.push_back(binaryChunk);
+		}
+		else if (uri.compare(0, 5, "data:") == 0) {
+			buffers.push_back(decodeBase64(uri.substr(uri.find(',') + 1)));
+		}
+		else {
+			buffers.push_back(readBinary(directory + uri));
+		}
+	}
+
+	vertices.clear();
+	indices.clear();
+	for (size_t m = 0; m < document["meshes"].size(); m++) {
+		const Json& primitives = document["meshes"][m]["primitives"];
+		for (size_t p = 0; p < primitives.size(); p++) {
+			const Json& primitive = primitives[p];
+			if (primitive["mode"].asInt(4) != 4 || !primitive["attributes"].has("POSITION")) {
+				continue;
+			}
+			uint32_t base = (uint32_t)vertices.size();
+
+			uint32_t count, components;
+			int componentType;
+			bool normalized;
+			std::vector<char> positions = readAccessor(document, buffers, primitive["attributes"]["POSITION"].asInt(),
+				count, components, componentType, normalized);
+			uint32_t positionSize = components * componentSize(componentType);
+			uint32_t positionComponent = componentSize(componentType);
+			for (uint32_t i = 0; i < count; i++) {
+				const char* element = positions.data() + (size_t)i * positionSize;
+				// The sample's vertex layout is 2D, depth is dropped
+				Vertex vertex = { { component(element, componentType, normalized),
+					component(element + positionComponent, componentType, normalized) },{ 1.0f, 1.0f, 1.0f } };
+				vertices.push_back(vertex);
+			}
+
+			if (primitive["attributes"].has("COLOR_0")) {
+				uint32_t colorCount;
+				std::vector<char> colors = readAccessor(document, buffers, primitive["attributes"]["COLOR_0"].asInt(),
+					colorCount, components, componentType, normalized);
+				uint32_t colorComponent = componentSize(componentType);
+				// Integer colors are always normalized in glTF
+				bool colorNormalized = componentType != 5126;
+				for (uint32_t i = 0; i < colorCount && i < count; i++) {
+					const char* element = colors.data() + (size_t)i * components * colorComponent;
+					for (uint32_t c = 0; c < 3; c++) {
+						vertices[base + i].color[c] = component(element + c * colorComponent, componentType, colorNormalized);
+					}
+				}
+			}
+
+			if (primitive.has("indices")) {
+				uint32_t indexCount;
+				std::vector<char> data = readAccessor(document, buffers, primitive["indices"].asInt(),
+					indexCount, components, componentType, normalized);
+				uint32_t size = componentSize(componentType);
+				for (uint32_t i = 0; i < indexCount; i++) {
+					uint32_t index = 0;
+					// Little-endian, so the low bytes of index receive the value
+					memcpy(&index, data.data() + (size_t)i * size, size);
+					indices.push_back(base + index);
+				}
+			}
+			else {
+				for (uint32_t i = 0; i < count; i++) {
+					indices.push_back(base + i);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Vertex.h"
+
+class Json;
+
+// glTF 2.0, both .gltf (external or data: URI buffers) and .glb. Every
+// triangle-list primitive is appended; POSITION and COLOR_0 are read.
+class GltfImporter
+{
+private:
+	static std::vector<char> readAccessor(const Json& document, const std::vector<std::vector<char>>& buffers,
+		int accessor, uint32_t& count, uint32_t& components, int& componentType, bool& normalized);
+	static float component(const char* data, int componentType, bool normalized);
+	static std::vector<char> decodeBase64(const std::string& text);
+public:
+	static void load(const std::string& path, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+};
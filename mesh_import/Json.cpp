@@ -0,0 +1,205 @@
+#include "Json.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+const Json Json::null;
+
+Json::Json()
+	: type(Type::Null)
+	, boolean(false)
+	, number(0.0)
+{
+}
+
+Json Json::parse(const std::string& text)
+{
+	const char* p = text.data();
+	const char* end = p + text.size();
+	Json value = parseValue(p, end);
+	skipSpace(p, end);
+	if (p != end) {
+		throw std::runtime_error("trailing characters after JSON document");
+	}
+	return value;
+}
+
+void Json::skipSpace(const char*& p, const char* end)
+{
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+		p++;
+	}
+}
+
+std::string Json::parseString(const char*& p, const char* end)
+{
+	std::string result;
+	p++;
+	while (p < end && *p != '"') {
+		char c = *p++;
+		if (c != '\\') {
+			result += c;
+			continue;
+		}
+		if (p >= end) {
+			break;
+		}
+		c = *p++;
+		switch (c) {
+		case 'b': result += '\b'; break;
+		case 'f': result += '\f'; break;
+		case 'n': result += '\n'; break;
+		case 'r': result += '\r'; break;
+		case 't': result += '\t'; break;
+		case 'u': {
+			if (end - p < 4) {
+				throw std::runtime_error("bad JSON escape");
+			}
+			unsigned code = (unsigned)strtoul(std::string(p, p + 4).c_str(), nullptr, 16);
+			p += 4;
+			// Encode as UTF-8; surrogate pairs are not needed for glTF keys or URIs
+			if (code < 0x80) {
+				result += (char)code;
+			}
+			else if (code < 0x800) {
+				result += (char)(0xC0 | (code >> 6));
+				result += (char)(0x80 | (code & 0x3F));
+			}
+			else {
+				result += (char)(0xE0 | (code >> 12));
+				result += (char)(0x80 | ((code >> 6) & 0x3F));
+				result += (char)(0x80 | (code & 0x3F));
+			}
+			break;
+		}
+		default: result += c; break;
+		}
+	}
+	if (p >= end) {
+		throw std::runtime_error("unterminated JSON string");
+	}
+	p++;
+	return result;
+}
+
+Json Json::parseValue(const char*& p, const char* end)
+{
+	skipSpace(p, end);
+	if (p >= end) {
+		throw std::runtime_error("unexpected end of JSON");
+	}
+
+	Json value;
+	if (*p == '{') {
+		value.type = Type::Object;
+		p++;
+		skipSpace(p, end);
+		if (p < end && *p == '}') {
+			p++;
+			return value;
+		}
+		while (true) {
+			skipSpace(p, end);
+			if (p >= end || *p != '"') {
+				throw std::runtime_error("expected JSON object key");
+			}
+			std::string key = parseString(p, end);
+			skipSpace(p, end);
+			if (p >= end || *p != ':') {
+				throw std::runtime_error("expected ':' in JSON object");
+			}
+			p++;
+			value.object[key] = parseValue(p, end);
+			skipSpace(p, end);
+			if (p < end && *p == ',') {
+				p++;
+				continue;
+			}
+			if (p < end && *p == '}') {
+				p++;
+				return value;
+			}
+			throw std::runtime_error("expected ',' or '}' in JSON object");
+		}
+	}
+	if (*p == '[') {
+		value.type = Type::Array;
+		p++;
+		skipSpace(p, end);
+		if (p < end && *p == ']') {
+			p++;
+			return value;
+		}
+		while (true) {
+			value.array.push_back(parseValue(p, end));
+			skipSpace(p, end);
+			if (p < end && *p == ',') {
+				p++;
+				continue;
+			}
+			if (p < end && *p == ']') {
+				p++;
+				return value;
+			}
+			throw std::runtime_error("expected ',' or ']' in JSON array");
+		}
+	}
+	if (*p == '"') {
+		value.type = Type::String;
+		value.string = parseString(p, end);
+		return value;
+	}
+	if (end - p >= 4 && strncmp(p, "true", 4) == 0) {
+		value.type = Type::Boolean;
+		value.boolean = true;
+		p += 4;
+		return value;
+	}
+	if (end - p >= 5 && strncmp(p, "false", 5) == 0) {
+		value.type = Type::Boolean;
+		p += 5;
+		return value;
+	}
+	if (end - p >= 4 && strncmp(p, "null", 4) == 0) {
+		p += 4;
+		return value;
+	}
+
+	std::string digits;
+	while (p < end && strchr("+-0123456789.eE", *p)) {
+		digits += *p++;
+	}
+	if (digits.empty()) {
+		throw std::runtime_error("unexpected character in JSON");
+	}
+	value.type = Type::Number;
+	value.number = strtod(digits.c_str(), nullptr);
+	return value;
+}
+
+const Json& Json::operator[](const std::string& key) const
+{
+	auto it = object.find(key);
+	return it == object.end() ? null : it->second;
+}
+
+const Json& Json::operator[](size_t index) const
+{
+	return index < array.size() ? array[index] : null;
+}
+
+bool Json::asBool(bool fallback) const
+{
+	return type == Type::Boolean ? boolean : fallback;
+}
+
+double Json::asNumber(double fallback) const
+{
+	return type == Type::Number ? number : fallback;
+}
+
+const std::string& Json::asString() const
+{
+	return string;
+}
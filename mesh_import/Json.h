@@ -0,0 +1,41 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Just enough JSON for reading glTF documents
+class Json
+{
+public:
+	enum class Type { Null, Boolean, Number, String, Array, Object };
+private:
+	Type type;
+	bool boolean;
+	double number;
+	std::string string;
+	std::vector<Json> array;
+	std::map<std::string, Json> object;
+
+	static const Json null;
+
+	static Json parseValue(const char*& p, const char* end);
+	static std::string parseString(const char*& p, const char* end);
+	static void skipSpace(const char*& p, const char* end);
+public:
+	Json();
+
+	static Json parse(const std::string& text);
+
+	inline Type kind() const { return type; }
+	inline bool has(const std::string& key) const { return object.find(key) != object.end(); }
+	inline size_t size() const { return type == Type::Array ? array.size() : object.size(); }
+
+	const Json& operator[](const std::string& key) const;
+	const Json& operator[](size_t index) const;
+
+	bool asBool(bool fallback = false) const;
+	double asNumber(double fallback = 0.0) const;
+	inline int asInt(int fallback = 0) const { return (int)asNumber(fallback); }
+	const std::string& asString() const;
+};
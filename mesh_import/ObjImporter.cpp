@@ -0,0 +1,54 @@
+#include "ObjImporter.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+void ObjImporter::load(const std::string& path, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open " + path);
+	}
+
+	vertices.clear();
+	indices.clear();
+
+	std::string line;
+	std::vector<uint32_t> polygon;
+	while (std::getline(file, line)) {
+		std::istringstream in(line);
+		std::string keyword;
+		in >> keyword;
+
+		if (keyword == "v") {
+			float x = 0, y = 0, z = 0;
+			float r = 1, g = 1, b = 1;
+			in >> x >> y >> z;
+			if (!(in >> r >> g >> b)) {
+				r = g = b = 1;
+			}
+			// The sample's vertex layout is 2D, depth is dropped
+			vertices.push_back({ { x, y },{ r, g, b } });
+		}
+		else if (keyword == "f") {
+			polygon.clear();
+			std::string corner;
+			while (in >> corner) {
+				// v, v/vt, v//vn or v/vt/vn; only the position is used
+				long index = strtol(corner.c_str(), nullptr, 10);
+				if (index < 0) {
+					index += (long)vertices.size() + 1;
+				}
+				if (index <= 0 || index > (long)vertices.size()) {
+					throw std::runtime_error("face index out of range in " + path);
+				}
+				polygon.push_back((uint32_t)(index - 1));
+			}
+			for (size_t i = 2; i < polygon.size(); i++) {
+				indices.insert(indices.end(), { polygon[0], polygon[i - 1], polygon[i] });
+			}
+		}
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Vertex.h"
+
+// Wavefront OBJ. Uses v lines (with the optional trailing r g b color
+// extension) and f lines; polygons are fan-triangulated.
+class ObjImporter
+{
+public:
+	static void load(const std::string& path, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+};
@@ -0,0 +1,90 @@
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Vertex.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "VertexQuantizer.h"
+#include "ObjImporter.h"
+#include "GltfImporter.h"
+
+// Converts OBJ / glTF meshes into the mapped mesh format read by
+// MeshFile. Meshes are cache and fetch optimized on the way through.
+//
+//   mesh_import <input.obj|input.gltf|input.glb> <output.vkm> [-packed]
+int main(int argc, char** argv)
+{
+	if (argc < 3) {
+		fprintf(stderr, "usage: %s <input.obj|input.gltf|input.glb> <output.vkm> [-packed]\n", argv[0]);
+		return 1;
+	}
+	std::string input = argv[1];
+	std::string output = argv[2];
+	bool packed = argc > 3 && strcmp(argv[3], "-packed") == 0;
+
+	try {
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+
+		std::string extension = input.substr(input.find_last_of('.') + 1);
+		if (extension == "obj" || extension == "OBJ") {
+			ObjImporter::load(input, vertices, indices);
+		}
+		else if (extension == "gltf" || extension == "glb") {
+			GltfImporter::load(input, vertices, indices);
+		}
+		else {
+			throw std::runtime_error("unknown input format ." + extension);
+		}
+
+		MeshStats before = MeshOptimizer::analyze(indices, (uint32_t)vertices.size());
+		MeshOptimizer::optimizeVertexCache(indices, (uint32_t)vertices.size());
+		MeshOptimizer::optimizeVertexFetch(vertices, indices);
+		MeshStats after = MeshOptimizer::analyze(indices, (uint32_t)vertices.size());
+
+		MeshFileHeader header = {};
+		header.vertexCount = (uint32_t)vertices.size();
+		header.indexCount = (uint32_t)indices.size();
+		header.indexSize = vertices.size() <= 0x10000 ? 2 : 4;
+
+		std::vector<uint16_t> shortIndices;
+		const void* indexData = indices.data();
+		if (header.indexSize == 2) {
+			shortIndices.assign(indices.begin(), indices.end());
+			indexData = shortIndices.data();
+		}
+
+		if (packed) {
+			QuantizationBounds bounds = VertexQuantizer::bounds(vertices);
+			std::vector<PackedVertex> packedVertices;
+			VertexQuantizer::encode(vertices, bounds, packedVertices);
+			QuantizationReport report = VertexQuantizer::validate(vertices, packedVertices, bounds);
+
+			header.vertexFormat = (uint32_t)VertexFormat::Packed;
+			header.vertexStride = sizeof(PackedVertex);
+			header.boundsCenter[0] = bounds.center.x;
+			header.boundsCenter[1] = bounds.center.y;
+			header.boundsExtent[0] = bounds.extent.x;
+			header.boundsExtent[1] = bounds.extent.y;
+			MeshFile::write(output, header, packedVertices.data(), indexData);
+			printf("packed vertices, max error position %g color %g\n", report.maxPositionError, report.maxColorError);
+		}
+		else {
+			header.vertexFormat = (uint32_t)VertexFormat::Float;
+			header.vertexStride = sizeof(Vertex);
+			header.boundsExtent[0] = header.boundsExtent[1] = 1.0f;
+			MeshFile::write(output, header, vertices.data(), indexData);
+		}
+
+		printf("%u vertices, %u triangles, uint%u indices, ACMR %.3f -> %.3f\n",
+			header.vertexCount, header.indexCount / 3, header.indexSize * 8, before.acmr, after.acmr);
+	}
+	catch (const std::exception& e) {
+		fprintf(stderr, "mesh_import: %s\n", e.what());
+		return 1;
+	}
+	return 0;
+}